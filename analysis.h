@@ -0,0 +1,32 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "left_recursion.h"
+#include "grammar_simplifier.h"
+
+// Everything the five phases produce for one grammar: this is what output.txt is written from
+// and what the binary cache stores.
+struct AnalysisResult
+{
+    SymbolTable symbols;
+    Grammar inputGrammar;       // as loaded; an incremental update diffs the next grammar against it
+    Grammar factoredGrammar;    // after Phase 1
+    Grammar finalGrammar;       // after Phase 2
+    TerminalIndex terminals;    // bit numbering of FIRST/FOLLOW and table columns
+    NullableSet nullable;       // Phase 3: non-terminals deriving ε, which FIRST sets leave out
+    TerminalSets firstSets;     // Phase 3
+    TerminalSets followSets;    // Phase 4
+    LL1Table parsingTable;      // Phase 5
+
+    // Left-recursive components rewritten by Phase 2. Only filled when the phases run; the
+    // cache does not store it.
+    std::vector<RecursionReport> recursionReports;
+
+    // What --simplify removed before Phase 1; ran is false without it. Not cached either.
+    SimplifyReport simplification;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef BATCH_ANALYZER_H
+#define BATCH_ANALYZER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <memory_resource>
+
+#include "grammar_analyzer.h"
+#include "grammar_loader.h"
+#include "output_writer.h"
+
+/* Batch mode: the full pipeline over many grammar files, several at a time.
+
+   Every worker thread owns a GrammarAnalyzer and a pool resource that the analyzer's phase
+   arenas take their chunks from. Each job therefore gets fresh arenas, and a job's memory goes
+   back to the worker's pool when it finishes, ready for the next job. Workers take files
+   from a shared counter. Results are handed to the sink strictly in list order: a job
+   that finishes early waits until every job before it has been emitted. The output is the
+   same whatever the thread count or timing.
+
+   With incremental updates, workers take runs of INCREMENTAL_RUN consecutive files instead.
+   The first file of a run is analyzed in full and each later one updated from the file before
+   it, so which jobs are incremental depends on the list alone, not on which worker ran what.
+*/
+
+struct BatchJob
+{
+    std::string path;
+    bool ok = false;
+    std::string error;              // why the job failed, when !ok
+    size_t nonTerminals = 0;        // of the final grammar
+    size_t productions = 0;
+    size_t conflicts = 0;
+    AnalysisMode mode = AnalysisMode::Full;
+    double seconds = 0;             // load and analysis, output rendering excluded
+    char *output = nullptr;         // rendered output, malloc'd by open_memstream
+    size_t outputSize = 0;
+};
+
+class BatchAnalyzer
+{
+public:
+    static constexpr size_t INCREMENTAL_RUN = 16;
+
+    BatchAnalyzer(const AnalyzerOptions &options, OutputFormat format, const OutputSections &sections, size_t workers)
+        : options(options), format(format), sections(sections), workerCount(std::max<size_t>(1, workers)) {}
+
+    // Workers that take part in a batch of jobs files; each takes at least one run.
+    size_t workersFor(size_t jobs) const { return std::min(workerCount, (jobs + runLength() - 1) / runLength()); }
+
+    /* Analyzes every file in paths and calls sink(job) for each, in the order of paths; sink
+       runs on one thread at a time. The job's output buffer is freed once sink returns. */
+    template <typename Sink>
+    void run(const std::vector<std::string> &paths, Sink sink)
+    {
+        std::vector<BatchJob> jobs(paths.size());
+        std::vector<uint8_t> finished(paths.size(), 0);
+        std::atomic<size_t> nextJob(0);
+        std::mutex emitLock;
+        size_t nextToEmit = 0;
+
+        size_t run = runLength();
+
+        auto worker = [&] {
+            std::pmr::unsynchronized_pool_resource scratch(std::pmr::pool_options{0, 16 << 20});
+            GrammarAnalyzer analyzer(options, &scratch);
+            for (size_t first = nextJob.fetch_add(run); first < jobs.size(); first = nextJob.fetch_add(run))
+            {
+                analyzer.forget();
+                for (size_t i = first; i < std::min(first + run, jobs.size()); i++)
+                {
+                    jobs[i].path = paths[i];
+                    analyzeFile(analyzer, jobs[i]);
+                    std::lock_guard<std::mutex> guard(emitLock);
+                    finished[i] = 1;
+                    for (; nextToEmit < jobs.size() && finished[nextToEmit]; nextToEmit++)
+                    {
+                        sink(static_cast<const BatchJob &>(jobs[nextToEmit]));
+                        std::free(jobs[nextToEmit].output);
+                        jobs[nextToEmit].output = nullptr;
+                    }
+                }
+            }
+            mergeThreadStats();
+        };
+        std::vector<std::thread> helpers;
+        for (size_t t = 1; t < workersFor(paths.size()); t++)
+            helpers.emplace_back(worker);
+        worker();
+        for (auto &helper : helpers)
+            helper.join();
+    }
+
+private:
+    AnalyzerOptions options;
+    OutputFormat format;
+    OutputSections sections;
+    size_t workerCount;
+
+    size_t runLength() const { return options.updatesIncrementally() ? INCREMENTAL_RUN : 1; }
+
+    void analyzeFile(GrammarAnalyzer &analyzer, BatchJob &job)
+    {
+        auto started = std::chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.open(job.path))
+        {
+            job.error = "Error: Unable to open grammar file.";
+            return;
+        }
+        if (!analyzer.analyze(file.text()))
+        {
+            job.error = analyzer.error();
+            while (!job.error.empty() && job.error.back() == '\n')
+                job.error.pop_back();
+            return;
+        }
+        job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        const AnalysisResult &result = analyzer.result();
+        job.nonTerminals = result.finalGrammar.nonTerminals.size();
+        job.productions = result.finalGrammar.productionCount();
+        job.conflicts = result.parsingTable.conflicts.size();
+        job.mode = analyzer.mode();
+
+        FILE *memory = ::open_memstream(&job.output, &job.outputSize);
+        bool written = memory && AnalysisWriter(result, sections).write(memory, format);
+        if (memory)
+            std::fclose(memory);
+        if (!written)
+            job.error = "Error: Unable to render the output.";
+        job.ok = written;
+    }
+};
+
+#endif
@@ -3,573 +3,1180 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
-#include <set>
-#include <iomanip> 
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <optional>
+#include <new>
+#include <cstdlib>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "reference_sets.h"
+#include "ll1_table.h"
+#include "ll1_driver.h"
+#include "chunked_parser.h"
+#include "parse_tree.h"
+#include "error_recovery.h"
+#include "dfa_lexer.h"
+#include "analysis.h"
+#include "grammar_cache.h"
+#include "phase_memory.h"
+#include "left_factoring.h"
+#include "trie_factoring.h"
+#include "left_recursion.h"
+#include "parallel_sets.h"
+#include "grammar_generator.h"
+#include "grammar_loader.h"
+#include "output_writer.h"
+#include "incremental.h"
+#include "grammar_analyzer.h"
+#include "grammar_service.h"
+#include "batch_analyzer.h"
+#include "lr_automaton.h"
+#include "lr_table.h"
+#include "header_writer.h"
+#include "lookahead_analysis.h"
+#include "engine_fuzzer.h"
 
 using namespace std;
 
+// Global allocation counters for the per-phase memory report (see phase_memory.h). Every
+// replaceable overload is defined here so that scalar, array, nothrow and over-aligned
+// allocations are all counted and all released with free(). Kept out of line so the compiler
+// does not pair inlined malloc/free with new/delete.
+static void *countedAlloc(size_t size, size_t alignment) noexcept
+{
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    heapBytes.fetch_add(size, memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    if (alignment <= alignof(max_align_t))
+        return malloc(size);
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment); // size must be a multiple
+}
 
-/* Function for creating tokens*/
-vector<string> split(const string &s, char delimiter) 
+static void *countedNew(size_t size, size_t alignment)
 {
-    vector<string> tokens;
-    istringstream iss(s);
-    string token;
-    while (getline(iss, token, delimiter)) 
-    {
-        // Find first and last non-whitespace characters.
-        size_t start = token.find_first_not_of(" \t");
-        size_t end = token.find_last_not_of(" \t");
-        if (start != string::npos && end != string::npos)
-            tokens.push_back(token.substr(start, end - start + 1));
-    }
-    return tokens;
+    if (void *p = countedAlloc(size, alignment))
+        return p;
+    throw bad_alloc();
 }
 
+__attribute__((noinline)) void *operator new(size_t size) { return countedNew(size, 0); }
+__attribute__((noinline)) void *operator new[](size_t size) { return countedNew(size, 0); }
+__attribute__((noinline)) void *operator new(size_t size, align_val_t al) { return countedNew(size, size_t(al)); }
+__attribute__((noinline)) void *operator new[](size_t size, align_val_t al) { return countedNew(size, size_t(al)); }
+__attribute__((noinline)) void *operator new(size_t size, const nothrow_t &) noexcept { return countedAlloc(size, 0); }
+__attribute__((noinline)) void *operator new[](size_t size, const nothrow_t &) noexcept { return countedAlloc(size, 0); }
+__attribute__((noinline)) void *operator new(size_t size, align_val_t al, const nothrow_t &) noexcept
+{
+    return countedAlloc(size, size_t(al));
+}
+__attribute__((noinline)) void *operator new[](size_t size, align_val_t al, const nothrow_t &) noexcept
+{
+    return countedAlloc(size, size_t(al));
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t, align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, align_val_t, const nothrow_t &) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, align_val_t, const nothrow_t &) noexcept { free(p); }
+
+// Command-line switches. Without any, the bitset engine runs and results go to output.txt.
+struct Options
+{
+    // --engine=reference, --check-engines, --factor=trie, --threads=N, --incremental and --suffix-sets
+    AnalyzerOptions analysis;
+    string tokenFile;               // --parse=FILE: run the predictive parser over a token file
+    string sourceFile;              // --lex=FILE: lex a source file with the generated DFA and parse it
+    string lexerSpec = "regex.txt"; // --lexer-spec=FILE: token rules the DFA is generated from
+    size_t parseThreads = 0;        // --parse-threads=N: also parse in chunks split at sync terminals
+    bool parseTree = false;         // --parse-tree: also build the parse tree in an arena
+    bool parseEvents = false;       // --parse-events: also record the pre-order event stream
+    size_t recoverErrors = 0;       // --recover[=N]: also parse with error recovery, keeping N errors
+    bool lexScanSet = false;        // --lex-scan=scalar|sse2|avx2: override the CPU's best scanner
+    ScanLevel lexScan = ScanLevel::Scalar;
+    string cacheFile;               // --cache=FILE: binary cache of the analysis, keyed by grammar hash
+    bool memoryReport = false;      // --memory-report: per-phase allocations and peak RSS
+    bool threadScaling = false;     // --thread-scaling: time sequential vs. 1..N threads
+    bool benchmark = false;         // --benchmark[=SHAPE]: time every phase on a generated grammar
+    GrammarShape benchmarkShape;
+    size_t benchmarkRuns = 5;       // --benchmark-runs=N
+    string benchmarkOut;            // --benchmark-out=FILE: JSON destination (default stdout)
+    bool fuzz = false;              // --fuzz[=N]: compare every engine with the reference on N random grammars
+    FuzzOptions fuzzOptions;        // --fuzz-seed=S, --fuzz-nts=N; engines and threads come from analysis
+    bool stats = false;             // --stats[=json]: per-phase time, iterations, inserts, allocations
+    bool statsJson = false;
+    OutputFormat outputFormat = OutputFormat::Text;   // --format=text|sparse|csv|json|binary
+    OutputSections outputSections;                    // --sections=factored,final,first,follow,table
+    string outputFile = "output.txt";                 // --output=FILE
+    bool serve = false;             // --serve[=SOCKET]: answer analyze requests until told to quit
+    string serveSocket;             // Unix domain socket to serve on; stdin/stdout if empty
+    string batch;                   // --batch=DIR|LIST: analyze every grammar in a directory or list file
+    size_t batchJobs = 0;           // --batch-jobs=N: grammars analyzed at once; 0 uses every core
+    LrMethod lrMethod = LrMethod::None;   // --lr=lr0|slr|lalr: also build an LR table for the input grammar
+    string lrOutput = "lr_output.txt";    // --lr-output=FILE
+    string headerFile;              // --emit-header=FILE: constexpr tables and parser for static_parser.h
+    string headerNamespace;         // --header-namespace=NS: defaults to the header's file name
+    LookaheadBudget lookahead;      // --lookahead[=K], --lookahead-budget=N, --lookahead-ms=MS
+    bool lookaheadAnalysis = false; // --lookahead[=K]: explain LL(1) conflicts and try k tokens
+    string lookaheadOutput = "lookahead.txt";   // --lookahead-output=FILE
+};
+
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--engine=reference")
+            options.analysis.referenceEngine = true;
+        else if (arg == "--engine=bitset")
+            options.analysis.referenceEngine = false;
+        else if (arg == "--check-engines")
+            options.analysis.checkEngines = true;
+        else if (arg.compare(0, 8, "--parse=") == 0)
+            options.tokenFile = arg.substr(8);
+        else if (arg.compare(0, 16, "--parse-threads=") == 0 && stoul("0" + arg.substr(16)) > 0)
+            options.parseThreads = stoul(arg.substr(16));
+        else if (arg == "--parse-tree")
+            options.parseTree = true;
+        else if (arg == "--parse-events")
+            options.parseEvents = true;
+        else if (arg == "--recover")
+            options.recoverErrors = 1000;
+        else if (arg.compare(0, 10, "--recover=") == 0 && stoul("0" + arg.substr(10)) > 0)
+            options.recoverErrors = stoul(arg.substr(10));
+        else if (arg.compare(0, 6, "--lex=") == 0 && arg.size() > 6)
+            options.sourceFile = arg.substr(6);
+        else if (arg.compare(0, 13, "--lexer-spec=") == 0 && arg.size() > 13)
+            options.lexerSpec = arg.substr(13);
+        else if (arg.compare(0, 11, "--lex-scan=") == 0 && parseScanLevel(arg.substr(11), options.lexScan))
+        {
+            if (!scanLevelSupported(options.lexScan))
+            {
+                cerr << "Error: This CPU cannot run the " << scanLevelName(options.lexScan) << " scanner of " << arg << ".\n";
+                return false;
+            }
+            options.lexScanSet = true;
+        }
+        else if (arg.compare(0, 8, "--cache=") == 0)
+            options.cacheFile = arg.substr(8);
+        else if (arg == "--serve")
+            options.serve = true;
+        else if (arg.compare(0, 8, "--serve=") == 0 && arg.size() > 8)
+        {
+            options.serve = true;
+            options.serveSocket = arg.substr(8);
+        }
+        else if (arg.compare(0, 8, "--batch=") == 0 && arg.size() > 8)
+            options.batch = arg.substr(8);
+        else if (arg.compare(0, 13, "--batch-jobs=") == 0 && stoul("0" + arg.substr(13)) > 0)
+            options.batchJobs = stoul(arg.substr(13));
+        else if (arg == "--lr=lr0")
+            options.lrMethod = LrMethod::LR0;
+        else if (arg == "--lr=slr")
+            options.lrMethod = LrMethod::SLR1;
+        else if (arg == "--lr=lalr")
+            options.lrMethod = LrMethod::LALR1;
+        else if (arg.compare(0, 12, "--lr-output=") == 0 && arg.size() > 12)
+            options.lrOutput = arg.substr(12);
+        else if (arg == "--lookahead")
+            options.lookaheadAnalysis = true;
+        else if (arg.compare(0, 12, "--lookahead=") == 0 && stoul("0" + arg.substr(12)) >= 2 &&
+                 stoul(arg.substr(12)) <= 16)
+        {
+            options.lookaheadAnalysis = true;
+            options.lookahead.maxTokens = stoul(arg.substr(12));
+        }
+        else if (arg.compare(0, 19, "--lookahead-budget=") == 0 && stoul("0" + arg.substr(19)) > 0)
+            options.lookahead.configurations = stoul(arg.substr(19));
+        else if (arg.compare(0, 15, "--lookahead-ms=") == 0 && stoul("0" + arg.substr(15)) > 0)
+            options.lookahead.seconds = stoul(arg.substr(15)) / 1000.0;
+        else if (arg.compare(0, 19, "--lookahead-output=") == 0 && arg.size() > 19)
+            options.lookaheadOutput = arg.substr(19);
+        else if (arg.compare(0, 14, "--emit-header=") == 0 && arg.size() > 14)
+            options.headerFile = arg.substr(14);
+        else if (arg.compare(0, 19, "--header-namespace=") == 0 && usableIdentifier(arg.substr(19)))
+            options.headerNamespace = arg.substr(19);
+        else if (arg == "--memory-report")
+            options.memoryReport = true;
+        else if (arg == "--incremental")
+            options.analysis.incremental = true;
+        else if (arg == "--factor=trie")
+            options.analysis.trieFactoring = true;
+        else if (arg == "--factor=classic")
+            options.analysis.trieFactoring = false;
+        else if (arg == "--simplify")
+            options.analysis.simplify = true;
+        else if (arg == "--suffix-sets=shared")
+            options.analysis.sharedSuffixes = true;
+        else if (arg == "--suffix-sets=flat")
+            options.analysis.sharedSuffixes = false;
+        else if (arg.compare(0, 10, "--threads=") == 0 && stoul("0" + arg.substr(10)) > 0)
+            options.analysis.threads = stoul(arg.substr(10));
+        else if (arg == "--thread-scaling")
+            options.threadScaling = true;
+        else if (arg == "--stats" || arg == "--stats=table")
+            options.stats = true;
+        else if (arg == "--stats=json")
+            options.stats = options.statsJson = true;
+        else if (arg == "--benchmark")
+            options.benchmark = true;
+        else if (arg.compare(0, 12, "--benchmark=") == 0 && parseGrammarShape(arg.substr(12), options.benchmarkShape))
+            options.benchmark = true;
+        else if (arg.compare(0, 17, "--benchmark-runs=") == 0 && stoul("0" + arg.substr(17)) > 0)
+            options.benchmarkRuns = stoul(arg.substr(17));
+        else if (arg.compare(0, 16, "--benchmark-out=") == 0)
+            options.benchmarkOut = arg.substr(16);
+        else if (arg == "--fuzz")
+            options.fuzz = true;
+        else if (arg.compare(0, 7, "--fuzz=") == 0 && stoul("0" + arg.substr(7)) > 0)
+        {
+            options.fuzz = true;
+            options.fuzzOptions.grammars = stoul(arg.substr(7));
+        }
+        else if (arg.compare(0, 12, "--fuzz-seed=") == 0 && arg.size() > 12 &&
+                 arg.find_first_not_of("0123456789", 12) == string::npos)
+            options.fuzzOptions.seed = stoull(arg.substr(12));
+        else if (arg.compare(0, 11, "--fuzz-nts=") == 0 && stoul("0" + arg.substr(11)) > 0)
+            options.fuzzOptions.maxNonTerminals = stoul(arg.substr(11));
+        else if (arg.compare(0, 9, "--format=") == 0 && parseOutputFormat(arg.substr(9), options.outputFormat))
+            continue;
+        else if (arg.compare(0, 11, "--sections=") == 0 && parseOutputSections(arg.substr(11), options.outputSections))
+            continue;
+        else if (arg.compare(0, 9, "--output=") == 0 && arg.size() > 9)
+            options.outputFile = arg.substr(9);
+        else
+        {
+            cerr << "Error: Unknown option " << arg << "\n"
+                 << "Usage: cfg_parser [--engine=bitset|reference] [--check-engines] [--parse=TOKENS [--parse-threads=N] [--parse-tree] [--parse-events] [--recover[=N]]] [--cache=FILE [--incremental]]\n"
+                 << "                  [--lex=SOURCE [--lexer-spec=FILE] [--lex-scan=scalar|sse2|avx2]]\n"
+                 << "                  [--memory-report] [--simplify] [--factor=classic|trie] [--suffix-sets=flat|shared] [--threads=N] [--thread-scaling]\n"
+                 << "                  [--stats[=table|json]]\n"
+                 << "                  [--benchmark[=nts=N,alts=N,len=N,terms=N,nullable=P,leftrec=P,prefix=P,seed=N]]\n"
+                 << "                  [--benchmark-runs=N] [--benchmark-out=FILE] [--output=FILE]\n"
+                 << "                  [--fuzz[=N] [--fuzz-seed=S] [--fuzz-nts=N]]\n"
+                 << "                  [--format=text|sparse|csv|json|binary] [--sections=factored,final,first,follow,table]\n"
+                 << "                  [--serve[=SOCKET]] [--batch=DIR|LIST [--batch-jobs=N]] [--lr=lr0|slr|lalr [--lr-output=FILE]]\n"
+                 << "                  [--emit-header=FILE [--header-namespace=NS]]\n"
+                 << "                  [--lookahead[=K] [--lookahead-budget=N] [--lookahead-ms=MS] [--lookahead-output=FILE]]\n";
+            return false;
+        }
+    }
+    return true;
+}
 
-/* function for returning longest common prefix*/
-vector<string> commonPrefix(const vector<string>& a, const vector<string>& b) 
+/* Prints what an --incremental run recomputed, or that the edit needed the full analysis. */
+void writeIncrementalReport(ostream &out, const GrammarAnalyzer &analyzer)
 {
-    vector<string> prefix;
-    size_t i = 0;
-    // Continue while tokens are equal and within bounds.
-    while (i < a.size() && i < b.size() && a[i] == b[i]) 
+    if (analyzer.mode() != AnalysisMode::Incremental)
     {
-        prefix.push_back(a[i]);
-        ++i;
+        out << "Incremental update does not apply to this edit; running the full analysis.\n";
+        return;
     }
-    return prefix;
+    const IncrementalReport &report = analyzer.report();
+    out << "Incremental update: " << report.rulesChanged << " rules changed; recomputed " << report.rulesFactored
+        << " factored rules, " << report.components << " left-recursive components, " << report.firstSets
+        << " FIRST sets, " << report.followSets << " FOLLOW sets and " << report.tableRows << " table rows"
+        << (report.tablePatched ? " (table patched in place)" : "") << " in " << fixed << setprecision(3)
+        << report.seconds * 1e3 << " ms.\n";
+    out.unsetf(ios::floatfield);
 }
 
-/* Performs left factoring on productions for a single non-terminal.
- If multiple productions share a common prefix, the function factors it out by introducing a new non-terminal.
-*/
-void leftFactor(const string &nonTerminal, vector<string>& prods, map<string, vector<string>>& newProds,
-                              int &newNTcount) 
+/* Prints one line per phase: heap allocations and bytes, arena chunks and bytes, peak RSS. */
+void writeMemoryReport(ostream &out, const vector<PhaseMemory> &memory)
+{
+    out << left << setw(18) << "Phase" << right << setw(14) << "Heap allocs" << setw(14) << "Heap bytes"
+        << setw(14) << "Arena chunks" << setw(14) << "Arena bytes" << setw(14) << "Peak RSS KB" << "\n";
+    for (const auto &phase : memory)
     {
-    // If only one production exists, no left factoring is needed.
-    if (prods.size() < 2) 
+        out << left << setw(18) << phase.phase << right << setw(14) << phase.heapAllocations << setw(14) << phase.heapBytes
+            << setw(14) << phase.arenaChunks << setw(14) << phase.arenaBytes << setw(14) << phase.peakRssKb << "\n";
+    }
+}
+
+/* Prints the --stats counters for loading and for every phase that ran, as a table or as JSON. */
+void writeStats(ostream &out, const LoadStats &load, const vector<PhaseStats> &stats, bool json)
+{
+    if (!CFG_STATS)
     {
-        newProds[nonTerminal] = prods;
+        out << "Statistics are not available: built with CFG_STATS=0.\n";
         return;
     }
-    
-    // Tokenize each production by splitting on spaces.
-    vector< vector<string> > tokenized;
-    for (auto &prod : prods) 
-    {
-        tokenized.push_back(split(prod, ' '));
-    }
-    
-    // Compute the common prefix among all productions.
-    vector<string> common = tokenized[0];
-    for (size_t i = 1; i < tokenized.size(); i++) 
-    {
-        common = commonPrefix(common, tokenized[i]);
-        if (common.empty())
-            break;
-    }
-    
-    // If there is a non-trivial common prefix, perform factoring.
-    if (!common.empty()) 
-    {
-        // Create a new non-terminal name (e.g., E' etc.).
-        string newNT = nonTerminal + "'";
-        if(newNTcount > 1)
-            newNT += std::to_string(newNTcount);
-        newNTcount++;
-        
-        // Create a new production for the original non-terminal:
-        // A -> common newNT
-        ostringstream factoredProd;
-        for (auto &token : common)
-            factoredProd << token << " ";
-        factoredProd << newNT;
-        newProds[nonTerminal].push_back(factoredProd.str());
-        
-        // Create productions for the new non-terminal with the suffixes.
-        vector<string> newNTProds;
-        for (auto &tokens : tokenized) 
+    if (json)
+    {
+        out << "{\n  \"load\": {\"bytes\": " << load.bytes << ", \"lines\": " << load.lines << ", \"rules\": "
+            << load.rules << ", \"productions\": " << load.productions << ", \"seconds\": " << setprecision(9)
+            << load.seconds << ", \"mbPerSecond\": " << load.megabytesPerSecond() << "},\n  \"phases\": [\n";
+        for (size_t i = 0; i < stats.size(); i++)
         {
-            // Remove the common prefix.
-            vector<string> suffix(tokens.begin() + common.size(), tokens.end());
-            // If no suffix remains, denote epsilon ("ε").
-            if (suffix.empty()) 
-            {
-                newNTProds.push_back("ε");
-            } 
-            else 
-            {
-                std::ostringstream oss;
-                for (auto &s : suffix)
-                    oss << s << " ";
-                newNTProds.push_back(oss.str());
-            }
+            const PhaseStats &s = stats[i];
+            out << "    {\"phase\": \"" << s.phase << "\", \"seconds\": " << setprecision(9) << s.seconds
+                << ", \"iterations\": " << s.iterations << ", \"setInserts\": " << s.setInserts
+                << ", \"allocations\": " << s.allocations << ", \"productions\": " << s.productions
+                << ", \"nonTerminalsCreated\": " << s.nonTerminalsCreated << "}"
+                << (i + 1 < stats.size() ? "," : "") << "\n";
         }
-        newProds[newNT] = newNTProds;
-    } 
-    else 
+        out << "  ]\n}\n" << setprecision(6);
+        return;
+    }
+    ostringstream table;
+    table << "Loaded " << load.bytes << " bytes, " << load.rules << " rules, " << load.productions
+          << " productions in " << fixed << setprecision(3) << load.seconds * 1000 << " ms ("
+          << setprecision(1) << load.megabytesPerSecond() << " MB/s)\n";
+    table << left << setw(18) << "Phase" << right << setw(12) << "Time ms" << setw(12) << "Iterations"
+          << setw(14) << "Set inserts" << setw(14) << "Allocations" << setw(13) << "Productions"
+          << setw(10) << "New NTs" << "\n";
+    for (const auto &s : stats)
     {
-        // No common prefix found; simply copy the original productions.
-        newProds[nonTerminal] = prods;
+        table << left << setw(18) << s.phase << right << setw(12) << fixed << setprecision(3) << s.seconds * 1000
+              << setw(12) << s.iterations << setw(14) << s.setInserts << setw(14) << s.allocations
+              << setw(13) << s.productions << setw(10) << s.nonTerminalsCreated << "\n";
     }
+    out << table.str();
 }
 
-// Removes immediate left recursion for a single non-terminal.
-// For productions of the form A -> Aα | β, transforms them into:
-//    A  -> β A'
-//    A' -> α A' | ε
-void leftRecursion(const string &nonTerminal, vector<string>& prods, map<string, vector<string>>& newGrammar) 
+/* Prints what --simplify removed and how much smaller the grammar got. */
+void writeSimplifyReport(ostream &out, const AnalysisResult &result)
+{
+    const SimplifyReport &report = result.simplification;
+    if (!report.ran)
+        return;
+    if (report.emptyLanguage)
     {
-    vector<string> recursiveProds;    // Productions where left recursion occurs.
-    vector<string> nonRecursiveProds; // Productions without left recursion.
-    
-    // Partition productions into recursive and non-recursive.
-    for (auto &prod : prods) 
+        out << "Simplification skipped: " << result.symbols.name(result.inputGrammar.startSymbol)
+            << " derives no terminal string.\n";
+        return;
+    }
+    auto percent = [](size_t before, size_t after) { return before ? 100.0 * (before - after) / before : 0.0; };
+    out << "Simplified grammar: " << report.nonTerminalsBefore << " -> " << report.nonTerminalsAfter
+        << " non-terminals, " << report.productionsBefore << " -> " << report.productionsAfter << " productions, "
+        << report.symbolsBefore << " -> " << report.symbolsAfter << " symbols (" << fixed << setprecision(1)
+        << percent(report.symbolsBefore, report.symbolsAfter) << "% smaller)\n";
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+    auto list = [&](const char *what, const vector<SymbolId> &ids) {
+        if (ids.empty())
+            return;
+        const size_t shown = 10;
+        out << "  " << what << " (" << ids.size() << "):";
+        vector<SymbolId> names = sortedByName(ids, result.symbols);
+        for (size_t i = 0; i < names.size() && i < shown; i++)
+            out << " " << result.symbols.name(names[i]);
+        out << (names.size() > shown ? " ...\n" : "\n");
+    };
+    list("non-productive", report.nonProductive);
+    list("unreachable", report.unreachable);
+    list("unit chains collapsed", report.collapsed);
+    if (report.selfUnitProductions + report.duplicateProductions > 0)
+        out << "  dropped " << report.selfUnitProductions << " X -> X and " << report.duplicateProductions
+            << " duplicate productions\n";
+}
+
+/* Lists every left-recursive component Phase 2 rewrote and how its production count changed. */
+void writeRecursionReport(ostream &out, const AnalysisResult &result)
+{
+    for (const auto &report : result.recursionReports)
     {
-        vector<string> tokens = split(prod, ' ');
-        if (!tokens.empty() && tokens[0] == nonTerminal) 
+        out << "Left recursion removed from {";
+        for (size_t i = 0; i < report.members.size(); i++)
+            out << (i ? ", " : " ") << result.symbols.name(report.members[i]);
+        long long delta = static_cast<long long>(report.productionsAfter) - static_cast<long long>(report.productionsBefore);
+        out << " }: " << report.productionsBefore << " -> " << report.productionsAfter << " productions ("
+            << (delta >= 0 ? "+" : "") << delta << ")\n";
+        if (!report.hidden.empty())
         {
-            // Production of the form A -> A α, remove the leading non-terminal.
-            std::ostringstream oss;
-            for (size_t i = 1; i < tokens.size(); i++) {
-                oss << tokens[i] << " ";
-            }
-            recursiveProds.push_back(oss.str());
-        } else {
-            nonRecursiveProds.push_back(prod);
+            out << "  still left-recursive through a nullable prefix:";
+            for (SymbolId nt : report.hidden)
+                out << " " << result.symbols.name(nt);
+            out << "\n";
         }
     }
-    
-    // If no left recursion exists, simply copy the productions.
-    if (recursiveProds.empty()) {
-        newGrammar[nonTerminal] = prods;
-        return;
+}
+
+/* Times FIRST+FOLLOW with the sequential worklist engine and with the parallel engine on 1, 2,
+   4, ... up to maxThreads threads, best of five runs each, and prints the speedups. Returns
+   false if any parallel run disagrees with the sets in result. */
+bool writeThreadScaling(ostream &out, const AnalysisResult &result, size_t maxThreads)
+{
+    const Grammar &grammar = result.finalGrammar;
+    const SymbolTable &symbols = result.symbols;
+    const TerminalIndex &terminals = result.terminals;
+    const NullableSet &nullable = result.nullable;
+    auto bestOf = [](auto run) {
+        double best = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            auto started = chrono::steady_clock::now();
+            run();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+            best = i == 0 ? seconds : min(best, seconds);
+        }
+        return best;
+    };
+
+    double sequential = bestOf([&] {
+        TerminalSets first = firstSetWorklist(grammar, symbols, terminals, nullable);
+        SuffixFirstSets suffixes(grammar, symbols, terminals, first, nullable);
+        followSetWorklist(grammar, suffixes, symbols, terminals, grammar.startSymbol);
+    });
+    vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    ostringstream table;
+    table << fixed;
+    table << left << setw(12) << "Threads" << right << setw(16) << "FIRST+FOLLOW ms" << setw(10) << "Speedup"
+          << setw(10) << "Steals" << "\n";
+    table << left << setw(12) << "sequential" << right << setw(16) << setprecision(3) << sequential * 1000
+          << setw(10) << "1.00x" << setw(10) << "-" << "\n";
+    bool agree = true;
+    for (size_t threads : threadCounts)
+    {
+        WorkStealingPool pool(threads);
+        TerminalSets first, follow;
+        uint64_t steals = 0;
+        double parallel = bestOf([&] {
+            first = firstSetParallel(grammar, symbols, terminals, nullable, pool);
+            steals = pool.steals();
+            SuffixFirstSets suffixes(grammar, symbols, terminals, first, nullable);
+            follow = followSetParallel(grammar, suffixes, symbols, terminals, grammar.startSymbol, pool);
+            steals += pool.steals();
+        });
+        agree = agree && first == result.firstSets && follow == result.followSets;
+        ostringstream speedup;
+        speedup << fixed << setprecision(2) << (parallel > 0 ? sequential / parallel : 0.0) << "x";
+        table << left << setw(12) << threads << right << setw(16) << setprecision(3) << parallel * 1000
+              << setw(10) << speedup.str() << setw(10) << steals << "\n";
     }
-    
-    // Create a new non-terminal (e.g., A').
-    string newNT = nonTerminal + "'";
-    vector<string> newNonRecursive;
-    // Append the new non-terminal to each non-recursive production.
-    for (auto &beta : nonRecursiveProds) 
-    {
-        std::ostringstream oss;
-        oss << beta << " " << newNT;
-        newNonRecursive.push_back(oss.str());
-    }
-    newGrammar[nonTerminal] = newNonRecursive;
-    
-    // For each recursive production, remove the left recursion and add new non-terminal.
-    vector<string> newRecursive;
-    for (auto &alpha : recursiveProds) 
-    {
-        ostringstream oss;
-        oss << alpha << " " << newNT;
-        newRecursive.push_back(oss.str());
-    }
-    // Add an epsilon production for the new non-terminal.
-    newRecursive.push_back("ε");
-    newGrammar[newNT] = newRecursive;
+    out << table.str();
+    if (!agree)
+        cerr << "Error: parallel FIRST/FOLLOW sets differ from the sequential ones.\n";
+    return agree;
 }
 
-// Computes FIRST sets for all non-terminals in the grammar.
-// Terminals are considered symbols that do not appear as keys in the grammar map.
-    map<string, set<string>> firstSet(const map<string, vector<string>>& grammar) 
+/* Benchmark mode: generates a grammar of the requested shape and times each phase function
+   on its own, runs times each, every phase starting from the same inputs. Writes one JSON
+   object with the shape, the grammar size and per-phase min/median/mean seconds. */
+bool runBenchmark(const Options &options)
+{
+    const GrammarShape &shape = options.benchmarkShape;
+    string text = GrammarGenerator(shape).generate();
+
+    struct PhaseTiming
     {
-    
-    map<string, set<string>> first;
-    // Initialize FIRST set for each non-terminal.
-    for (const auto &rule : grammar) 
+        string name;
+        vector<double> seconds;
+    };
+    vector<PhaseTiming> timings;
+    size_t sink = 0;   // results feed this so no phase can be optimized away
+    // setup() runs untimed before every run of body().
+    auto measure = [&](const string &name, auto setup, auto body) {
+        PhaseTiming timing{name, {}};
+        for (size_t run = 0; run < options.benchmarkRuns; run++)
+        {
+            setup();
+            auto started = chrono::steady_clock::now();
+            sink += body();
+            timing.seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - started).count());
+        }
+        timings.push_back(timing);
+    };
+    auto noSetup = [] {};
+
+    SymbolTable loaded;
+    Grammar grammar;
+    SymbolTable symbols;
+    measure("parseGrammarText", [&] { loaded = SymbolTable(); }, [&] {
+        grammar = parseGrammarText(text, loaded);
+        return grammar.productionCount();
+    });
+    measure("simplifyGrammar", noSetup, [&] {
+        SimplifyReport report;
+        return simplifyGrammar(grammar, loaded.size(), report).productionCount();
+    });
+    vector<SymbolId> order = sortedByName(grammar.nonTerminals, loaded);
+
+    // Transforms create non-terminals, so each run starts from a fresh copy of the symbols.
+    Grammar factored;
+    measure("leftFactor", [&] { symbols = loaded; }, [&] {
+        GrammarBuilder builder;
+        for (SymbolId nt : order)
+            leftFactor(nt, grammar, builder, symbols);
+        factored = builder.build(grammar.startSymbol, symbols.size());
+        return factored.productionCount();
+    });
+    measure("leftFactorTrie", [&] { symbols = loaded; }, [&] {
+        GrammarBuilder builder;
+        LeftFactoringTrie trie;
+        for (SymbolId nt : order)
+            trie.factor(nt, grammar, builder, symbols);
+        return builder.build(grammar.startSymbol, symbols.size()).productionCount();
+    });
+    SymbolTable factoredSymbols = loaded;
     {
-        first[rule.first] = set<string>();
+        // Classic factoring once more, so the symbols match the grammar kept in factored.
+        GrammarBuilder builder;
+        for (SymbolId nt : order)
+            leftFactor(nt, grammar, builder, factoredSymbols);
+        factored = builder.build(grammar.startSymbol, factoredSymbols.size());
     }
-    
-    bool changed = true;
-    while (changed) 
+    vector<SymbolId> factoredOrder = sortedByName(factored.nonTerminals, factoredSymbols);
+    Grammar finalGrammar;
+    measure("leftRecursion", [&] { symbols = factoredSymbols; }, [&] {
+        GrammarBuilder builder;
+        LeftRecursionEliminator eliminator;
+        vector<RecursionReport> reports;
+        eliminator.eliminate(factored, factoredOrder, builder, symbols, reports);
+        finalGrammar = builder.build(factored.startSymbol, symbols.size());
+        return finalGrammar.productionCount();
+    });
+
+    TerminalIndex terminals(finalGrammar, symbols);
+    SymbolSets referenceFirst, referenceFollow;
+    NullableSet nullable;
+    TerminalSets first, follow;
+    measure("firstSet", noSetup, [&] {
+        referenceFirst = firstSet(finalGrammar, symbols);
+        return referenceFirst.size();
+    });
+    measure("computeNullable", noSetup, [&] {
+        nullable = computeNullable(finalGrammar, symbols);
+        return static_cast<size_t>(nullable.test(finalGrammar.startSymbol));
+    });
+    measure("firstSetWorklist", noSetup, [&] {
+        first = firstSetWorklist(finalGrammar, symbols, terminals, nullable);
+        return first.size();
+    });
+    optional<SuffixFirstSets> suffixes;
+    measure("SuffixFirstSets", noSetup, [&] {
+        suffixes.emplace(finalGrammar, symbols, terminals, first, nullable);
+        return suffixes->distinctSets();
+    });
+    measure("SuffixFirstSets(shared)", noSetup, [&] {
+        return SuffixFirstSets(finalGrammar, symbols, terminals, first, nullable, true).distinctSets();
+    });
+    measure("computeFollowSets", noSetup, [&] {
+        referenceFollow = computeFollowSets(finalGrammar, referenceFirst, symbols, finalGrammar.startSymbol);
+        return referenceFollow.size();
+    });
+    measure("followSetWorklist", noSetup, [&] {
+        follow = followSetWorklist(finalGrammar, *suffixes, symbols, terminals, finalGrammar.startSymbol);
+        return follow.size();
+    });
+    measure("computeFirstOfString", noSetup, [&] {
+        size_t total = 0;
+        for (size_t p = 0; p < finalGrammar.productionCount(); p++)
+            total += computeFirstOfString(finalGrammar.rhs(p), referenceFirst, symbols).size();
+        return total;
+    });
+    measure("firstOfSequence", noSetup, [&] {
+        size_t total = 0;
+        for (size_t p = 0; p < finalGrammar.productionCount(); p++)
+            total += firstOfSequence(finalGrammar.rhs(p), first, nullable, symbols, terminals).test(EPSILON_BIT);
+        return total;
+    });
+    measure("buildLL1Table", noSetup, [&] {
+        LL1Table table = buildLL1Table(finalGrammar, follow, terminals,
+                                       [&](uint32_t p) { return suffixes->production(p); });
+        return table.conflicts.size();
+    });
+
+    ofstream file;
+    if (!options.benchmarkOut.empty())
     {
-        changed = false;
-        // For each non-terminal X.
-        for (const auto &rule : grammar) 
+        file.open(options.benchmarkOut);
+        if (!file)
         {
-            const string &X = rule.first;
-            // Process each production for X.
-            for (const auto &prod : rule.second) 
-            {
-                vector<string> tokens = split(prod, ' ');
-                if (tokens.empty())
-                    continue;
-                
-                bool addEpsilon = true;
-                // Process each symbol in the production.
-                for (const auto &token : tokens) 
-                {
-                    // If token is epsilon.
-                    if (token == "ε") 
-                    {
-                        if (first[X].insert("ε").second)
-                            changed = true;
-                        addEpsilon = false;
-                        break;
-                    }
-                    // If token is terminal (not found as a key in grammar).
-                    if (grammar.find(token) == grammar.end()) 
-                    {
-                        if (first[X].insert(token).second)
-                            changed = true;
-                        addEpsilon = false;
-                        break;
-                    }
-                    // Token is a non-terminal: add its FIRST set (excluding ε).
-                    for (const auto &sym : first[token]) 
-                    {
-                        if (sym != "ε" && first[X].insert(sym).second)
-                            changed = true;
-                    }
-                    // If token's FIRST set does not include ε, stop.
-                    if (first[token].find("ε") == first[token].end()) 
-                    {
-                        addEpsilon = false;
-                        break;
-                    }
-                }
-                // If all symbols can derive ε, add ε to FIRST(X).
-                if (addEpsilon) 
-                {
-                    if (first[X].insert("ε").second)
-                        changed = true;
-                }
-            }
+            cerr << "Error: Unable to open benchmark output " << options.benchmarkOut << ".\n";
+            return false;
         }
     }
-    
-    return first;
+    ostream &out = options.benchmarkOut.empty() ? cout : file;
+    out << "{\n  \"shape\": {\"nts\": " << shape.nonTerminals << ", \"alts\": " << shape.alternatives
+        << ", \"len\": " << shape.rhsLength << ", \"terms\": " << shape.terminals
+        << ", \"nullable\": " << shape.nullableDensity << ", \"leftrec\": " << shape.leftRecursionRatio
+        << ", \"prefix\": " << shape.sharedPrefixRatio << ", \"seed\": " << shape.seed << "},\n";
+    out << "  \"grammar\": {\"nonTerminals\": " << grammar.nonTerminals.size() << ", \"productions\": "
+        << grammar.productionCount() << ", \"symbols\": " << grammar.rhsSymbols.size()
+        << ", \"finalNonTerminals\": " << finalGrammar.nonTerminals.size() << ", \"finalProductions\": "
+        << finalGrammar.productionCount() << ", \"terminals\": " << terminals.size() << "},\n";
+    out << "  \"runs\": " << options.benchmarkRuns << ",\n  \"phases\": [\n";
+    out << setprecision(9);
+    for (size_t i = 0; i < timings.size(); i++)
+    {
+        vector<double> sorted = timings[i].seconds;
+        sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double s : sorted)
+            total += s;
+        out << "    {\"name\": \"" << timings[i].name << "\", \"minSeconds\": " << sorted.front()
+            << ", \"medianSeconds\": " << sorted[sorted.size() / 2] << ", \"meanSeconds\": "
+            << total / sorted.size() << "}" << (i + 1 < timings.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"checksum\": " << sink << "\n}\n";
+    return true;
 }
 
-// Computes FOLLOW sets for all non-terminals using the previously computed FIRST sets.
-// FOLLOW set contains terminals that can immediately follow a non-terminal in some production.
-map<string, set<string>> computeFollowSets(
-    const map<string, vector<string>>& grammar, const map<string, set<string>>& first, const string& startSymbol) 
-    {
-    
-    map<string, set<string>> follow;
-    // Initialize FOLLOW sets.
-    for (const auto &rule : grammar) 
-    {
-        follow[rule.first] = set<string>();
-    }
-    // Start symbol always includes the end-of-input marker.
-    follow[startSymbol].insert("$");
-    
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        // For every production A -> α.
-        for (const auto &rule : grammar) 
+/* Fuzz mode: runs every engine on random grammars (see engine_fuzzer.h) and prints, per size
+   decade, the time each took and its speedup over the reference engine, then every mismatch.
+   Returns false if any engine disagreed with the reference or failed. */
+bool runFuzz(const Options &options)
+{
+    FuzzOptions fuzz = options.fuzzOptions;
+    fuzz.analysis = options.analysis;
+    fuzz.threads = options.analysis.threads;
+    EngineFuzzer fuzzer(fuzz);
+    FuzzReport report;
+    string error;
+    if (!fuzzer.run(report, error))
+    {
+        cerr << "Error: " << error;
+        if (error.empty() || error.back() != '\n')
+            cerr << "\n";
+        return false;
+    }
+
+    cout << "Fuzz: " << report.grammars << " grammars from seed " << fuzz.seed << ", up to " << fuzz.maxNonTerminals
+         << " non-terminals; " << report.comparisons << " bits and cells compared with the reference, "
+         << report.incrementalUpdates << " edits updated incrementally.\n";
+    ostringstream table;
+    table << fixed << setprecision(3);
+    table << left << setw(16) << "Non-terminals" << right << setw(10) << "Grammars" << setw(13) << "Productions";
+    for (size_t e = 0; e < FUZZ_ENGINE_COUNT; e++)
+        table << setw(e == 0 ? 14 : 24) << string(fuzzEngineName(static_cast<FuzzEngine>(e))) + " ms";
+    table << "\n";
+    for (const FuzzBucket &bucket : report.buckets)
+    {
+        table << left << setw(16) << to_string(bucket.low) + "-" + to_string(bucket.high - 1) << right << setw(10)
+              << bucket.grammars << setw(13) << bucket.productions << setw(14) << bucket.seconds[0] * 1000;
+        for (size_t e = 1; e < FUZZ_ENGINE_COUNT; e++)
         {
-            const string &A = rule.first;
-            for (const auto &prod : rule.second) 
-            {
-                vector<string> tokens = split(prod, ' ');
-                // Iterate over the symbols in the production.
-                for (size_t i = 0; i < tokens.size(); i++) 
-                {
-                    const string &B = tokens[i];
-                    // Process only if B is a non-terminal.
-                    if (grammar.find(B) != grammar.end()) 
-                    {
-                        size_t j = i + 1;
-                        bool addFollowA = false;
-                        // Examine the subsequent symbols.
-                        while (true) 
-                        {
-                            if (j < tokens.size()) 
-                            {
-                                const string &beta = tokens[j];
-                                // If beta is a terminal, add it directly to FOLLOW(B).
-                                if (grammar.find(beta) == grammar.end()) 
-                                {
-                                    if (follow[B].insert(beta).second)
-                                        changed = true;
-                                    break;
-                                }
-                                // If beta is a non-terminal, add FIRST(beta) excluding ε.
-                                for (const auto &sym : first.at(beta)) 
-                                {
-                                    if (sym != "ε" && follow[B].insert(sym).second)
-                                        changed = true;
-                                }
-                                // If FIRST(beta) does not contain ε, break out.
-                                if (first.at(beta).find("ε") == first.at(beta).end()) 
-                                {
-                                    break;
-                                }
-                                // Otherwise, beta can derive ε; check next symbol.
-                                j++;
-                                if (j > tokens.size() - 1)
-                                    addFollowA = true;
-                            } 
-                            else 
-                            {
-                                // No symbol after B; set flag to add FOLLOW(A) to FOLLOW(B).
-                                addFollowA = true;
-                                break;
-                            }
-                        }
-                        // If needed, add FOLLOW(A) to FOLLOW(B).
-                        if (addFollowA) 
-                        {
-                            for (const auto &sym : follow[A]) 
-                            {
-                                if (follow[B].insert(sym).second)
-                                    changed = true;
-                            }
-                        }
-                    }
-                }
-            }
+            ostringstream speedup;
+            speedup << fixed << setprecision(2) << " (" << (bucket.seconds[e] > 0 ? bucket.seconds[0] / bucket.seconds[e] : 0.0)
+                    << "x)";
+            table << setw(14) << bucket.seconds[e] * 1000 << left << setw(e + 1 < FUZZ_ENGINE_COUNT ? 10 : 0)
+                  << speedup.str() << right;
         }
+        table << "\n";
     }
-    
-    return follow;
+    cout << table.str();
+
+    for (const FuzzMismatch &mismatch : report.mismatches)
+        cerr << "Mismatch: " << fuzzEngineName(mismatch.engine) << " engine on grammar " << mismatch.seed << ": "
+             << mismatch.difference << " (repeat with --fuzz=1 --fuzz-seed=" << mismatch.seed << " --fuzz-nts="
+             << fuzz.maxNonTerminals << ").\n";
+    if (report.mismatches.empty())
+        cout << "Every engine agrees with the reference.\n";
+    return report.mismatches.empty();
 }
 
-// Helper function: Computes FIRST set for a sequence of tokens (right-hand side of a production).
-set<string> computeFirstOfString(const vector<string>& tokens, const map<string, set<string>>& first, const map<string, vector<string>>& grammar) 
+/* Prints whether tokens were accepted and the parser's throughput. */
+void writeParseResult(const TokenStream &tokens, const ParseResult &parse, const SymbolTable &symbols)
 {
-    
-    set<string> result;
-    bool allEpsilon = true;
-    for (const auto &token : tokens) 
+    size_t tokenCount = tokens.columns.size() - 1;
+    if (parse.accepted)
+        cout << "Parse accepted: " << tokenCount << " tokens";
+    else
     {
-        // If token is terminal.
-        if (grammar.find(token) == grammar.end()) 
-        {
-            result.insert(token);
-            allEpsilon = false;
-            break;
-        } 
-        else 
-        {
-            // Token is non-terminal: add its FIRST set except ε.
-            for (const auto &sym : first.at(token)) 
-            {
-                if (sym != "ε")
-                    result.insert(sym);
-            }
-            // If token cannot derive ε, stop.
-            if (first.at(token).find("ε") == first.at(token).end()) 
-            {
-                allEpsilon = false;
-                break;
-            }
-        }
+        cout << "Parse error at token " << parse.errorToken + 1 << " ('" << tokens.lexeme(parse.errorToken) << "'): ";
+        if (parse.expected == NO_SYMBOL)
+            cout << "input continues after the parse ended";
+        else
+            cout << (parse.diverged ? "endless expansion of " : "cannot match ") << symbols.name(parse.expected);
+        cout << " after " << parse.tokensConsumed << " tokens";
     }
-    if (allEpsilon)
-        result.insert("ε");
-    return result;
+    cout << " in " << parse.seconds * 1e3 << " ms (" << (parse.seconds > 0 ? parse.tokensConsumed / parse.seconds : 0)
+         << " tokens/s, stack depth " << parse.maxDepth << ").\n";
 }
 
-int main() 
+/* --parse-threads: parses tokens again in chunks split at a sync terminal, on threads
+   threads, and prints how the chunks went and the speedup over the sequential parse. */
+void writeChunkedParse(const TokenStream &tokens, const ParseResult &sequential, const AnalysisResult &result,
+                       size_t threads)
 {
-    // Open the input file containing the grammar.
-    ifstream infile("grammar.txt");
-    if (!infile) {
-        std::cerr << "Error: Unable to open grammar file.\n";
-        return 1;
+    ChunkedParser parser(result.finalGrammar, result.parsingTable, result.terminals, result.nullable, result.followSets);
+    ChunkReport report;
+    ParseResult parse = parser.parse(tokens, threads, report);
+    if (report.sync.list == NO_SYMBOL)
+        cout << "Chunked parse: no sync terminal to split at";
+    else
+        cout << "Chunked parse: " << report.chunks << " chunks split at '" << result.symbols.name(report.sync.terminal)
+             << "' in " << result.symbols.name(report.sync.list) << ", " << report.segments << " segments ("
+             << report.continued << " continued, " << report.reparsed << " reparsed)";
+    cout << " on " << report.threads << " threads in " << parse.seconds * 1e3 << " ms (split "
+         << report.splitSeconds * 1e3 << ", chunks " << report.parallelSeconds * 1e3 << ", stitch "
+         << report.stitchSeconds * 1e3 << "), " << (parse.seconds > 0 ? sequential.seconds / parse.seconds : 0)
+         << "x sequential.\n";
+    if (parse.accepted != sequential.accepted || parse.tokensConsumed != sequential.tokensConsumed ||
+        parse.expected != sequential.expected)
+        cerr << "Warning: chunked parse disagrees with the sequential parse.\n";
+}
+
+/* --recover: parses tokens again with panic-mode recovery and lists the errors found. */
+void writeRecoveredParse(const TokenStream &tokens, const AnalysisResult &result, size_t capacity)
+{
+    RecoveringParser parser(result.finalGrammar, result.parsingTable, result.terminals, result.followSets);
+    SyntaxErrorBuffer errors(capacity);
+    ParseResult parse = parser.parse(tokens, errors);
+    cout << "Recovering parse: " << errors.total << " errors in " << parse.seconds * 1e3 << " ms ("
+         << (parse.seconds > 0 ? (tokens.columns.size() - 1) / parse.seconds : 0) << " tokens/s).\n";
+    const size_t listed = 20;
+    for (size_t i = 0; i < errors.errors.size() && i < listed; i++)
+    {
+        const SyntaxError &error = errors.errors[i];
+        cout << "  token " << error.token + 1 << " ('" << tokens.lexeme(error.token) << "'): expected "
+             << result.symbols.name(error.expected) << "; skipped " << error.skipped << " tokens, dropped "
+             << error.popped << " symbols\n";
+    }
+    if (errors.total > listed)
+        cout << "  ... and " << errors.total - listed << " more\n";
+}
+
+/* Parse outputs beyond accept/reject: --recover lists every error, --parse-threads re-parses
+   in chunks, --parse-tree builds the arena tree and --parse-events records the event stream.
+   The last three report their time relative to the plain parse, the last two also their
+   memory per token. */
+void writeParseOutputs(const Options &options, const TokenStream &tokens, const ParseResult &plain,
+                       const AnalysisResult &result)
+{
+    if (options.recoverErrors > 0)
+        writeRecoveredParse(tokens, result, options.recoverErrors);
+    if (options.parseThreads > 0)
+        writeChunkedParse(tokens, plain, result, options.parseThreads);
+    size_t tokenCount = max<size_t>(1, tokens.columns.size() - 1);
+    auto report = [&](const char *what, size_t items, size_t itemBytes, size_t reserved, double seconds) {
+        cout << what << items << " of " << itemBytes << " bytes, " << double(items * itemBytes) / tokenCount
+             << " bytes/token (" << double(reserved) / tokenCount << " reserved) in " << seconds * 1e3 << " ms, "
+             << (plain.seconds > 0 ? seconds / plain.seconds : 0) << "x the plain parse.\n";
+    };
+    PredictiveParser parser(result.finalGrammar, result.parsingTable, result.terminals);
+    if (options.parseTree)
+    {
+        auto started = chrono::steady_clock::now();
+        ParseTree tree;
+        ParseTreeBuilder builder(tree, tokenCount);
+        parser.parse(tokens, builder);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        report("Parse tree: nodes ", tree.nodes.size(), sizeof(ParseNode), tree.bytes(), seconds);
+    }
+    if (options.parseEvents)
+    {
+        auto started = chrono::steady_clock::now();
+        ParseEventLog events(tokenCount);
+        parser.parse(tokens, events);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        report("Parse events: ", events.log.size(), sizeof(ParseEvent), events.bytes(), seconds);
+    }
+}
+
+/* Parses a token file with the table and prints the outcome and throughput. */
+bool parseTokenFile(const Options &options, const AnalysisResult &result)
+{
+    const string &path = options.tokenFile;
+    TokenStream tokens;
+    if (!loadTokenFile(path, result.symbols, result.terminals, tokens))
+    {
+        cerr << "Error: Unable to open token file " << path << ".\n";
+        return false;
+    }
+    if (tokens.unknownTokens > 0)
+        cerr << "Warning: " << tokens.unknownTokens << " tokens match no terminal of the grammar.\n";
+    PredictiveParser parser(result.finalGrammar, result.parsingTable, result.terminals);
+    ParseResult parse = parser.parse(tokens);
+    writeParseResult(tokens, parse, result.symbols);
+    writeParseOutputs(options, tokens, parse, result);
+    return true;
+}
+
+/* --lex: generates the DFA lexer from --lexer-spec, lexes the source file straight into table
+   columns, parses them and prints the automaton sizes and lex, parse and end-to-end MB/s. */
+bool lexAndParse(const Options &options, const AnalysisResult &result)
+{
+    MappedFile specFile, sourceFile;
+    if (!specFile.open(options.lexerSpec))
+    {
+        cerr << "Error: Unable to open lexer specification " << options.lexerSpec << ".\n";
+        return false;
+    }
+    if (!sourceFile.open(options.sourceFile))
+    {
+        cerr << "Error: Unable to open source file " << options.sourceFile << ".\n";
+        return false;
+    }
+    auto started = chrono::steady_clock::now();
+    DfaLexer lexer;
+    if (!lexer.build(specFile.text()))
+    {
+        cerr << "Error: " << options.lexerSpec << ": " << lexer.error() << ".\n";
+        return false;
+    }
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    if (options.lexScanSet)
+        lexer.setScanLevel(options.lexScan);
+    cout << "Lexer: " << lexer.ruleCount() << " rules, " << lexer.nfaStates() << " NFA states, "
+         << lexer.dfaStates() << " DFA states, " << lexer.states() << " after minimization, "
+         << lexer.classes() << " byte classes, " << lexer.tableBytes() << " table bytes, built in "
+         << buildSeconds * 1e3 << " ms.\n";
+    cout << "Scanning: " << scanLevelName(lexer.scanLevel()) << ", " << lexer.runStates()
+         << " states with vectorized runs.\n";
+
+    string_view text = sourceFile.text();
+    double megabytes = text.size() / 1e6;
+    TokenStream tokens;
+    LexResult lexed = lexer.tokenize(text, result.symbols, result.terminals, tokens);
+    if (!lexed.ok)
+    {
+        size_t line = 1 + count(text.begin(), text.begin() + lexed.errorOffset, '\n');
+        size_t lineStart = text.rfind('\n', lexed.errorOffset == 0 ? 0 : lexed.errorOffset - 1);
+        size_t column = lexed.errorOffset - (lineStart == string_view::npos ? 0 : lineStart + 1) + 1;
+        cout << "Lexical error at line " << line << ", column " << column << ": no rule matches '"
+             << text.substr(lexed.errorOffset, 10) << "'.\n";
+        return true;
+    }
+    cout << "Lexed " << lexed.tokens << " tokens from " << text.size() << " bytes in " << lexed.seconds * 1e3
+         << " ms (" << (lexed.seconds > 0 ? megabytes / lexed.seconds : 0) << " MB/s).\n";
+    if (tokens.unknownTokens > 0)
+        cerr << "Warning: " << tokens.unknownTokens << " tokens match no terminal of the grammar.\n";
+    PredictiveParser parser(result.finalGrammar, result.parsingTable, result.terminals);
+    ParseResult parse = parser.parse(tokens);
+    writeParseResult(tokens, parse, result.symbols);
+    double total = lexed.seconds + parse.seconds;
+    cout << "Lex+parse: " << total * 1e3 << " ms (" << (total > 0 ? megabytes / total : 0) << " MB/s).\n";
+    writeParseOutputs(options, tokens, parse, result);
+    return true;
+}
+
+/* --serve: answers analyze requests on stdin/stdout or on a Unix domain socket (grammar_service.h). */
+bool runService(const Options &options)
+{
+    GrammarService service(options.analysis, options.outputFormat, options.outputSections);
+    if (options.serveSocket.empty())
+    {
+        service.serve(stdin, stdout);
+        return true;
+    }
+    if (!service.listen(options.serveSocket))
+    {
+        cerr << "Error: Unable to listen on " << options.serveSocket << ".\n";
+        return false;
+    }
+    return true;
+}
+
+/* The grammar files of a --batch run: the regular files of a directory in name order, or the
+   non-empty lines of a list file. */
+bool batchPaths(const string &source, vector<string> &paths)
+{
+    error_code error;
+    if (filesystem::is_directory(source, error))
+    {
+        for (const auto &entry : filesystem::directory_iterator(source, error))
+            if (entry.is_regular_file(error))
+                paths.push_back(entry.path().string());
+        sort(paths.begin(), paths.end());
+        return !error;
     }
-    
-    // Read the CFG from the file. Each line is expected to be in the format:
-    // NonTerminal -> production1 | production2 | ...
-    map<string, vector<string>> grammar;
+    ifstream list(source);
+    if (!list)
+        return false;
     string line;
-    string startSymbol;
-    while (getline(infile, line)) 
+    while (getline(list, line))
     {
-        if (line.empty())
-            continue;
-        // Find the position of the arrow "->".
-        size_t arrowPos = line.find("->");
-        if (arrowPos == string::npos)
-            continue;
-        // Extract and trim the non-terminal.
-        string nonTerminal = line.substr(0, arrowPos);
-        size_t start = nonTerminal.find_first_not_of(" \t");
-        size_t end = nonTerminal.find_last_not_of(" \t");
-        if(start != string::npos && end != string::npos)
-            nonTerminal = nonTerminal.substr(start, end - start + 1);
-
-        if(startSymbol.empty())
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+            line.pop_back();
+        if (!line.empty())
+            paths.push_back(line);
+    }
+    return true;
+}
+
+/* --batch: runs the full pipeline over every grammar of the batch, --batch-jobs at a time, and
+   writes their outputs to --output one after another in batch order, each under a
+   "==> path <==" line. Prints one summary line per grammar; fails if any grammar did. */
+bool runBatch(const Options &options)
+{
+    vector<string> paths;
+    if (!batchPaths(options.batch, paths))
+    {
+        cerr << "Error: Unable to read batch " << options.batch << ".\n";
+        return false;
+    }
+    FILE *out = fopen(options.outputFile.c_str(), "wb");
+    if (!out)
+    {
+        cerr << "Error: Unable to open output file for writing.\n";
+        return false;
+    }
+    size_t workers = options.batchJobs > 0 ? options.batchJobs : max(1u, thread::hardware_concurrency());
+    auto started = chrono::steady_clock::now();
+    size_t failed = 0;
+    BatchAnalyzer batch(options.analysis, options.outputFormat, options.outputSections, workers);
+    batch.run(paths, [&](const BatchJob &job) {
+        cout << job.path << ": ";
+        if (!job.ok)
         {
-            startSymbol = nonTerminal;
+            cout << job.error << "\n";
+            failed++;
+            return;
         }
-            
-        // Extract the right-hand side productions.
-        string rhs = line.substr(arrowPos + 2);
-        vector<string> prods = split(rhs, '|');
-        grammar[nonTerminal] = prods;
-    }
-    infile.close();
-    
-    // --- Phase 1: Left Factoring ---
-    map<string, vector<string>> factoredGrammar;
-    int newNTcount = 1;  // Counter to generate unique new non-terminals.
-    for (auto &prod : grammar) 
-    {
-        leftFactor(prod.first, prod.second, factoredGrammar, newNTcount);
-    }
-    
-    // --- Phase 2: Left Recursion Removal ---
-    map<string, vector<string>> finalGrammar;
-    for (auto &prod : factoredGrammar) 
-    {
-        leftRecursion(prod.first, prod.second, finalGrammar);
-    }
-    
-    // --- Phase 3: FIRST Set Computation ---
-    map<string, set<string>> firstSets = firstSet(finalGrammar);
-    
-    // --- Phase 4: FOLLOW Set Computation ---
-    
-    
-    map<string, set<string>> followSets = computeFollowSets(finalGrammar, firstSets, startSymbol);
-    
-    // --- Phase 5: LL(1) Parsing Table Construction ---
-    // The parsing table is stored as a mapping from non-terminal to a mapping of terminal to production.
-    map<string, map<string, string>> parsingTable;
-    for (const auto &rule : finalGrammar) 
-    {
-        const string &nonTerminal = rule.first;
-        // Process each production for the non-terminal.
-        for (const auto &prod : rule.second) 
+        cout << job.nonTerminals << " non-terminals, " << job.productions << " productions, " << job.conflicts
+             << " LL(1) conflicts in " << fixed << setprecision(3) << job.seconds * 1e3 << " ms"
+             << (job.mode == AnalysisMode::Incremental ? " (incremental)" : "") << "\n";
+        cout.unsetf(ios::floatfield);
+        fprintf(out, "==> %s <==\n", job.path.c_str());
+        fwrite(job.output, 1, job.outputSize, out);
+    });
+    bool written = fclose(out) == 0;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    cout << "Batch: " << paths.size() << " grammars, " << failed << " failed, " << batch.workersFor(paths.size())
+         << " workers, " << fixed << setprecision(3) << seconds * 1e3 << " ms. Check " << options.outputFile
+         << " for results.\n";
+    if (!written)
+        cerr << "Error: Unable to write " << options.outputFile << ".\n";
+    return written && failed == 0;
+}
+
+/* --lr: builds the LR(0) automaton of the input grammar, which needs neither left factoring nor
+   left recursion removal, and its ACTION/GOTO table with LR(0), SLR(1) or LALR(1) lookaheads.
+   FIRST and FOLLOW come from the same bitset engines as the LL(1) phases. Prints a summary and
+   writes the states and table to --lr-output. */
+bool buildLrTable(const Options &options, const AnalysisResult &result)
+{
+    auto started = chrono::steady_clock::now();
+    const Grammar &grammar = result.inputGrammar;
+    const SymbolTable &symbols = result.symbols;
+    TerminalIndex terminals(grammar, symbols);
+    LR0Automaton automaton(grammar, symbols);
+    TerminalSets lookaheads;
+    if (options.lrMethod == LrMethod::LR0)
+        lookaheads = lr0Lookaheads(automaton, terminals);
+    else
+    {
+        NullableSet nullable = computeNullable(grammar, symbols);
+        if (options.lrMethod == LrMethod::SLR1)
         {
-            // Tokenize the production.
-            vector<string> tokens = split(prod, ' ');
-            // Compute FIRST set for the production (alpha).
-            set<string> firstAlpha = computeFirstOfString(tokens, firstSets, finalGrammar);
-            // For every terminal in FIRST(alpha) except ε, add the production to the table.
-            for (const auto &terminal : firstAlpha) 
-            {
-                if (terminal != "ε") 
-                {
-                    parsingTable[nonTerminal][terminal] = prod;
-                }
-            }
-            // If ε is in FIRST(alpha), then add the production for each terminal in FOLLOW(nonTerminal).
-            if (firstAlpha.find("ε") != firstAlpha.end()) 
-            {
-                for (const auto &terminal : followSets[nonTerminal]) 
-                {
-                    parsingTable[nonTerminal][terminal] = prod;
-                }
-            }
+            TerminalSets first = firstSetWorklist(grammar, symbols, terminals, nullable);
+            SuffixFirstSets suffixes(grammar, symbols, terminals, first, nullable);
+            lookaheads = slrLookaheads(automaton, followSetWorklist(grammar, suffixes, symbols, terminals,
+                                                                    grammar.startSymbol));
         }
+        else
+            lookaheads = lalrLookaheads(automaton, grammar, symbols, terminals, nullable);
     }
-    
-    // --- Output all results to output.txt ---
-    std::ofstream outfile("output.txt");
-    if (!outfile) {
-        std::cerr << "Error: Unable to open output file for writing.\n";
-        return 1;
+    LrTable table(automaton, grammar, symbols, terminals, lookaheads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    size_t shiftReduce = 0;
+    for (const LrConflict &conflict : table.conflicts)
+        shiftReduce += LrTable::kind(conflict.kept) != LrTable::REDUCE || LrTable::kind(conflict.rejected) != LrTable::REDUCE;
+    const PackedTable &actions = table.packedActions();
+    const PackedTable &gotos = table.packedGotos();
+    cout << lrMethodName(options.lrMethod) << ": " << automaton.stateCount() << " states, " << automaton.transitionCount()
+         << " transitions, " << shiftReduce << " shift/reduce and " << table.conflicts.size() - shiftReduce
+         << " reduce/reduce conflicts in " << fixed << setprecision(3) << seconds * 1e3 << " ms.\n";
+    cout.unsetf(ios::floatfield);
+    cout << "  ACTION " << actions.rowCount() << "x" << actions.columns() << ": "
+         << actions.rowCount() * actions.columns() * sizeof(uint32_t) << " bytes dense, " << actions.bytes()
+         << " bytes packed (" << actions.slots() << " slots)\n";
+    cout << "  GOTO   " << gotos.rowCount() << "x" << gotos.columns() << ": "
+         << gotos.rowCount() * gotos.columns() * sizeof(uint32_t) << " bytes dense, " << table.gotoBytes()
+         << " bytes packed (" << gotos.slots() << " slots and a default per column)\n";
+
+    FILE *out = fopen(options.lrOutput.c_str(), "wb");
+    bool written = out && writeLrTable(out, options.lrMethod, automaton, table, grammar, symbols, terminals);
+    if (out)
+        written = fclose(out) == 0 && written;
+    if (!written)
+    {
+        cerr << "Error: Unable to write " << options.lrOutput << ".\n";
+        return false;
     }
-    
-    // Output grammar after left factoring.
-    outfile << "Grammar after Left Factoring:\n";
-    for (auto &nt : factoredGrammar) 
+    return true;
+}
+
+/* --emit-header: writes the tables of the analysis as a header for static_parser.h. The
+   namespace defaults to the file name with every character that cannot appear in an
+   identifier replaced by '_'. */
+bool emitHeader(const Options &options, const AnalysisResult &result)
+{
+    string nameSpace = options.headerNamespace;
+    if (nameSpace.empty())
     {
-        outfile << nt.first << " -> ";
-        for (size_t i = 0; i < nt.second.size(); i++) 
-        {
-            outfile << nt.second[i];
-            if (i != nt.second.size() - 1)
-                outfile << " | ";
-        }
-        outfile << "\n";
+        nameSpace = filesystem::path(options.headerFile).stem().string();
+        for (char &c : nameSpace)
+            if (!isalnum(static_cast<unsigned char>(c)))
+                c = '_';
+        if (!usableIdentifier(nameSpace))
+            nameSpace = "grammar_" + nameSpace;
+        if (!usableIdentifier(nameSpace))
+            nameSpace = "grammar";
     }
-    
-    // Output grammar after left recursion removal.
-    outfile << "\nGrammar after Left Recursion Removal:\n";
-    for (auto &nt : finalGrammar) 
+    FILE *out = fopen(options.headerFile.c_str(), "wb");
+    bool written = out && HeaderWriter(result, nameSpace).write(out);
+    if (out)
+        written = fclose(out) == 0 && written;
+    if (!written)
     {
-        outfile << nt.first << " -> ";
-        for (size_t i = 0; i < nt.second.size(); i++) 
-        {
-            outfile << nt.second[i];
-            if (i != nt.second.size() - 1)
-                outfile << " | ";
-        }
-        outfile << "\n";
+        cerr << "Error: Unable to write " << options.headerFile << ".\n";
+        return false;
     }
-    
-    // Output FIRST sets.
-    outfile << "\nFIRST Sets:\n";
-    for (auto &entry : firstSets) 
+    cout << "Wrote " << options.headerFile << " (namespace " << nameSpace << ", " << result.parsingTable.rowCount() << "x"
+         << result.parsingTable.columnCount() << " table).\n";
+    return true;
+}
+
+/* --lookahead: simulates the productions of every conflicting LL(1) cell over a trie of
+   lookahead sequences, up to K tokens, and writes the verdicts, examples and LL(k) decision
+   table to --lookahead-output. */
+bool analyzeLookahead(const Options &options, const AnalysisResult &result)
+{
+    auto started = chrono::steady_clock::now();
+    LookaheadAnalyzer analyzer(result.finalGrammar, result.parsingTable, result.terminals, result.nullable,
+                               result.firstSets, result.followSets);
+    vector<LookaheadCell> cells = analyzer.analyze(options.lookahead);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    vector<size_t> resolvedAt(options.lookahead.maxTokens + 1, 0);
+    size_t notLLk = 0, ambiguous = 0, overBudget = 0, decisions = 0;
+    for (const LookaheadCell &cell : cells)
     {
-        outfile << "FIRST(" << entry.first << ") = { ";
-        bool firstElem = true;
-        for (const auto &sym : entry.second) 
-        {
-            if (!firstElem)
-                outfile << ", ";
-            outfile << sym;
-            firstElem = false;
-        }
-        outfile << " }\n";
+        decisions += cell.decisions.size();
+        if (cell.verdict == LookaheadVerdict::Resolved)
+            resolvedAt[cell.depth]++;
+        notLLk += cell.verdict == LookaheadVerdict::NotLLk;
+        ambiguous += cell.verdict == LookaheadVerdict::Ambiguous;
+        overBudget += cell.verdict == LookaheadVerdict::OverBudget;
     }
-    
-    // Output FOLLOW sets.
-    outfile << "\nFOLLOW Sets:\n";
-    for (auto &entry : followSets) 
+    cout << "Lookahead: " << cells.size() << " conflicting cells";
+    for (size_t k = 2; k < resolvedAt.size(); k++)
+        if (resolvedAt[k] > 0)
+            cout << ", " << resolvedAt[k] << " LL(" << k << ")";
+    cout << ", " << notLLk << " not LL(" << options.lookahead.maxTokens << "), " << ambiguous << " ambiguous, "
+         << overBudget << " over budget; " << decisions << " decision entries in " << fixed << setprecision(3)
+         << seconds * 1e3 << " ms.\n";
+    cout.unsetf(ios::floatfield);
+
+    FILE *out = fopen(options.lookaheadOutput.c_str(), "wb");
+    bool written = out && writeLookaheadReport(out, cells, analyzer, options.lookahead, result.finalGrammar, result.symbols);
+    if (out)
+        written = fclose(out) == 0 && written;
+    if (!written)
     {
-        outfile << "FOLLOW(" << entry.first << ") = { ";
-        bool firstElem = true;
-        for (const auto &sym : entry.second) 
+        cerr << "Error: Unable to write " << options.lookaheadOutput << ".\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return 1;
+
+    if (options.benchmark)
+        return runBenchmark(options) ? 0 : 1;
+
+    if (options.fuzz)
+        return runFuzz(options) ? 0 : 1;
+
+    if (options.serve)
+        return runService(options) ? 0 : 1;
+
+    if (!options.batch.empty())
+        return runBatch(options) ? 0 : 1;
+
+    // Map the input file containing the grammar; it is hashed and tokenized in place.
+    MappedFile grammarFile;
+    if (!grammarFile.open("grammar.txt")) {
+        std::cerr << "Error: Unable to open grammar file.\n";
+        return 1;
+    }
+    string_view grammarText = grammarFile.text();
+
+    // A cache written for the same grammar text replaces all five phases. --check-engines
+    // needs the phases to run, so it always bypasses the cache.
+    AnalysisResult cachedResult;
+    // Options that change the analysis are part of the key.
+    string config = options.analysis.key();
+    uint64_t grammarHash = hashGrammarText(grammarText, config);
+    uint64_t configHash = hashGrammarText("", config);
+    bool cached = !options.cacheFile.empty() && !options.analysis.checkEngines &&
+                  GrammarCache::load(options.cacheFile, grammarHash, cachedResult);
+    GrammarAnalyzer analyzer(options.analysis);
+    if (cached)
+        cout << "Loaded analysis from cache " << options.cacheFile << ".\n";
+    else
+    {
+        // --incremental: the cache written for an earlier version of the grammar is updated.
+        AnalysisResult previous;
+        if (options.analysis.updatesIncrementally() && !options.cacheFile.empty() &&
+            GrammarCache::loadPrevious(options.cacheFile, configHash, previous))
+            analyzer.setBaseline(std::move(previous));
+        if (!analyzer.analyze(grammarText))
         {
-            if (!firstElem)
-                outfile << ", ";
-            outfile << sym;
-            firstElem = false;
+            cerr << analyzer.error();
+            return 1;
         }
-        outfile << " }\n";
-    }
-    
-    // Output LL(1) Parsing Table.
-    outfile << "\nLL(1) Parsing Table:\n\n";
-    // Set column width for table formatting.
-    const int colWidth = 20;
-    
-    // Gather all terminals that appear in the parsing table.
-    set<string> terminals;
-    for (const auto &row : parsingTable) 
-    {
-        for (const auto &entry : row.second)
-            terminals.insert(entry.first);
-    }
-    
-    // Print header row with fixed width columns.
-    outfile << std::setw(colWidth) << "Non-Terminal";
-    for (const auto &t : terminals) {
-        outfile << std::setw(colWidth) << t;
-    }
-    outfile << "\n";
-    
-    // Print separator line.
-    outfile << string(colWidth * (terminals.size() + 1), '-') << "\n";
-    
-    // Print each row of the parsing table.
-    for (const auto &row : parsingTable) {
-        outfile << std::setw(colWidth) << row.first;
-        for (const auto &t : terminals) {
-            // Print production if it exists; otherwise, print an empty column.
-            if (row.second.find(t) != row.second.end())
-                outfile << std::setw(colWidth) << row.second.at(t);
-            else
-                outfile << std::setw(colWidth) << "";
-        }
-        outfile << "\n";
+        if (analyzer.triedIncremental())
+            writeIncrementalReport(cout, analyzer);
+        if (options.analysis.checkEngines)
+            cout << "FIRST/FOLLOW engines agree on " << analyzer.result().finalGrammar.nonTerminals.size() << " non-terminals.\n";
+        writeSimplifyReport(cout, analyzer.result());
+        writeRecursionReport(cout, analyzer.result());
+        if (options.memoryReport)
+            writeMemoryReport(cout, analyzer.memory());
+        if (options.stats)
+            writeStats(cout, analyzer.loadStats(), analyzer.stats(), options.statsJson);
+        if (!options.cacheFile.empty() && !GrammarCache::save(options.cacheFile, grammarHash, configHash, analyzer.result()))
+            cerr << "Warning: Unable to write grammar cache " << options.cacheFile << ".\n";
+    }
+    const AnalysisResult &result = cached ? cachedResult : analyzer.result();
+    if (!result.parsingTable.conflicts.empty())
+    {
+        cerr << "Warning: grammar is not LL(1); " << result.parsingTable.conflicts.size()
+             << " conflicting table entries are listed in " << options.outputFile << ".\n";
+    }
+
+    if (options.threadScaling)
+    {
+        size_t maxThreads = options.analysis.threads > 0 ? options.analysis.threads : max(1u, thread::hardware_concurrency());
+        if (!writeThreadScaling(cout, result, maxThreads))
+            return 1;
+    }
+
+    if (options.lrMethod != LrMethod::None && !buildLrTable(options, result))
+        return 1;
+    if (!options.headerFile.empty() && !emitHeader(options, result))
+        return 1;
+    if (options.lookaheadAnalysis && !analyzeLookahead(options, result))
+        return 1;
+
+    // Optionally parse a token stream with the table that was just built.
+    if (!options.tokenFile.empty() && !parseTokenFile(options, result))
+        return 1;
+    if (!options.sourceFile.empty() && !lexAndParse(options, result))
+        return 1;
+
+    // --- Output all results to output.txt ---
+    AnalysisWriter writer(result, options.outputSections);
+    if (!writer.write(options.outputFile, options.outputFormat)) {
+        std::cerr << "Error: Unable to open output file for writing.\n";
+        return 1;
     }
-    
-    outfile.close();
-    cout << "Processing complete. Check output.txt for results.\n";
+    cout << "Processing complete. Check " << options.outputFile << " for results.\n";
     return 0;
 }
@@ -0,0 +1,352 @@
+#ifndef CHUNKED_PARSER_H
+#define CHUNKED_PARSER_H
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <memory_resource>
+#include <cstdint>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "ll1_driver.h"
+#include "parallel_sets.h"
+
+/* Parallel parsing of one long token stream.
+
+   Inputs that are long lists of statements are parsed by a right-recursive list rule such as
+   Stmts -> Stmt Stmts | ε, and every top-level statement ends with a synchronization
+   terminal like ';'. Right after such a terminal the parser's stack is the list non-terminal
+   L on top of whatever context encloses the list. The parser is deterministic and only reads
+   the top of its stack, so everything it does from there until it pops L again is the same
+   whatever lies beneath L.
+
+   The stream is cut after sync terminals whose next token predicts the list production
+   again, and every chunk is parsed on its own from a stack holding just L. Stitching walks
+   the chunks in order with the real stack: where a chunk starts with L on top, its result is
+   exact and its final stack replaces L. A chunk that ends the list (it pops L) is continued
+   from that token with the real stack, and a chunk whose start was not really at the top
+   level (a ';' inside a nested construct) is parsed again sequentially. The outcome is always
+   the one PredictiveParser gives for the whole stream.
+
+   Sync candidates come from the grammar: for each production L -> α L, every terminal a
+   derivation of α can end with. Terminals in FOLLOW(L) are left out, since after one of them
+   the list may be over rather than continuing. The candidate with the most cut points in the
+   input is used.
+*/
+
+struct SyncCandidate
+{
+    SymbolId list = NO_SYMBOL;   // right-recursive list non-terminal L
+    uint32_t production = 0;     // L -> α L
+    SymbolId terminal = NO_SYMBOL;
+    int32_t column = -1;         // table column of terminal
+};
+
+struct ChunkReport
+{
+    SyncCandidate sync;          // the candidate split on; list is NO_SYMBOL if none applied
+    size_t chunks = 1;
+    size_t segments = 0;         // a chunk is cut again after every place its guess failed
+    size_t continued = 0;        // segments that popped L and were finished with the real stack
+    size_t reparsed = 0;         // segments parsed again because their start was not top level
+    size_t threads = 1;
+    double splitSeconds = 0;     // finding the cut points
+    double parallelSeconds = 0;  // parsing the chunks
+    double stitchSeconds = 0;    // stitching, including sequential repairs
+};
+
+class ChunkedParser
+{
+public:
+    ChunkedParser(const Grammar &grammar, const LL1Table &table, const TerminalIndex &terminals,
+                  const NullableSet &nullable, const TerminalSets &follow)
+        : grammar(grammar), table(table), terminals(terminals)
+    {
+        rowOf.assign(terminals.denseOf.size(), -1);
+        for (size_t r = 0; r < table.rowCount(); r++)
+            rowOf[table.rowNonTerminal(r)] = static_cast<int32_t>(r);
+
+        // LAST(X): the terminals a derivation of X can end with, by a round-robin fixpoint
+        // (the sets are small and only built once).
+        TerminalSets last(terminals.denseOf.size(), TerminalSet(terminals.size()));
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (size_t p = 0; p < grammar.productionCount(); p++)
+                changed |= addLast(grammar.rhs(p), grammar.rhs(p).size(), nullable, last, last[grammar.prodLhs[p]]);
+        }
+
+        for (SymbolId list : grammar.nonTerminals)
+            for (uint32_t p = grammar.firstProduction(list); p < grammar.endProduction(list); p++)
+            {
+                SymbolSpan rhs = grammar.rhs(p);
+                if (rhs.size() < 2 || rhs[rhs.size() - 1] != list || table.row(list) < 0)
+                    continue;
+                TerminalSet ends(terminals.size());
+                addLast(rhs, rhs.size() - 1, nullable, last, ends);
+                ends.forEach([&](size_t column) {
+                    if (column != EPSILON_BIT && !follow[list].test(column))
+                        candidateList.push_back(SyncCandidate{list, p, terminals.symbolOf[column], static_cast<int32_t>(column)});
+                });
+            }
+        std::stable_sort(candidateList.begin(), candidateList.end(),
+                         [](const SyncCandidate &a, const SyncCandidate &b) { return a.column < b.column; });
+        candidateStart.assign(terminals.size() + 1, 0);
+        for (const SyncCandidate &candidate : candidateList)
+            candidateStart[candidate.column + 1]++;
+        for (size_t c = 0; c < terminals.size(); c++)
+            candidateStart[c + 1] += candidateStart[c];
+    }
+
+    const std::vector<SyncCandidate> &candidates() const { return candidateList; }
+
+    /* Parses input on threads threads, splitting it into about chunksPerThread chunks per
+       thread of at least minChunk tokens, at the candidate with the most cut points. */
+    ParseResult parse(const TokenStream &input, size_t threads, ChunkReport &report, size_t chunksPerThread = 8,
+                      size_t minChunk = 4096)
+    {
+        auto started = std::chrono::steady_clock::now();
+        const std::vector<int32_t> &columns = input.columns;
+        report = ChunkReport();
+        report.threads = std::max<size_t>(1, threads);
+
+        // The candidate with the most places to cut, then the cut points.
+        std::vector<size_t> starts{0};
+        size_t tokens = columns.size() - 1;
+        size_t chunks = std::min(report.threads * chunksPerThread, tokens / std::max<size_t>(1, minChunk));
+        if (!candidateList.empty() && chunks > 1)
+        {
+            // Cut points are counted in 16 windows spread over the input.
+            std::vector<size_t> cuts(candidateList.size(), 0);
+            for (size_t window = 0; window < 16; window++)
+            {
+                size_t from = tokens / 16 * window;
+                for (size_t pos = from; pos < from + 4096 && pos + 1 < tokens; pos++)
+                    if (columns[pos] >= 0)
+                        for (uint32_t c = candidateStart[columns[pos]]; c < candidateStart[columns[pos] + 1]; c++)
+                            cuts[c] += isCut(columns, pos, candidateList[c]);
+            }
+            size_t best = static_cast<size_t>(std::max_element(cuts.begin(), cuts.end()) - cuts.begin());
+            if (cuts[best] > 0)
+            {
+                report.sync = candidateList[best];
+                for (size_t c = 1; c < chunks; c++)
+                {
+                    size_t pos = nextCut(columns, std::max(starts.back(), tokens * c / chunks), tokens, report.sync);
+                    if (pos >= tokens)
+                        break;
+                    starts.push_back(pos);
+                }
+            }
+        }
+        starts.push_back(tokens);
+        size_t chunkCount = starts.size() - 1;
+        report.chunks = chunkCount;
+        auto split = std::chrono::steady_clock::now();
+        report.splitSeconds = std::chrono::duration<double>(split - started).count();
+
+        // Each chunk is parsed in segments. The first segment of the first chunk starts from
+        // the real start stack, every other one from L. A segment that fails (it pops L or
+        // hits an error, which may only be due to a wrong guess of context) ends there, and the
+        // next one starts at the following cut point.
+        std::vector<std::vector<Segment>> segments(chunkCount);
+        std::pmr::vector<uint32_t> successorStart(chunkCount + 1, 0), successors;
+        WorkStealingPool pool(std::min(report.threads, chunkCount));
+        pool.run(chunkCount, successorStart, successors, [&](size_t t) {
+            size_t end = starts[t + 1];
+            for (size_t pos = starts[t]; pos < end || (t == 0 && segments[t].empty());)
+            {
+                Segment segment;
+                segment.start = pos;
+                segment.exact = t == 0 && pos == 0;
+                if (segment.exact)
+                    segment.stack = {END_MARKER, grammar.startSymbol};
+                else
+                    segment.stack = {report.sync.list};
+                segment.outcome = run(columns, segment.stack, pos, end, false, segment.stop, segment.expected,
+                                      segment.maxDepth);
+                segment.end = segment.outcome == Outcome::Done || report.sync.list == NO_SYMBOL
+                                  ? end
+                                  : nextCut(columns, segment.stop, end, report.sync);
+                pos = segment.end;
+                segments[t].push_back(std::move(segment));
+            }
+        });
+        auto parsed = std::chrono::steady_clock::now();
+        report.parallelSeconds = std::chrono::duration<double>(parsed - split).count();
+
+        // Stitch in order with the real stack.
+        ParseResult result;
+        std::vector<SymbolId> stack;
+        Outcome outcome = Outcome::Done;
+        size_t pos = 0;
+        SymbolId expected = NO_SYMBOL;
+        for (size_t c = 0; c < chunkCount && outcome == Outcome::Done; c++)
+            for (size_t s = 0; s < segments[c].size() && outcome == Outcome::Done; s++)
+            {
+                Segment &segment = segments[c][s];
+                report.segments++;
+                bool listOnTop = !stack.empty() && stack.back() == report.sync.list;
+                if (segment.exact || (listOnTop && segment.outcome != Outcome::Underflow))
+                {
+                    // Exact: the segment's stack replaces L (or is the whole stack).
+                    if (!segment.exact)
+                        stack.pop_back();
+                    result.maxDepth = std::max(result.maxDepth, stack.size() + segment.maxDepth);
+                    stack.insert(stack.end(), segment.stack.begin(), segment.stack.end());
+                    pos = segment.stop;
+                    expected = segment.expected;
+                    outcome = segment.outcome;
+                    continue;
+                }
+                else if (listOnTop)
+                {
+                    // The segment popped L at segment.stop; everything before that is exact.
+                    result.maxDepth = std::max(result.maxDepth, stack.size() - 1 + segment.maxDepth);
+                    stack.pop_back();
+                    pos = segment.stop;
+                    report.continued++;
+                }
+                else
+                {
+                    pos = segment.start;
+                    report.reparsed++;
+                }
+                size_t depth = 0;
+                outcome = run(columns, stack, pos, segment.end, false, pos, expected, depth);
+                result.maxDepth = std::max(result.maxDepth, depth);
+            }
+        if (outcome == Outcome::Done)
+        {
+            size_t depth = 0;
+            outcome = run(columns, stack, pos, columns.size(), true, pos, expected, depth);
+            result.maxDepth = std::max(result.maxDepth, depth);
+        }
+
+        result.accepted = outcome == Outcome::Done && stack.empty() && pos == columns.size();
+        result.tokensConsumed = std::min(pos, tokens);
+        result.errorToken = pos;
+        result.expected = result.accepted ? NO_SYMBOL : expected;
+        result.diverged = outcome == Outcome::Diverged;
+        auto finished = std::chrono::steady_clock::now();
+        report.stitchSeconds = std::chrono::duration<double>(finished - parsed).count();
+        result.seconds = std::chrono::duration<double>(finished - started).count();
+        return result;
+    }
+
+private:
+    enum class Outcome
+    {
+        Done,       // reached the end of the range (or accepted, for the last one)
+        Error,      // the symbol on top can neither match nor expand
+        Underflow,  // the stack ran empty before the end of the range
+        Diverged    // an expansion cycle that matches nothing (see ExpansionCycles)
+    };
+
+    // Tokens [start, end) of a chunk, parsed from a guessed stack up to stop.
+    struct Segment
+    {
+        size_t start = 0;
+        size_t stop = 0;
+        size_t end = 0;
+        bool exact = false;          // started from the real start stack
+        std::vector<SymbolId> stack;
+        Outcome outcome = Outcome::Done;
+        SymbolId expected = NO_SYMBOL;
+        size_t maxDepth = 0;
+    };
+
+    const Grammar &grammar;
+    const LL1Table &table;
+    const TerminalIndex &terminals;
+    std::vector<int32_t> rowOf;   // indexed by SymbolId
+    std::vector<SyncCandidate> candidateList;   // grouped by column
+    std::vector<uint32_t> candidateStart;       // candidates for column c: [candidateStart[c], candidateStart[c + 1])
+
+    // The first token at or after from, and before end, that follows a cut point; end if none.
+    size_t nextCut(const std::vector<int32_t> &columns, size_t from, size_t end, const SyncCandidate &candidate) const
+    {
+        for (size_t pos = from; pos + 1 < end; pos++)
+            if (isCut(columns, pos, candidate))
+                return pos + 1;
+        return end;
+    }
+
+    // Whether the token after pos starts a chunk: pos is the sync terminal and the next token
+    // predicts the list production again.
+    bool isCut(const std::vector<int32_t> &columns, size_t pos, const SyncCandidate &candidate) const
+    {
+        if (columns[pos] != candidate.column || columns[pos + 1] < 0)
+            return false;
+        int32_t prod = table.at(static_cast<size_t>(rowOf[candidate.list]), columns[pos + 1]);
+        return prod == static_cast<int32_t>(candidate.production);
+    }
+
+    // Adds LAST of rhs[0, length) to into; false if nothing was new. A non-terminal without
+    // productions has an empty LAST set and is not nullable, so it ends the scan.
+    bool addLast(SymbolSpan rhs, size_t length, const NullableSet &nullable, const TerminalSets &last,
+                 TerminalSet &into) const
+    {
+        bool changed = false;
+        for (size_t i = length; i > 0; i--)
+        {
+            SymbolId sym = rhs[i - 1];
+            if (terminals.denseOf[sym] >= 0)
+                return into.insert(static_cast<size_t>(terminals.denseOf[sym])) || changed;
+            changed |= into.unionWith(last[sym]);
+            if (!nullable.test(sym))
+                break;
+        }
+        return changed;
+    }
+
+    /* The PredictiveParser loop on stack from token from. A range that is not last stops at
+       token end without reading it; the last one runs to the end of the input. */
+    Outcome run(const std::vector<int32_t> &columns, std::vector<SymbolId> &stack, size_t from, size_t end, bool last,
+                size_t &pos, SymbolId &expected, size_t &maxDepth) const
+    {
+        pos = from;
+        ExpansionCycles cycles;
+        cycles.reset(table.rowCount());
+        while (!stack.empty() && (last || pos < end))
+        {
+            maxDepth = std::max(maxDepth, stack.size());
+            SymbolId sym = stack.back();
+            int32_t lookahead = columns[pos];
+            int32_t row = rowOf[sym];
+            if (row < 0)
+            {
+                if (lookahead < 0 || terminals.denseOf[sym] != lookahead)
+                {
+                    expected = sym;
+                    return Outcome::Error;
+                }
+                stack.pop_back();
+                pos++;
+                cycles.matched();
+                continue;
+            }
+            int32_t prod = lookahead < 0 ? LL1Table::EMPTY : table.at(static_cast<size_t>(row), lookahead);
+            if (prod == LL1Table::EMPTY)
+            {
+                expected = sym;
+                return Outcome::Error;
+            }
+            SymbolSpan rhs = grammar.rhs(static_cast<size_t>(prod));
+            stack.pop_back();
+            if (cycles.expand(static_cast<size_t>(row), stack.size()) != ExpansionCycles::NONE)
+            {
+                stack.push_back(sym);
+                expected = sym;
+                return Outcome::Diverged;
+            }
+            for (size_t i = rhs.size(); i > 0; i--)
+                stack.push_back(rhs[i - 1]);
+        }
+        return stack.empty() && !last && pos < end ? Outcome::Underflow : Outcome::Done;
+    }
+};
+
+#endif
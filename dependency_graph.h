@@ -0,0 +1,106 @@
+#ifndef DEPENDENCY_GRAPH_H
+#define DEPENDENCY_GRAPH_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+
+/* Graph helpers shared by the grammar phases: CSR adjacency lists and strongly connected
+   components over dense node ids (SymbolIds, or component ids for condensed graphs). */
+
+const uint32_t NO_COMPONENT = UINT32_MAX;
+
+/* Groups (from, to) edges by their source into CSR form: the targets of from are
+   targets[offsets[from], offsets[from + 1]). */
+template <typename Node>
+void buildAdjacency(const std::pmr::vector<std::pair<Node, Node>> &edges, size_t nodeCount,
+                    std::pmr::vector<uint32_t> &offsets, std::pmr::vector<Node> &targets)
+{
+    offsets.assign(nodeCount + 1, 0);
+    for (const auto &edge : edges)
+        offsets[edge.first + 1]++;
+    for (size_t i = 0; i < nodeCount; i++)
+        offsets[i + 1] += offsets[i];
+    targets.resize(edges.size());
+    std::pmr::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1, offsets.get_allocator());
+    for (const auto &edge : edges)
+        targets[fill[edge.first]++] = edge.second;
+}
+
+/* Tarjan's algorithm, iterative so deep grammars cannot overflow the call stack. Visits every
+   node reachable from roots and stores its component in component[] (NO_COMPONENT elsewhere).
+   Components are numbered in reverse topological order: a component only has edges into
+   components with smaller numbers. Returns the number of components. */
+inline uint32_t stronglyConnectedComponents(const std::pmr::vector<uint32_t> &offsets,
+                                            const std::pmr::vector<SymbolId> &targets,
+                                            const std::vector<SymbolId> &roots,
+                                            std::pmr::vector<uint32_t> &component,
+                                            std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    const uint32_t UNVISITED = UINT32_MAX;
+    size_t nodeCount = offsets.size() - 1;
+    component.assign(nodeCount, NO_COMPONENT);
+    std::pmr::vector<uint32_t> index(nodeCount, UNVISITED, scratch);
+    std::pmr::vector<uint32_t> low(nodeCount, 0, scratch);
+    std::pmr::vector<uint8_t> onStack(nodeCount, 0, scratch);
+    std::pmr::vector<SymbolId> stack(scratch);
+    struct Frame
+    {
+        SymbolId node;
+        uint32_t edge;   // next outgoing edge to follow
+    };
+    std::pmr::vector<Frame> calls(scratch);
+    uint32_t nextIndex = 0;
+    uint32_t count = 0;
+
+    auto visit = [&](SymbolId v) {
+        index[v] = low[v] = nextIndex++;
+        stack.push_back(v);
+        onStack[v] = true;
+        calls.push_back(Frame{v, offsets[v]});
+    };
+
+    for (SymbolId root : roots)
+    {
+        if (index[root] != UNVISITED)
+            continue;
+        visit(root);
+        while (!calls.empty())
+        {
+            Frame &frame = calls.back();
+            SymbolId v = frame.node;
+            if (frame.edge < offsets[v + 1])
+            {
+                SymbolId w = targets[frame.edge++];
+                if (index[w] == UNVISITED)
+                    visit(w);
+                else if (onStack[w])
+                    low[v] = std::min(low[v], index[w]);
+                continue;
+            }
+            // All successors done: v roots a component if nothing below reached higher.
+            if (low[v] == index[v])
+            {
+                SymbolId w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    component[w] = count;
+                } while (w != v);
+                count++;
+            }
+            calls.pop_back();
+            if (!calls.empty())
+                low[calls.back().node] = std::min(low[calls.back().node], low[v]);
+        }
+    }
+    return count;
+}
+
+#endif
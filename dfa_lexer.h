@@ -0,0 +1,967 @@
+#ifndef DFA_LEXER_H
+#define DFA_LEXER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_driver.h"
+#include "simd_scan.h"
+
+/* Table-driven lexer generated from a token specification such as regex.txt.
+
+   Every line of the specification is a regular expression, optionally preceded by a token
+   type, as in `NUMBER = \d+`; a line without one has type TOKEN. The top-level alternatives of
+   a line are separate rules, and when two rules match the same longest lexeme the earlier one
+   wins. Lexemes of type SKIP (comments, say) are dropped, and whitespace between tokens is
+   always skipped, as Lexer.java does.
+
+   The syntax is ThompsonConstructor.java's: | * + ? ( ), [a-z] and [^...] classes, "..."
+   strings and \ escapes, plus . (any byte but newline), \d, \s and \w. \b, a word boundary,
+   may open or close a rule and is checked when the rule accepts.
+
+   The rules go through Thompson's construction, the subset construction and Hopcroft's
+   minimization. Bytes that no expression tells apart share a byte class, so the minimized
+   automaton is a flat uint16_t [state][class] table with the dead state 0 and the start
+   state 1. tokenize() runs maximal munch over that table and writes table columns straight
+   into a TokenStream.
+
+   Whitespace, and every state that loops on itself over a byte set of at most four ranges (or
+   the complement of one), are skipped with the SIMD scanners of simd_scan.h. Those states are
+   the bodies of comments and identifiers. A skipped run only covers bytes the table would have
+   looped on, so the tokens are the same as with ScanLevel::Scalar, which steps every byte.
+*/
+
+// Thompson NFA of a set of rules. A state has either one byte-set edge or up to two ε edges.
+class ThompsonNfa
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct State
+    {
+        uint32_t out = NONE;     // target of the byte-set edge, or the first ε edge
+        uint32_t out2 = NONE;    // second ε edge
+        int32_t byteSet = -1;    // index into byteSets, -1 for a state with only ε edges
+        int32_t rule = -1;       // rule accepted here, -1 if none
+    };
+
+    std::vector<State> states;
+    std::vector<std::bitset<256>> byteSets;
+    std::vector<uint32_t> ruleStarts;
+
+    // Adds regex as rule number rule. Returns false with error set if it does not parse.
+    bool addRule(std::string_view regex, int32_t rule, std::string &error)
+    {
+        pattern = regex;
+        pos = 0;
+        failure.clear();
+        Fragment fragment = parseExpression();
+        if (failure.empty() && pos < pattern.size())
+            failure = "unbalanced ')'";
+        if (!failure.empty())
+        {
+            error = failure + " at offset " + std::to_string(pos) + " of " + std::string(regex);
+            return false;
+        }
+        states[fragment.accept].rule = rule;
+        ruleStarts.push_back(fragment.start);
+        return true;
+    }
+
+private:
+    struct Fragment
+    {
+        uint32_t start, accept;   // accept has no edges yet
+    };
+
+    std::string_view pattern;
+    size_t pos = 0;
+    std::string failure;
+
+    uint32_t newState()
+    {
+        states.emplace_back();
+        return static_cast<uint32_t>(states.size() - 1);
+    }
+    void epsilon(uint32_t from, uint32_t to)
+    {
+        (states[from].out == NONE ? states[from].out : states[from].out2) = to;
+    }
+
+    Fragment bytes(const std::bitset<256> &set)
+    {
+        Fragment f{newState(), newState()};
+        states[f.start].byteSet = static_cast<int32_t>(byteSets.size());
+        states[f.start].out = f.accept;
+        byteSets.push_back(set);
+        return f;
+    }
+    Fragment empty()
+    {
+        Fragment f{newState(), newState()};
+        epsilon(f.start, f.accept);
+        return f;
+    }
+    Fragment concat(Fragment first, Fragment second)
+    {
+        epsilon(first.accept, second.start);
+        return Fragment{first.start, second.accept};
+    }
+    Fragment alternate(Fragment first, Fragment second)
+    {
+        Fragment f{newState(), newState()};
+        epsilon(f.start, first.start);
+        epsilon(f.start, second.start);
+        epsilon(first.accept, f.accept);
+        epsilon(second.accept, f.accept);
+        return f;
+    }
+    // inner*, inner+ (skipping has no path around inner) and inner?.
+    Fragment repeat(Fragment inner, bool skippable, bool loops)
+    {
+        Fragment f{newState(), newState()};
+        epsilon(f.start, inner.start);
+        if (skippable)
+            epsilon(f.start, f.accept);
+        if (loops)
+            epsilon(inner.accept, inner.start);
+        epsilon(inner.accept, f.accept);
+        return f;
+    }
+
+    static std::bitset<256> single(unsigned char c)
+    {
+        std::bitset<256> set;
+        set.set(c);
+        return set;
+    }
+    static std::bitset<256> range(unsigned from, unsigned to)
+    {
+        std::bitset<256> set;
+        for (unsigned c = from; c <= to; c++)
+            set.set(c);
+        return set;
+    }
+    static unsigned firstByte(const std::bitset<256> &set)
+    {
+        unsigned c = 0;
+        while (c < 255 && !set[c])
+            c++;
+        return c;
+    }
+    static std::bitset<256> wordBytes() { return range('a', 'z') | range('A', 'Z') | range('0', '9') | single('_'); }
+    static std::bitset<256> spaceBytes() { return single(' ') | range('\t', '\r'); }
+
+    bool atEnd() const { return pos >= pattern.size(); }
+    char peek() const { return pattern[pos]; }
+    bool match(char expected)
+    {
+        if (atEnd() || peek() != expected)
+            return false;
+        pos++;
+        return true;
+    }
+
+    // The byte set of the escape after a backslash.
+    std::bitset<256> escape()
+    {
+        if (atEnd())
+        {
+            failure = "escape at end of expression";
+            return std::bitset<256>();
+        }
+        char c = pattern[pos++];
+        switch (c)
+        {
+        case 'd': return range('0', '9');
+        case 's': return spaceBytes();
+        case 'w': return wordBytes();
+        case 't': return single('\t');
+        case 'n': return single('\n');
+        case 'r': return single('\r');
+        case 'b':
+            failure = "\\b is only supported at the start or end of a rule";
+            return std::bitset<256>();
+        default: return single(static_cast<unsigned char>(c));
+        }
+    }
+
+    // Expression ::= Term ('|' Term)*
+    Fragment parseExpression()
+    {
+        Fragment term = parseTerm();
+        while (failure.empty() && match('|'))
+            term = alternate(term, parseTerm());
+        return term;
+    }
+
+    // Term ::= Factor*
+    Fragment parseTerm()
+    {
+        bool any = false;
+        Fragment result{0, 0};
+        while (failure.empty() && !atEnd() && peek() != '|' && peek() != ')')
+        {
+            Fragment factor = parseFactor();
+            result = any ? concat(result, factor) : factor;
+            any = true;
+        }
+        return any ? result : empty();
+    }
+
+    // Factor ::= Base ('*' | '+' | '?')*
+    Fragment parseFactor()
+    {
+        Fragment base = parseBase();
+        while (failure.empty() && !atEnd())
+        {
+            if (match('*'))
+                base = repeat(base, true, true);
+            else if (match('+'))
+                base = repeat(base, false, true);
+            else if (match('?'))
+                base = repeat(base, true, false);
+            else
+                break;
+        }
+        return base;
+    }
+
+    // Base ::= ( Expression ) | CharacterClass | StringLiteral | . | Escape | Literal
+    Fragment parseBase()
+    {
+        char c = pattern[pos++];
+        switch (c)
+        {
+        case '(':
+        {
+            Fragment inner = parseExpression();
+            if (failure.empty() && !match(')'))
+                failure = "expected ')'";
+            return inner;
+        }
+        case '[':
+            return parseClass();
+        case '"':
+            return parseString();
+        case '.':
+            return bytes(~single('\n'));
+        case '\\':
+            return bytes(escape());
+        case '*':
+        case '+':
+        case '?':
+            pos--;
+            failure = "nothing to repeat";
+            return empty();
+        default:
+            return bytes(single(static_cast<unsigned char>(c)));
+        }
+    }
+
+    // [abc], [a-z], [^...]; a negated class is the complement over all 256 bytes.
+    Fragment parseClass()
+    {
+        bool negate = match('^');
+        std::bitset<256> set;
+        while (failure.empty() && !atEnd() && peek() != ']')
+        {
+            char c = pattern[pos++];
+            if (c == '\\')
+            {
+                std::bitset<256> escaped = escape();
+                if (escaped.count() != 1)
+                {
+                    set |= escaped;
+                    continue;
+                }
+                c = static_cast<char>(firstByte(escaped));
+            }
+            if (pos + 1 < pattern.size() && peek() == '-' && pattern[pos + 1] != ']')
+            {
+                pos++;
+                char to = pattern[pos++];
+                if (to == '\\')
+                    to = static_cast<char>(firstByte(escape()));
+                if (static_cast<unsigned char>(to) < static_cast<unsigned char>(c))
+                    failure = "reversed range in character class";
+                else
+                    set |= range(static_cast<unsigned char>(c), static_cast<unsigned char>(to));
+            }
+            else
+                set.set(static_cast<unsigned char>(c));
+        }
+        if (failure.empty() && !match(']'))
+            failure = "expected ']'";
+        if (negate)
+            set.flip();
+        if (failure.empty() && set.none())
+            failure = "empty character class";
+        return bytes(set);
+    }
+
+    // "..." matches its characters literally; \ escapes the next one.
+    Fragment parseString()
+    {
+        Fragment result = empty();
+        while (failure.empty() && !atEnd() && peek() != '"')
+        {
+            char c = pattern[pos++];
+            if (c == '\\')
+            {
+                if (atEnd())
+                {
+                    failure = "escape at end of string literal";
+                    break;
+                }
+                c = pattern[pos++];
+            }
+            result = concat(result, bytes(single(static_cast<unsigned char>(c))));
+        }
+        if (failure.empty() && !match('"'))
+            failure = "expected closing '\"'";
+        return result;
+    }
+};
+
+/* The terminals of a grammar whose names fit in 8 bytes, keyed by the name packed into a
+   uint64_t. Operators and keywords find their column without hashing a string. */
+class PackedNameTable
+{
+public:
+    PackedNameTable(const SymbolTable &symbols, const TerminalIndex &terminals)
+    {
+        size_t bits = 4;
+        while ((size_t(1) << bits) < terminals.size() * 2)
+            bits++;
+        shift = 64 - bits;
+        slots.assign(size_t(1) << bits, Slot());
+        for (size_t column = 0; column < terminals.size(); column++)
+        {
+            const std::string &name = symbols.name(terminals.symbolOf[column]);
+            if (name.empty() || name.size() > 8)
+                continue;
+            uint64_t key = pack(name.data(), name.size());
+            size_t i = slotOf(key);
+            while (slots[i].column >= 0)
+                i = (i + 1) & (slots.size() - 1);
+            slots[i] = Slot{key, static_cast<uint32_t>(name.size()), static_cast<int32_t>(column)};
+        }
+    }
+
+    // Column of the terminal named by the length (1 to 8) bytes at name, or -1.
+    int32_t find(const char *name, size_t length) const
+    {
+        uint64_t key = pack(name, length);
+        for (size_t i = slotOf(key); slots[i].column >= 0; i = (i + 1) & (slots.size() - 1))
+            if (slots[i].key == key && slots[i].length == length)
+                return slots[i].column;
+        return -1;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t key = 0;
+        uint32_t length = 0;
+        int32_t column = -1;   // -1 for an empty slot
+    };
+    std::vector<Slot> slots;
+    unsigned shift = 60;
+
+    static uint64_t pack(const char *bytes, size_t length)
+    {
+        uint64_t key = 0;
+        std::memcpy(&key, bytes, length);
+        return key;
+    }
+    size_t slotOf(uint64_t key) const { return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift); }
+};
+
+struct LexResult
+{
+    bool ok = false;
+    size_t errorOffset = 0;   // first byte no rule matches, when !ok
+    size_t tokens = 0;        // tokens written to the stream, SKIP lexemes excluded
+    double seconds = 0;
+};
+
+class DfaLexer
+{
+public:
+    static constexpr uint16_t DEAD = 0;
+    static constexpr uint16_t START = 1;
+
+    // Generates the automaton for spec. Returns false with error() set if it has no rules, a
+    // rule does not parse or the minimized automaton does not fit 16-bit state numbers.
+    bool build(std::string_view spec)
+    {
+        rules.clear();
+        errorMessage.clear();
+        ThompsonNfa nfa;
+        size_t lineNumber = 0;
+        for (size_t start = 0; start < spec.size();)
+        {
+            size_t end = spec.find('\n', start);
+            if (end == std::string_view::npos)
+                end = spec.size();
+            std::string_view line = spec.substr(start, end - start);
+            start = end + 1;
+            lineNumber++;
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+                line.remove_suffix(1);
+            if (line.empty())
+                continue;
+            std::string type = "TOKEN";
+            splitType(line, type);
+            for (std::string_view alternative : topLevelAlternatives(line))
+            {
+                Rule rule;
+                rule.type = type;
+                rule.skip = type == "SKIP";
+                if (alternative.size() >= 2 && alternative.substr(0, 2) == "\\b")
+                {
+                    rule.leadingBoundary = true;
+                    alternative.remove_prefix(2);
+                }
+                if (alternative.size() >= 2 && alternative.substr(alternative.size() - 2) == "\\b" &&
+                    !escaped(alternative, alternative.size() - 2))
+                {
+                    rule.trailingBoundary = true;
+                    alternative.remove_suffix(2);
+                }
+                std::string error;
+                if (!nfa.addRule(alternative, static_cast<int32_t>(rules.size()), error))
+                {
+                    errorMessage = "line " + std::to_string(lineNumber) + ": " + error;
+                    return false;
+                }
+                rules.push_back(rule);
+            }
+        }
+        if (rules.empty())
+        {
+            errorMessage = "the specification has no rules";
+            return false;
+        }
+        nfaStateCount = nfa.states.size();
+        computeByteClasses(nfa.byteSets);
+        std::vector<uint32_t> moves;
+        std::vector<std::vector<int32_t>> accepts;
+        if (!subsetConstruction(nfa, moves, accepts))
+            return false;
+        return minimize(moves, accepts);
+    }
+
+    const std::string &error() const { return errorMessage; }
+    size_t ruleCount() const { return rules.size(); }
+    size_t nfaStates() const { return nfaStateCount; }
+    size_t dfaStates() const { return dfaStateCount; }     // before minimization, dead state included
+    size_t states() const { return acceptStart.size() - 1; }
+    size_t classes() const { return classCount; }
+    size_t tableBytes() const { return next.size() * sizeof(uint16_t) + sizeof(classOf); }
+    size_t runStates() const { return runs.size(); }   // states with a vectorized self-loop
+
+    // detectScanLevel() unless set; Scalar steps the table one byte at a time. A level this CPU
+    // cannot run is refused and the current one kept.
+    ScanLevel scanLevel() const { return level; }
+    bool setScanLevel(ScanLevel scanLevel)
+    {
+        if (!scanLevelSupported(scanLevel))
+            return false;
+        level = scanLevel;
+        return true;
+    }
+
+    /* Splits text into tokens and appends their table columns to stream, followed by $. As in
+       loadTokenFile(), a token maps to the terminal named like its lexeme, or else to the one
+       named like its rule's type. Lexemes stay in text, which must outlive stream. */
+    LexResult tokenize(std::string_view text, const SymbolTable &symbols, const TerminalIndex &terminals,
+                       TokenStream &stream) const
+    {
+        auto started = std::chrono::steady_clock::now();
+        LexResult result;
+        auto columnOf = [&](std::string_view name) -> int32_t {
+            SymbolId id = symbols.lookup(name);
+            if (id == NO_SYMBOL || static_cast<size_t>(id) >= terminals.denseOf.size())
+                return -1;
+            return terminals.denseOf[id];
+        };
+        std::vector<int32_t> typeColumn(rules.size());
+        for (size_t r = 0; r < rules.size(); r++)
+            typeColumn[r] = columnOf(rules[r].type);
+        PackedNameTable shortNames(symbols, terminals);
+        size_t longestTerminal = 0;
+        for (SymbolId terminal : terminals.symbolOf)
+            longestTerminal = std::max(longestTerminal, symbols.name(terminal).size());
+        stream.source = text.data();
+        stream.columns.reserve(stream.columns.size() + text.size() / 4 + 1);
+        stream.lexemeStart.reserve(stream.columns.capacity());
+        stream.lexemeLength.reserve(stream.columns.capacity());
+
+        const uint8_t *begin = reinterpret_cast<const uint8_t *>(text.data());
+        const uint8_t *end = begin + text.size();
+        const uint8_t *p = begin;
+        const uint16_t *table = next.data();
+        bool vectorized = level != ScanLevel::Scalar;
+        for (;;)
+        {
+            if (vectorized)
+                p = findRunEnd(level, whitespace(), p, end);
+            else
+                while (p < end && isSpace(*p))
+                    p++;
+            if (p == end)
+            {
+                result.ok = true;
+                break;
+            }
+            bool boundaryBefore = (p > begin && isWord(p[-1])) != isWord(*p);
+            const uint8_t *tokenEnd = nullptr;
+            int32_t tokenRule = -1;
+            uint32_t state = START;
+            for (const uint8_t *q = p; q < end;)
+            {
+                state = table[state * classCount + classOf[*q++]];
+                if (state == DEAD)
+                    break;
+                if (vectorized && runOf[state] >= 0 && q < end && table[state * classCount + classOf[*q]] == state)
+                    q = findRunEnd(level, runs[runOf[state]], q, end);
+                int32_t accepted = acceptedRule[state];
+                if (accepted >= 0)
+                {
+                    tokenEnd = q;
+                    tokenRule = accepted;
+                    continue;
+                }
+                if (accepted == NO_RULE)
+                    continue;
+                for (uint32_t a = acceptStart[state]; a < acceptStart[state + 1]; a++)
+                {
+                    const Rule &rule = rules[acceptRules[a]];
+                    if (rule.leadingBoundary && !boundaryBefore)
+                        continue;
+                    if (rule.trailingBoundary && isWord(q[-1]) == (q < end && isWord(*q)))
+                        continue;
+                    tokenEnd = q;
+                    tokenRule = acceptRules[a];
+                    break;
+                }
+            }
+            if (!tokenEnd)
+            {
+                result.errorOffset = static_cast<size_t>(p - begin);
+                break;
+            }
+            if (!rules[tokenRule].skip)
+            {
+                std::string_view lexeme(reinterpret_cast<const char *>(p), static_cast<size_t>(tokenEnd - p));
+                int32_t column = lexeme.size() <= 8 ? shortNames.find(lexeme.data(), lexeme.size())
+                               : lexeme.size() <= longestTerminal ? columnOf(lexeme) : -1;
+                // As in loadTokenFile, ε and $ are never input.
+                if (column <= static_cast<int32_t>(END_MARKER_BIT))
+                    column = typeColumn[tokenRule];
+                if (column <= static_cast<int32_t>(END_MARKER_BIT))
+                {
+                    column = -1;
+                    stream.unknownTokens++;
+                }
+                stream.columns.push_back(column);
+                stream.lexemeStart.push_back(static_cast<uint32_t>(p - begin));
+                stream.lexemeLength.push_back(static_cast<uint32_t>(lexeme.size()));
+                result.tokens++;
+            }
+            p = tokenEnd;
+        }
+        stream.columns.push_back(terminals.denseOf[END_MARKER]);
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+private:
+    struct Rule
+    {
+        std::string type;
+        bool skip = false;
+        bool leadingBoundary = false;    // opened with \b
+        bool trailingBoundary = false;   // closed with \b
+    };
+
+    std::vector<Rule> rules;
+    std::string errorMessage;
+    size_t nfaStateCount = 0;
+    size_t dfaStateCount = 0;
+    uint8_t classOf[256] = {};
+    size_t classCount = 0;
+    std::vector<uint16_t> next;            // [state * classCount + class]
+    std::vector<uint32_t> acceptStart;     // rules accepted in each state, by priority
+    std::vector<int32_t> acceptRules;
+    std::vector<int32_t> acceptedRule;     // per state: the rule if it needs no \b check, else one of:
+    static constexpr int32_t NO_RULE = -1;       // the state accepts nothing
+    static constexpr int32_t CHECK_RULES = -2;   // the first rule has a \b to check
+    std::vector<int32_t> runOf;            // per state: its self-loop in runs, or -1
+    std::vector<ByteRuns> runs;
+    ScanLevel level = detectScanLevel();
+
+    static const ByteRuns &whitespace()
+    {
+        static const ByteRuns spaces = [] {
+            std::bitset<256> set;
+            for (unsigned c = 0; c < 256; c++)
+                set[c] = isSpace(static_cast<uint8_t>(c));
+            ByteRuns runs;
+            ByteRuns::from(set, runs);
+            return runs;
+        }();
+        return spaces;
+    }
+
+    static bool isSpace(uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+    static bool isWord(uint8_t c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    // Whether the character at i is escaped by an odd run of backslashes before it.
+    static bool escaped(std::string_view text, size_t i)
+    {
+        size_t backslashes = 0;
+        while (i > backslashes && text[i - backslashes - 1] == '\\')
+            backslashes++;
+        return backslashes % 2 == 1;
+    }
+
+    // Strips a leading `TYPE = ` from line and stores TYPE.
+    static void splitType(std::string_view &line, std::string &type)
+    {
+        size_t i = 0;
+        while (i < line.size() && (line[i] == '_' || (line[i] >= 'A' && line[i] <= 'Z') || (line[i] >= 'a' && line[i] <= 'z') ||
+                                   (i > 0 && line[i] >= '0' && line[i] <= '9')))
+            i++;
+        size_t nameEnd = i;
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+            i++;
+        if (nameEnd == 0 || i >= line.size() || line[i] != '=' || i + 1 >= line.size() ||
+            (line[i + 1] != ' ' && line[i + 1] != '\t'))
+            return;
+        type = std::string(line.substr(0, nameEnd));
+        i++;
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+            i++;
+        line.remove_prefix(i);
+    }
+
+    // The alternatives of regex outside any group, class or string.
+    static std::vector<std::string_view> topLevelAlternatives(std::string_view regex)
+    {
+        std::vector<std::string_view> alternatives;
+        size_t depth = 0, start = 0;
+        bool inClass = false, inString = false;
+        for (size_t i = 0; i < regex.size(); i++)
+        {
+            char c = regex[i];
+            if (c == '\\')
+                i++;
+            else if (inClass)
+                inClass = c != ']';
+            else if (inString)
+                inString = c != '"';
+            else if (c == '[')
+                inClass = true;
+            else if (c == '"')
+                inString = true;
+            else if (c == '(')
+                depth++;
+            else if (c == ')' && depth > 0)
+                depth--;
+            else if (c == '|' && depth == 0)
+            {
+                alternatives.push_back(regex.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+        alternatives.push_back(regex.substr(start));
+        return alternatives;
+    }
+
+    // Partitions the bytes so that two bytes share a class iff every byte set treats them alike.
+    void computeByteClasses(const std::vector<std::bitset<256>> &byteSets)
+    {
+        std::fill(classOf, classOf + 256, 0);
+        classCount = 1;
+        for (const std::bitset<256> &set : byteSets)
+        {
+            int16_t renumbered[256][2];
+            std::fill(&renumbered[0][0], &renumbered[0][0] + 512, -1);
+            size_t count = 0;
+            for (size_t b = 0; b < 256; b++)
+            {
+                int16_t &id = renumbered[classOf[b]][set[b]];
+                if (id < 0)
+                    id = static_cast<int16_t>(count++);
+                classOf[b] = static_cast<uint8_t>(id);
+            }
+            classCount = count;
+        }
+    }
+
+    // Builds the DFA over byte classes. moves[s * classCount + c] is the successor of state s;
+    // state 0 is the empty (dead) set and state 1 the closure of the rule starts.
+    bool subsetConstruction(const ThompsonNfa &nfa, std::vector<uint32_t> &moves,
+                            std::vector<std::vector<int32_t>> &accepts)
+    {
+        const size_t STATE_LIMIT = 1 << 20;
+        std::vector<uint8_t> representative(classCount);
+        for (size_t b = 256; b-- > 0;)
+            representative[classOf[b]] = static_cast<uint8_t>(b);
+
+        std::vector<uint32_t> seen(nfa.states.size(), 0);
+        uint32_t generation = 0;
+        std::vector<uint32_t> pending;
+        // Sorts set and adds everything reachable over ε edges.
+        auto close = [&](std::vector<uint32_t> &set) {
+            generation++;
+            pending.assign(set.begin(), set.end());
+            set.clear();
+            while (!pending.empty())
+            {
+                uint32_t s = pending.back();
+                pending.pop_back();
+                if (seen[s] == generation)
+                    continue;
+                seen[s] = generation;
+                set.push_back(s);
+                const ThompsonNfa::State &state = nfa.states[s];
+                if (state.byteSet >= 0)
+                    continue;
+                if (state.out != ThompsonNfa::NONE)
+                    pending.push_back(state.out);
+                if (state.out2 != ThompsonNfa::NONE)
+                    pending.push_back(state.out2);
+            }
+            std::sort(set.begin(), set.end());
+        };
+
+        std::vector<std::vector<uint32_t>> sets(2);
+        sets[1] = nfa.ruleStarts;
+        close(sets[1]);
+        FlatHashMap<std::vector<uint32_t>, uint32_t, SequenceHash> idOf;   // sets[] keeps the order
+        idOf.emplace(sets[0], 0);
+        idOf.emplace(sets[1], 1);
+        std::vector<uint32_t> target;
+        for (size_t s = 0; s < sets.size(); s++)
+        {
+            for (size_t c = 0; c < classCount; c++)
+            {
+                target.clear();
+                for (uint32_t n : sets[s])
+                {
+                    const ThompsonNfa::State &state = nfa.states[n];
+                    if (state.byteSet >= 0 && nfa.byteSets[state.byteSet][representative[c]])
+                        target.push_back(state.out);
+                }
+                close(target);
+                auto found = idOf.emplace(target, static_cast<uint32_t>(sets.size()));
+                if (found.second)
+                    sets.push_back(target);
+                moves.push_back(*found.first);
+            }
+            if (sets.size() > STATE_LIMIT)
+            {
+                errorMessage = "the automaton has more than " + std::to_string(STATE_LIMIT) + " states";
+                return false;
+            }
+        }
+
+        accepts.resize(sets.size());
+        for (size_t s = 0; s < sets.size(); s++)
+        {
+            for (uint32_t n : sets[s])
+                if (nfa.states[n].rule >= 0)
+                    accepts[s].push_back(nfa.states[n].rule);
+            std::sort(accepts[s].begin(), accepts[s].end());
+        }
+        dfaStateCount = sets.size();
+        return true;
+    }
+
+    /* Hopcroft's algorithm: starts from the partition by accepted rules and splits blocks by
+       the predecessors of a splitter block under each class until the partition is stable. */
+    bool minimize(const std::vector<uint32_t> &moves, const std::vector<std::vector<int32_t>> &accepts)
+    {
+        size_t n = accepts.size();
+        std::vector<uint32_t> inverseStart(classCount * n + 1, 0);   // predecessors by (class, target)
+        for (size_t s = 0; s < n; s++)
+            for (size_t c = 0; c < classCount; c++)
+                inverseStart[c * n + moves[s * classCount + c] + 1]++;
+        for (size_t i = 1; i < inverseStart.size(); i++)
+            inverseStart[i] += inverseStart[i - 1];
+        std::vector<uint32_t> inverse(n * classCount);
+        {
+            std::vector<uint32_t> fill(inverseStart.begin(), inverseStart.end() - 1);
+            for (size_t s = 0; s < n; s++)
+                for (size_t c = 0; c < classCount; c++)
+                    inverse[fill[c * n + moves[s * classCount + c]]++] = static_cast<uint32_t>(s);
+        }
+
+        std::vector<std::vector<uint32_t>> blocks;
+        std::vector<uint32_t> blockOf(n);
+        {
+            FlatHashMap<std::vector<int32_t>, uint32_t, SequenceHash> blockOfAccepts;
+            for (size_t s = 0; s < n; s++)
+            {
+                auto found = blockOfAccepts.emplace(accepts[s], static_cast<uint32_t>(blocks.size()));
+                if (found.second)
+                    blocks.emplace_back();
+                blockOf[s] = *found.first;
+                blocks[blockOf[s]].push_back(static_cast<uint32_t>(s));
+            }
+        }
+        std::vector<uint32_t> worklist;
+        std::vector<uint8_t> queued(blocks.size(), 1);
+        for (uint32_t b = 0; b < blocks.size(); b++)
+            worklist.push_back(b);
+        std::vector<uint8_t> marked(n, 0);
+        std::vector<uint32_t> markedStates, markedCount(blocks.size(), 0), touched, splitter;
+        while (!worklist.empty())
+        {
+            uint32_t a = worklist.back();
+            worklist.pop_back();
+            queued[a] = 0;
+            splitter = blocks[a];
+            for (size_t c = 0; c < classCount; c++)
+            {
+                for (uint32_t t : splitter)
+                {
+                    for (uint32_t i = inverseStart[c * n + t]; i < inverseStart[c * n + t + 1]; i++)
+                    {
+                        uint32_t s = inverse[i];
+                        if (marked[s])
+                            continue;
+                        marked[s] = 1;
+                        markedStates.push_back(s);
+                        if (markedCount[blockOf[s]]++ == 0)
+                            touched.push_back(blockOf[s]);
+                    }
+                }
+                for (uint32_t b : touched)
+                {
+                    if (markedCount[b] < blocks[b].size())
+                    {
+                        // The marked states move to a new block.
+                        uint32_t split = static_cast<uint32_t>(blocks.size());
+                        std::vector<uint32_t> kept, moved;
+                        for (uint32_t s : blocks[b])
+                            (marked[s] ? moved : kept).push_back(s);
+                        for (uint32_t s : moved)
+                            blockOf[s] = split;
+                        blocks[b].swap(kept);
+                        blocks.push_back(std::move(moved));
+                        markedCount.push_back(0);
+                        bool wasQueued = queued[b];
+                        queued.push_back(0);
+                        uint32_t add = wasQueued || blocks[split].size() <= blocks[b].size() ? split : b;
+                        if (!queued[add])
+                        {
+                            queued[add] = 1;
+                            worklist.push_back(add);
+                        }
+                    }
+                    markedCount[b] = 0;
+                }
+                touched.clear();
+                for (uint32_t s : markedStates)
+                    marked[s] = 0;
+                markedStates.clear();
+            }
+        }
+
+        if (blockOf[0] == blockOf[1])
+        {
+            errorMessage = "the specification matches nothing";
+            return false;
+        }
+        if (blocks.size() > UINT16_MAX)
+        {
+            errorMessage = "the minimized automaton has " + std::to_string(blocks.size()) +
+                           " states, more than 16-bit state numbers allow";
+            return false;
+        }
+        // Dead block 0, start block 1, the others in breadth-first order from the start.
+        const uint32_t UNNUMBERED = UINT32_MAX;
+        std::vector<uint32_t> number(blocks.size(), UNNUMBERED), order;
+        number[blockOf[0]] = DEAD;
+        number[blockOf[1]] = START;
+        order.push_back(blockOf[0]);
+        order.push_back(blockOf[1]);
+        for (size_t i = 1; i < order.size(); i++)
+        {
+            uint32_t representative = blocks[order[i]][0];
+            for (size_t c = 0; c < classCount; c++)
+            {
+                uint32_t b = blockOf[moves[representative * classCount + c]];
+                if (number[b] == UNNUMBERED)
+                {
+                    number[b] = static_cast<uint32_t>(order.size());
+                    order.push_back(b);
+                }
+            }
+        }
+        for (uint32_t b = 0; b < blocks.size(); b++)
+            if (number[b] == UNNUMBERED)
+            {
+                number[b] = static_cast<uint32_t>(order.size());
+                order.push_back(b);
+            }
+
+        next.assign(order.size() * classCount, DEAD);
+        acceptStart.assign(1, 0);
+        acceptRules.clear();
+        acceptedRule.assign(order.size(), NO_RULE);
+        for (size_t state = 0; state < order.size(); state++)
+        {
+            uint32_t representative = blocks[order[state]][0];
+            for (size_t c = 0; c < classCount; c++)
+                next[state * classCount + c] =
+                    static_cast<uint16_t>(number[blockOf[moves[representative * classCount + c]]]);
+            const std::vector<int32_t> &accepted = accepts[representative];
+            acceptRules.insert(acceptRules.end(), accepted.begin(), accepted.end());
+            acceptStart.push_back(static_cast<uint32_t>(acceptRules.size()));
+            if (!accepted.empty())
+            {
+                const Rule &first = rules[accepted[0]];
+                acceptedRule[state] = first.leadingBoundary || first.trailingBoundary ? CHECK_RULES : accepted[0];
+            }
+        }
+
+        // Self-loops the scanners can skip. A \b check depends on the byte after each position,
+        // so those states keep stepping.
+        runOf.assign(order.size(), -1);
+        runs.clear();
+        for (size_t state = START; state < order.size(); state++)
+        {
+            if (acceptedRule[state] == CHECK_RULES)
+                continue;
+            std::bitset<256> loop;
+            for (unsigned b = 0; b < 256; b++)
+                loop[b] = next[state * classCount + classOf[b]] == state;
+            ByteRuns run;
+            if (loop.any() && ByteRuns::from(loop, run))
+            {
+                runOf[state] = static_cast<int32_t>(runs.size());
+                runs.push_back(run);
+            }
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef ENGINE_FUZZER_H
+#define ENGINE_FUZZER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "grammar_generator.h"
+#include "grammar_analyzer.h"
+
+/* --fuzz: differential testing of the analysis engines against the reference engine, with the
+   timings that go with it.
+
+   Every grammar comes from the synthetic generator with a shape drawn at random from the
+   grammar's own seed: 4 up to maxNonTerminals non-terminals, log-uniformly, so every size
+   decade gets grammars, and random rule counts, lengths, terminal counts and densities of ε,
+   left recursion and shared prefixes. One rule of it is then replaced by the same rule of a
+   second grammar of that shape, which is the edit the incremental engine gets to update.
+
+   The edited grammar goes through GrammarAnalyzer once per engine: the reference std::set
+   fixpoints, the bitset worklists, the worklists with shared suffix sets, the SCC-parallel
+   engine, and the incremental engine updating its analysis of the unedited grammar. Each
+   result is compared with the reference one nullability bit by bit, FIRST and FOLLOW set by
+   set and the LL(1) table cell by cell, through symbol names, so an engine whose symbol ids
+   came out differently is still compared fairly. The final grammars and the conflicts are
+   compared too. analyze() is timed for every engine and summed per size decade.
+
+   A grammar only depends on its seed and maxNonTerminals, so a mismatch is reproduced on
+   its own with --fuzz=1 and that seed.
+*/
+
+enum class FuzzEngine
+{
+    Reference,
+    Bitset,
+    SharedSuffixes,
+    Parallel,
+    Incremental
+};
+
+const size_t FUZZ_ENGINE_COUNT = 5;
+
+inline const char *fuzzEngineName(FuzzEngine engine)
+{
+    static const char *const names[FUZZ_ENGINE_COUNT] = {"reference", "bitset", "shared-suffixes", "parallel",
+                                                         "incremental"};
+    return names[static_cast<size_t>(engine)];
+}
+
+struct FuzzOptions
+{
+    size_t grammars = 100;
+    size_t maxNonTerminals = 2000;
+    uint64_t seed = 1;             // grammar i has seed + i
+    AnalyzerOptions analysis;      // factoring and simplification, shared by every engine
+    size_t threads = 0;            // for the parallel engine; 0 uses every core
+};
+
+// Grammars whose non-terminal count falls in [low, high), and the time each engine took on them.
+struct FuzzBucket
+{
+    size_t low = 0, high = 0;
+    size_t grammars = 0;
+    size_t productions = 0;        // of the final grammars
+    double seconds[FUZZ_ENGINE_COUNT] = {};
+};
+
+struct FuzzMismatch
+{
+    uint64_t seed;
+    FuzzEngine engine;
+    std::string difference;
+};
+
+struct FuzzReport
+{
+    std::vector<FuzzBucket> buckets;   // by increasing size, only the ones that got grammars
+    std::vector<FuzzMismatch> mismatches;
+    size_t grammars = 0;
+    size_t comparisons = 0;            // bits and cells compared with the reference
+    size_t incrementalUpdates = 0;     // edits the incremental engine applied without a full run
+};
+
+/* Describes the first way other differs from reference, or returns "" when they agree.
+   comparisons counts the bits and cells looked at. */
+inline std::string compareAnalyses(const AnalysisResult &reference, const AnalysisResult &other, size_t &comparisons)
+{
+    const Grammar &grammar = reference.finalGrammar;
+    const SymbolTable &symbols = reference.symbols;
+    auto counterpart = [&](SymbolId sym) { return other.symbols.lookup(symbols.name(sym)); };
+
+    if (other.finalGrammar.productionCount() != grammar.productionCount())
+        return "the final grammar has " + std::to_string(other.finalGrammar.productionCount()) + " productions, not " +
+               std::to_string(grammar.productionCount());
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        std::string expected = symbols.name(grammar.prodLhs[p]) + " -> " + renderProduction(grammar.rhs(p), symbols);
+        std::string found = other.symbols.name(other.finalGrammar.prodLhs[p]) + " -> " +
+                            renderProduction(other.finalGrammar.rhs(p), other.symbols);
+        if (expected != found)
+            return "production " + std::to_string(p) + " is " + found + ", not " + expected;
+    }
+
+    // Column c of the reference is otherColumn[c] of other.
+    const TerminalIndex &terminals = reference.terminals;
+    if (other.terminals.size() != terminals.size())
+        return "the table has " + std::to_string(other.terminals.size()) + " columns, not " +
+               std::to_string(terminals.size());
+    std::vector<size_t> otherColumn(terminals.size());
+    for (size_t c = 0; c < terminals.size(); c++)
+    {
+        SymbolId sym = counterpart(terminals.symbolOf[c]);
+        if (sym == NO_SYMBOL || other.terminals.denseOf[sym] < 0)
+            return "terminal " + symbols.name(terminals.symbolOf[c]) + " has no column";
+        otherColumn[c] = static_cast<size_t>(other.terminals.denseOf[sym]);
+    }
+
+    for (SymbolId nt : grammar.nonTerminals)
+    {
+        const std::string &name = symbols.name(nt);
+        SymbolId same = counterpart(nt);
+        if (same == NO_SYMBOL || !other.finalGrammar.defines(same))
+            return "non-terminal " + name + " is missing";
+        comparisons++;
+        if (reference.nullable.test(nt) != other.nullable.test(same))
+            return "nullability of " + name + " differs";
+        for (size_t c = 0; c < terminals.size(); c++)
+        {
+            const std::string &terminal = symbols.name(terminals.symbolOf[c]);
+            comparisons += 3;
+            if (reference.firstSets[nt].test(c) != other.firstSets[same].test(otherColumn[c]))
+                return "FIRST(" + name + ") differs at " + terminal;
+            if (reference.followSets[nt].test(c) != other.followSets[same].test(otherColumn[c]))
+                return "FOLLOW(" + name + ") differs at " + terminal;
+            int32_t expected = reference.parsingTable.at(static_cast<size_t>(reference.parsingTable.row(nt)), c);
+            int32_t found = other.parsingTable.at(static_cast<size_t>(other.parsingTable.row(same)), otherColumn[c]);
+            if (expected != found)
+                return "M[" + name + ", " + terminal + "] is " + std::to_string(found) + ", not " + std::to_string(expected);
+        }
+    }
+
+    const std::vector<TableConflict> &conflicts = reference.parsingTable.conflicts;
+    const std::vector<TableConflict> &otherConflicts = other.parsingTable.conflicts;
+    if (otherConflicts.size() != conflicts.size())
+        return std::to_string(otherConflicts.size()) + " conflicts, not " + std::to_string(conflicts.size());
+    for (size_t i = 0; i < conflicts.size(); i++)
+    {
+        const TableConflict &expected = conflicts[i];
+        const TableConflict &found = otherConflicts[i];
+        comparisons++;
+        if (counterpart(expected.nonTerminal) != found.nonTerminal || counterpart(expected.terminal) != found.terminal ||
+            expected.kept != found.kept || expected.rejected != found.rejected)
+            return "conflict " + std::to_string(i) + " differs (M[" + symbols.name(expected.nonTerminal) + ", " +
+                   symbols.name(expected.terminal) + "])";
+    }
+    return "";
+}
+
+class EngineFuzzer
+{
+public:
+    explicit EngineFuzzer(const FuzzOptions &options) : options(options)
+    {
+        for (size_t e = 0; e < FUZZ_ENGINE_COUNT; e++)
+        {
+            AnalyzerOptions engine;
+            engine.trieFactoring = options.analysis.trieFactoring;
+            engine.simplify = options.analysis.simplify;
+            switch (static_cast<FuzzEngine>(e))
+            {
+            case FuzzEngine::Reference:
+                engine.referenceEngine = true;
+                break;
+            case FuzzEngine::Bitset:
+                break;
+            case FuzzEngine::SharedSuffixes:
+                engine.sharedSuffixes = true;
+                break;
+            case FuzzEngine::Parallel:
+                engine.threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+                break;
+            case FuzzEngine::Incremental:
+                engine.incremental = true;
+                break;
+            }
+            analyzers.push_back(std::make_unique<GrammarAnalyzer>(engine));
+        }
+    }
+
+    // Returns false if an engine could not analyze a grammar; mismatches are in the report.
+    bool run(FuzzReport &report, std::string &error)
+    {
+        report = FuzzReport();
+        std::vector<FuzzBucket> decades;
+        for (size_t low = 1; low <= options.maxNonTerminals; low *= 10)
+        {
+            FuzzBucket bucket;
+            bucket.low = std::max<size_t>(low, MIN_NON_TERMINALS);
+            bucket.high = std::min(low * 10, options.maxNonTerminals + 1);
+            if (bucket.low < bucket.high)
+                decades.push_back(bucket);
+        }
+
+        for (size_t i = 0; i < options.grammars; i++)
+        {
+            uint64_t seed = options.seed + i;
+            std::string original, edited;
+            GrammarShape shape = generate(seed, original, edited);
+            FuzzBucket *bucket = &decades.back();
+            for (FuzzBucket &decade : decades)
+                if (shape.nonTerminals < decade.high)
+                {
+                    bucket = &decade;
+                    break;
+                }
+
+            GrammarAnalyzer &incremental = *analyzers[static_cast<size_t>(FuzzEngine::Incremental)];
+            if (!incremental.analyze(original))
+            {
+                error = "grammar " + std::to_string(seed) + ": " + incremental.error();
+                return false;
+            }
+            double seconds[FUZZ_ENGINE_COUNT];
+            for (size_t e = 0; e < FUZZ_ENGINE_COUNT; e++)
+            {
+                auto started = std::chrono::steady_clock::now();
+                bool analyzed = analyzers[e]->analyze(edited);
+                seconds[e] = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                if (!analyzed)
+                {
+                    error = "grammar " + std::to_string(seed) + ", " + fuzzEngineName(static_cast<FuzzEngine>(e)) +
+                            " engine: " + analyzers[e]->error();
+                    return false;
+                }
+            }
+            if (incremental.mode() == AnalysisMode::Incremental)
+                report.incrementalUpdates++;
+
+            const AnalysisResult &reference = analyzers[static_cast<size_t>(FuzzEngine::Reference)]->result();
+            for (size_t e = 1; e < FUZZ_ENGINE_COUNT; e++)
+            {
+                std::string difference = compareAnalyses(reference, analyzers[e]->result(), report.comparisons);
+                if (!difference.empty())
+                    report.mismatches.push_back(FuzzMismatch{seed, static_cast<FuzzEngine>(e), difference});
+            }
+            bucket->grammars++;
+            bucket->productions += reference.finalGrammar.productionCount();
+            for (size_t e = 0; e < FUZZ_ENGINE_COUNT; e++)
+                bucket->seconds[e] += seconds[e];
+            report.grammars++;
+        }
+        for (const FuzzBucket &bucket : decades)
+            if (bucket.grammars > 0)
+                report.buckets.push_back(bucket);
+        return true;
+    }
+
+private:
+    static constexpr size_t MIN_NON_TERMINALS = 4;
+
+    FuzzOptions options;
+    std::vector<std::unique_ptr<GrammarAnalyzer>> analyzers;   // indexed by FuzzEngine
+
+    // The shape for seed, the grammar it generates, and that grammar with one rule replaced.
+    GrammarShape generate(uint64_t seed, std::string &original, std::string &edited) const
+    {
+        uint64_t state = seed;
+        auto uniform = [&] { return (splitMix64(state) >> 11) * (1.0 / 9007199254740992.0); };
+        auto between = [&](size_t low, size_t high) { return low + static_cast<size_t>(uniform() * (high - low + 1)); };
+
+        GrammarShape shape;
+        double span = std::log(static_cast<double>(std::max(options.maxNonTerminals, MIN_NON_TERMINALS)) /
+                               MIN_NON_TERMINALS);
+        shape.nonTerminals = std::min(std::max(options.maxNonTerminals, MIN_NON_TERMINALS),
+                                      static_cast<size_t>(MIN_NON_TERMINALS * std::exp(uniform() * span)));
+        shape.alternatives = between(1, 5);
+        shape.rhsLength = between(1, 5);
+        shape.terminals = between(2, 48);
+        shape.nullableDensity = uniform() * 0.5;
+        shape.leftRecursionRatio = uniform() * 0.3;
+        shape.sharedPrefixRatio = uniform() * 0.5;
+        shape.seed = splitMix64(state);
+        original = GrammarGenerator(shape).generate();
+
+        // Rule k is line k in both grammars, since every rule is one line.
+        GrammarShape other = shape;
+        other.seed = splitMix64(state);
+        std::string replacement = GrammarGenerator(other).generate();
+        size_t k = static_cast<size_t>(splitMix64(state) % shape.nonTerminals);
+        auto line = [&](const std::string &text, size_t &begin, size_t &end) {
+            begin = 0;
+            for (size_t skipped = 0; skipped < k; skipped++)
+                begin = text.find('\n', begin) + 1;
+            end = text.find('\n', begin);
+        };
+        size_t begin, end, newBegin, newEnd;
+        line(original, begin, end);
+        line(replacement, newBegin, newEnd);
+        edited = original.substr(0, begin) + replacement.substr(newBegin, newEnd - newBegin) + original.substr(end);
+        return shape;
+    }
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef ERROR_RECOVERY_H
+#define ERROR_RECOVERY_H
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "ll1_driver.h"
+
+/* Panic-mode error recovery for the predictive parser, so one pass over a malformed input
+   reports every error instead of the first.
+
+   Every table row gets a synchronization bitset, FOLLOW(A) plus $, stored flat next to the
+   others. On an empty cell M[A, a] the parser pops A if a is in A's sync set (a can follow
+   what A should have derived), and otherwise skips a; a token that matches no terminal is
+   skipped too. Both tests are one bit each. A terminal on the stack that does not match is
+   popped as if it had been inserted, which is the phrase-level repair for a missing ';' or
+   ')'. Recovery steps with no token matched in between belong to one error, which keeps one
+   mistake from being reported as a cascade.
+
+   An expansion cycle that matches nothing (see ExpansionCycles) is an error too: the first
+   expansion of the repeated non-terminal is undone and the non-terminal popped, as if it
+   derived nothing. This ends every cycle, since it ends the innermost open expansion.
+
+   Errors go into a buffer reserved up front; once it is full further errors are only
+   counted, so the parse never allocates for diagnostics.
+*/
+
+struct SyntaxError
+{
+    size_t token = 0;              // where the error was found
+    SymbolId expected = NO_SYMBOL; // stack symbol that could not be matched or expanded
+    uint32_t skipped = 0;          // input tokens skipped to recover
+    uint32_t popped = 0;           // stack symbols given up to recover
+};
+
+class SyntaxErrorBuffer
+{
+public:
+    explicit SyntaxErrorBuffer(size_t capacity) : capacity(capacity) { errors.reserve(capacity); }
+
+    std::vector<SyntaxError> errors;   // the first capacity errors
+    size_t total = 0;                  // all errors, including those that did not fit
+
+    void clear()
+    {
+        errors.clear();
+        total = 0;
+    }
+
+private:
+    friend class RecoveringParser;
+    size_t capacity;
+
+    // A new error at token, or the one in progress if nothing matched since it was found.
+    SyntaxError *open(size_t token, SymbolId expected, bool continuing)
+    {
+        if (continuing)
+            return errors.size() == total && !errors.empty() ? &errors.back() : &discarded;
+        total++;
+        if (errors.size() == capacity)
+            return &discarded;
+        errors.push_back(SyntaxError{token, expected, 0, 0});
+        return &errors.back();
+    }
+
+    SyntaxError discarded;
+};
+
+class RecoveringParser
+{
+public:
+    RecoveringParser(const Grammar &grammar, const LL1Table &table, const TerminalIndex &terminals,
+                     const TerminalSets &follow)
+        : grammar(grammar), table(table), terminals(terminals), syncWordCount((terminals.size() + 63) / 64)
+    {
+        size_t longest = 1;
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+            longest = std::max(longest, grammar.rhs(p).size());
+        stack.resize(std::max<size_t>(1024, longest * 64));
+        cycles.reset(table.rowCount());
+
+        rowOf.assign(terminals.denseOf.size(), -1);
+        syncWords.assign(table.rowCount() * syncWordCount, 0);
+        size_t end = static_cast<size_t>(terminals.denseOf[END_MARKER]);
+        for (size_t r = 0; r < table.rowCount(); r++)
+        {
+            SymbolId nt = table.rowNonTerminal(r);
+            rowOf[nt] = static_cast<int32_t>(r);
+            uint64_t *words = &syncWords[r * syncWordCount];
+            follow[nt].forEach([&](size_t bit) { words[bit >> 6] |= uint64_t(1) << (bit & 63); });
+            words[end >> 6] |= uint64_t(1) << (end & 63);
+        }
+    }
+
+    // Parses input to the end whatever errors it has; accepted only if there were none.
+    ParseResult parse(const TokenStream &input, SyntaxErrorBuffer &errors)
+    {
+        auto started = std::chrono::steady_clock::now();
+        ParseResult result;
+        errors.clear();
+        const std::vector<int32_t> &columns = input.columns;
+        const size_t last = columns.size() - 1;   // the $ token
+        size_t top = 0;
+        stack[top++] = END_MARKER;
+        stack[top++] = grammar.startSymbol;
+        size_t pos = 0;
+        bool recovering = false;   // no token matched since the last error
+        cycles.matched();
+
+        while (top > 0)
+        {
+            result.maxDepth = std::max(result.maxDepth, top);
+            SymbolId sym = stack[top - 1];
+            int32_t lookahead = columns[pos];
+            int32_t row = rowOf[sym];
+            if (row < 0)
+            {
+                if (lookahead >= 0 && terminals.denseOf[sym] == lookahead && (sym != END_MARKER || pos == last))
+                {
+                    top--;
+                    pos++;
+                    cycles.matched();
+                    recovering = false;
+                    continue;
+                }
+                // Skip a token no terminal matches; otherwise act as if sym had been there,
+                // except for $, which only the end of the input can match.
+                SyntaxError *error = errors.open(pos, sym, recovering);
+                recovering = true;
+                if ((lookahead < 0 || sym == END_MARKER) && pos < last)
+                {
+                    error->skipped++;
+                    pos++;
+                    cycles.matched();
+                }
+                else
+                {
+                    error->popped++;
+                    top--;
+                }
+                continue;
+            }
+            int32_t prod = lookahead < 0 ? LL1Table::EMPTY : table.at(static_cast<size_t>(row), lookahead);
+            if (prod == LL1Table::EMPTY)
+            {
+                SyntaxError *error = errors.open(pos, sym, recovering);
+                recovering = true;
+                if (pos == last || (lookahead >= 0 && inSync(static_cast<size_t>(row), static_cast<size_t>(lookahead))))
+                {
+                    error->popped++;
+                    top--;
+                }
+                else
+                {
+                    error->skipped++;
+                    pos++;
+                    cycles.matched();
+                }
+                continue;
+            }
+            SymbolSpan rhs = grammar.rhs(static_cast<size_t>(prod));
+            top--;
+            size_t repeated = cycles.expand(static_cast<size_t>(row), top);
+            if (repeated != ExpansionCycles::NONE)
+            {
+                SyntaxError *error = errors.open(pos, sym, recovering);
+                recovering = true;
+                error->popped += static_cast<uint32_t>(top - repeated + 1);
+                top = repeated;
+                continue;
+            }
+            if (top + rhs.size() > stack.size())
+                stack.resize(std::max(stack.size() * 2, top + rhs.size()));
+            for (size_t i = rhs.size(); i > 0; i--)
+                stack[top++] = rhs[i - 1];
+        }
+
+        result.accepted = errors.total == 0 && pos == columns.size();
+        result.tokensConsumed = std::min(pos, last);
+        if (!errors.errors.empty())
+        {
+            result.errorToken = errors.errors[0].token;
+            result.expected = errors.errors[0].expected;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+private:
+    const Grammar &grammar;
+    const LL1Table &table;
+    const TerminalIndex &terminals;
+    std::vector<SymbolId> stack;
+    std::vector<int32_t> rowOf;       // indexed by SymbolId
+    ExpansionCycles cycles;
+    size_t syncWordCount;
+    std::vector<uint64_t> syncWords;  // FOLLOW(A) ∪ {$} of row r at [r * syncWordCount, ...)
+
+    bool inSync(size_t row, size_t column) const
+    {
+        return (syncWords[row * syncWordCount + (column >> 6)] >> (column & 63)) & 1;
+    }
+};
+
+#endif
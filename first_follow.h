@@ -0,0 +1,487 @@
+#ifndef FIRST_FOLLOW_H
+#define FIRST_FOLLOW_H
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+#include "phase_stats.h"
+
+/* Bitset-based FIRST/FOLLOW engine.
+   Sets are dense bitsets over the terminals of one grammar, and propagation is driven by a
+   worklist over the symbol dependency graph, so a non-terminal is only revisited when one of
+   the sets it reads from has grown. Which non-terminals derive ε is settled first by a
+   linear pass (computeNullable); FIRST sets of non-terminals never hold ε, and the inner
+   loops ask the nullable bitmap instead.
+*/
+
+// Dense numbering of the terminals of a grammar, used to index TerminalSet bits.
+// ε always gets index 0 and $ index 1; the remaining terminals follow in SymbolId order.
+struct TerminalIndex
+{
+    std::vector<int32_t> denseOf;     // indexed by SymbolId, -1 for non-terminals
+    std::vector<SymbolId> symbolOf;   // indexed by dense terminal index
+
+    TerminalIndex() {}
+    TerminalIndex(const Grammar &grammar, const SymbolTable &symbols)
+    {
+        denseOf.assign(symbols.size(), -1);
+        std::vector<bool> used(symbols.size(), false);
+        used[EPSILON] = used[END_MARKER] = true;
+        for (SymbolId sym : grammar.rhsSymbols)
+            if (!symbols.isNonTerminal(sym))
+                used[sym] = true;
+        for (size_t id = 0; id < used.size(); id++)
+        {
+            if (!used[id])
+                continue;
+            denseOf[id] = static_cast<int32_t>(symbolOf.size());
+            symbolOf.push_back(static_cast<SymbolId>(id));
+        }
+    }
+
+    size_t size() const { return symbolOf.size(); }
+};
+
+const size_t EPSILON_BIT = 0;      // TerminalIndex keeps ε at dense index 0
+const size_t END_MARKER_BIT = 1;   // and $ at dense index 1
+
+// One bit per SymbolId, set for the non-terminals that derive ε. Terminals never have it.
+class NullableSet
+{
+public:
+    NullableSet() {}
+    explicit NullableSet(size_t symbols) : words((symbols + 63) / 64, 0) {}
+
+    bool test(SymbolId sym) const { return (words[static_cast<size_t>(sym) >> 6] >> (sym & 63)) & 1; }
+    void insert(SymbolId sym) { words[static_cast<size_t>(sym) >> 6] |= uint64_t(1) << (sym & 63); }
+
+    bool operator==(const NullableSet &other) const { return words == other.words; }
+    bool operator!=(const NullableSet &other) const { return words != other.words; }
+
+private:
+    friend class GrammarCache;
+    std::vector<uint64_t> words;
+};
+
+// Read-only view of TerminalSet bits kept somewhere else, such as in SuffixFirstSets.
+class TerminalSetView
+{
+public:
+    TerminalSetView(const uint64_t *words, size_t count) : words(words), count(count) {}
+
+    bool test(size_t bit) const { return (words[bit >> 6] >> (bit & 63)) & 1; }
+    const uint64_t *data() const { return words; }
+    size_t wordCount() const { return count; }
+
+    // Calls f(bit) for every set bit, in increasing order.
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t w = words[i];
+            while (w)
+            {
+                f(i * 64 + static_cast<size_t>(__builtin_ctzll(w)));
+                w &= w - 1;
+            }
+        }
+    }
+
+private:
+    const uint64_t *words;
+    size_t count;
+};
+
+class TerminalSet
+{
+public:
+    TerminalSet() {}
+    explicit TerminalSet(size_t bits) : words((bits + 63) / 64, 0) {}
+
+    bool test(size_t bit) const { return (words[bit >> 6] >> (bit & 63)) & 1; }
+    TerminalSetView view() const { return TerminalSetView(words.data(), words.size()); }
+
+    // Sets bit and reports whether it was newly added.
+    bool insert(size_t bit)
+    {
+        CFG_STAT_ADD(setInserts, 1);
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        bool added = !(words[bit >> 6] & mask);
+        words[bit >> 6] |= mask;
+        return added;
+    }
+
+    // this |= other. The loop has no branches so the compiler can vectorize it.
+    bool unionWith(TerminalSetView other)
+    {
+        CFG_STAT_ADD(setInserts, 1);
+        const uint64_t *otherWords = other.data();
+        uint64_t grown = 0;
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            uint64_t merged = words[i] | otherWords[i];
+            grown |= merged ^ words[i];
+            words[i] = merged;
+        }
+        return grown != 0;
+    }
+    bool unionWith(const TerminalSet &other) { return unionWith(other.view()); }
+
+    // this |= other \ {ε}, for FIRST sets of sequences, which carry ε.
+    bool unionWithoutEpsilon(TerminalSetView other)
+    {
+        CFG_STAT_ADD(setInserts, 1);
+        const uint64_t *otherWords = other.data();
+        uint64_t grown = 0;
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            uint64_t merged = words[i] | (otherWords[i] & ~uint64_t(i == 0));   // ε is bit 0 of word 0
+            grown |= merged ^ words[i];
+            words[i] = merged;
+        }
+        return grown != 0;
+    }
+
+    bool operator==(const TerminalSet &other) const { return words == other.words; }
+    bool operator!=(const TerminalSet &other) const { return words != other.words; }
+
+    // Calls f(bit) for every set bit, in increasing order.
+    template <typename F>
+    void forEach(F f) const
+    {
+        view().forEach(f);
+    }
+
+private:
+    friend class GrammarCache;
+    std::vector<uint64_t> words;
+};
+
+// FIRST/FOLLOW bitsets are indexed by SymbolId; only non-terminal entries are meaningful.
+typedef std::vector<TerminalSet> TerminalSets;
+
+/* The nullable non-terminals, by the counter-based algorithm in time linear in the grammar:
+   each production counts the symbols of its right-hand side not yet known to be nullable.
+   When a non-terminal turns out nullable, every production it occurs in counts down once per
+   occurrence, and a production reaching zero makes its left-hand side nullable. Productions
+   with a terminal can never reach zero and are left out. */
+inline NullableSet computeNullable(const Grammar &grammar, const SymbolTable &symbols,
+                                   std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    NullableSet nullable(symbols.size());
+    std::pmr::vector<uint32_t> pending(grammar.productionCount(), 0, scratch);
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> occurrences(scratch);   // (non-terminal, production)
+    std::pmr::vector<SymbolId> found(scratch);                              // nullable, not yet counted down
+    auto discover = [&](SymbolId nt) {
+        if (nullable.test(nt))
+            return;
+        nullable.insert(nt);
+        found.push_back(nt);
+    };
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        SymbolSpan rhs = grammar.rhs(p);
+        bool onlyNonTerminals = true;
+        for (SymbolId sym : rhs)
+            onlyNonTerminals = onlyNonTerminals && symbols.isNonTerminal(sym);
+        if (!onlyNonTerminals)
+            continue;
+        pending[p] = static_cast<uint32_t>(rhs.size());
+        if (rhs.empty())
+            discover(grammar.prodLhs[p]);
+        for (SymbolId sym : rhs)
+            occurrences.emplace_back(sym, static_cast<SymbolId>(p));
+    }
+    std::pmr::vector<uint32_t> occurrenceStart(scratch);
+    std::pmr::vector<SymbolId> occurrenceAt(scratch);
+    buildAdjacency(occurrences, symbols.size(), occurrenceStart, occurrenceAt);
+    while (!found.empty())
+    {
+        SymbolId nt = found.back();
+        found.pop_back();
+        CFG_STAT_ADD(iterations, 1);
+        for (uint32_t i = occurrenceStart[nt]; i < occurrenceStart[nt + 1]; i++)
+            if (--pending[occurrenceAt[i]] == 0)
+                discover(grammar.prodLhs[occurrenceAt[i]]);
+    }
+    return nullable;
+}
+
+// Adds to FIRST(X) what its productions give with the current sets; returns whether it grew.
+inline bool refineFirst(SymbolId X, const Grammar &grammar, const SymbolTable &symbols,
+                        const TerminalIndex &terminals, const NullableSet &nullable, TerminalSets &first)
+{
+    bool changed = false;
+    for (uint32_t p = grammar.firstProduction(X); p < grammar.endProduction(X); p++)
+    {
+        for (SymbolId sym : grammar.rhs(p))
+        {
+            if (!symbols.isNonTerminal(sym))
+            {
+                changed |= first[X].insert(terminals.denseOf[sym]);
+                break;
+            }
+            changed |= first[X].unionWith(first[sym]);
+            if (!nullable.test(sym))
+                break;
+        }
+    }
+    return changed;
+}
+
+// Computes FIRST sets for all non-terminals with worklist propagation.
+// Scratch data (dependency lists, worklist) is allocated from scratch.
+inline TerminalSets firstSetWorklist(const Grammar &grammar, const SymbolTable &symbols,
+                                     const TerminalIndex &terminals, const NullableSet &nullable,
+                                     std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    TerminalSets first(symbols.size(), TerminalSet(terminals.size()));
+    // For every symbol, the non-terminals whose productions read it: these are the sets that
+    // may change when the symbol's own set grows. A production reads up to its first symbol
+    // that is not nullable.
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> mentions(scratch);
+    mentions.reserve(grammar.rhsSymbols.size());
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        for (SymbolId sym : grammar.rhs(p))
+        {
+            if (!symbols.isNonTerminal(sym))
+                break;
+            mentions.emplace_back(sym, grammar.prodLhs[p]);
+            if (!nullable.test(sym))
+                break;
+        }
+    }
+    std::pmr::vector<uint32_t> userStart(scratch);
+    std::pmr::vector<SymbolId> users(scratch);
+    buildAdjacency(mentions, symbols.size(), userStart, users);
+
+    std::pmr::deque<SymbolId> worklist(grammar.nonTerminals.begin(), grammar.nonTerminals.end(), scratch);
+    std::pmr::vector<uint8_t> queued(symbols.size(), 0, scratch);
+    for (SymbolId nt : grammar.nonTerminals)
+        queued[nt] = true;
+
+    while (!worklist.empty())
+    {
+        SymbolId X = worklist.front();
+        worklist.pop_front();
+        queued[X] = false;
+        CFG_STAT_ADD(iterations, 1);
+
+        bool changed = refineFirst(X, grammar, symbols, terminals, nullable, first);
+
+        // FIRST(X) grew, so every non-terminal reading it has to be revisited.
+        if (!changed)
+            continue;
+        for (uint32_t u = userStart[X]; u < userStart[X + 1]; u++)
+        {
+            if (!queued[users[u]])
+            {
+                queued[users[u]] = true;
+                worklist.push_back(users[u]);
+            }
+        }
+    }
+    return first;
+}
+
+/* FIRST of every production suffix rhs(p)[i..], computed once so that FOLLOW and the table
+   read it instead of walking the rest of the production again for each occurrence. One
+   right-to-left scan per production derives FIRST(rhs[i..]) from FIRST(rhs[i+1..]). Like
+   firstOfSequence(), a suffix set holds ε when the suffix is nullable.
+
+   The sets are stored back to back in one word array, and setOf maps a position in
+   rhsSymbols to its set; set 0 is {ε}, the set of every empty suffix. With shared, equal sets
+   are stored once (hash-consed), so the word array grows with the number of distinct suffix
+   sets instead of with the grammar. Either way each position costs one 32-bit set id.
+*/
+class SuffixFirstSets
+{
+public:
+    SuffixFirstSets(const Grammar &grammar, const SymbolTable &symbols, const TerminalIndex &terminals,
+                    const TerminalSets &first, const NullableSet &nullable, bool shared = false,
+                    std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : grammar(grammar), stride((terminals.size() + 63) / 64), setOf(grammar.rhsSymbols.size())
+    {
+        const uint32_t EMPTY_SLOT = UINT32_MAX;
+        std::pmr::vector<uint32_t> slots(shared ? 1024 : 0, EMPTY_SLOT, scratch);   // set ids, open addressing
+        std::pmr::vector<uint64_t> setHash(scratch);
+
+        // Returns the id of a set equal to current, adding it unless shared finds one.
+        TerminalSet current(terminals.size());
+        auto store = [&]() {
+            const uint64_t *bits = current.view().data();
+            uint32_t id = static_cast<uint32_t>(words.size() / stride);
+            if (!shared)
+            {
+                words.insert(words.end(), bits, bits + stride);
+                return id;
+            }
+            uint64_t hash = 1469598103934665603ULL;
+            for (size_t w = 0; w < stride; w++)
+                hash = (hash ^ bits[w]) * 1099511628211ULL;
+            hash ^= hash >> 29;
+            size_t mask = slots.size() - 1;
+            size_t slot = hash & mask;
+            for (; slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+                if (setHash[slots[slot]] == hash && std::equal(bits, bits + stride, words.begin() + slots[slot] * stride))
+                    return slots[slot];
+            words.insert(words.end(), bits, bits + stride);
+            setHash.push_back(hash);
+            slots[slot] = id;
+            if (setHash.size() * 2 > slots.size())
+            {
+                // Rehash at half load.
+                slots.assign(slots.size() * 2, EMPTY_SLOT);
+                size_t grownMask = slots.size() - 1;
+                for (size_t t = 0; t < setHash.size(); t++)
+                {
+                    size_t k = setHash[t] & grownMask;
+                    while (slots[k] != EMPTY_SLOT)
+                        k = (k + 1) & grownMask;
+                    slots[k] = static_cast<uint32_t>(t);
+                }
+            }
+            return id;
+        };
+
+        const TerminalSet none(terminals.size());
+        current.insert(EPSILON_BIT);
+        store();
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+        {
+            current = none;
+            current.insert(EPSILON_BIT);
+            for (uint32_t k = grammar.prodStart[p + 1]; k-- > grammar.prodStart[p];)
+            {
+                SymbolId sym = grammar.rhsSymbols[k];
+                if (!symbols.isNonTerminal(sym))
+                {
+                    current = none;
+                    current.insert(terminals.denseOf[sym]);
+                }
+                else if (nullable.test(sym))
+                    current.unionWith(first[sym]);
+                else
+                    current = first[sym];
+                setOf[k] = store();
+            }
+        }
+    }
+
+    // FIRST(rhs(p)[i..]) for 0 <= i <= rhs(p).size(), with ε when the suffix is nullable.
+    TerminalSetView suffix(size_t p, size_t i) const
+    {
+        size_t k = grammar.prodStart[p] + i;
+        return set(k < grammar.prodStart[p + 1] ? setOf[k] : 0);
+    }
+    // FIRST of the whole right-hand side, as firstOfSequence(grammar.rhs(p)) gives it.
+    TerminalSetView production(size_t p) const { return suffix(p, 0); }
+
+    size_t distinctSets() const { return words.size() / stride; }
+    size_t bytes() const { return words.size() * sizeof(uint64_t) + setOf.size() * sizeof(uint32_t); }
+
+private:
+    const Grammar &grammar;
+    size_t stride;                   // words per set
+    std::vector<uint64_t> words;     // the sets, stride words each
+    std::vector<uint32_t> setOf;     // indexed by position in rhsSymbols
+
+    TerminalSetView set(uint32_t id) const { return TerminalSetView(words.data() + id * stride, stride); }
+};
+
+/* First half of FOLLOW: fills follow with everything FIRST contributes ($ for the start symbol,
+   FIRST(β) for A -> α B β) and collects the (A, B) pairs with FOLLOW(A) ⊆ FOLLOW(B),
+   i.e. productions A -> α B β with nullable β. FIRST(β) is read from suffixes, so each
+   occurrence costs one set union. */
+inline void followContributions(const Grammar &grammar, const SuffixFirstSets &suffixes,
+                                const SymbolTable &symbols, const TerminalIndex &terminals, SymbolId startSymbol,
+                                TerminalSets &follow, std::pmr::vector<std::pair<SymbolId, SymbolId>> &edges)
+{
+    follow.assign(symbols.size(), TerminalSet(terminals.size()));
+    follow[startSymbol].insert(terminals.denseOf[END_MARKER]);
+
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        SymbolId A = grammar.prodLhs[p];
+        SymbolSpan prod = grammar.rhs(p);
+        for (size_t i = 0; i < prod.size(); i++)
+        {
+            SymbolId B = prod[i];
+            if (!symbols.isNonTerminal(B))
+                continue;
+            TerminalSetView beta = suffixes.suffix(p, i + 1);
+            follow[B].unionWithoutEpsilon(beta);
+            if (beta.test(EPSILON_BIT) && A != B)
+                edges.emplace_back(A, B);
+        }
+    }
+}
+
+// Computes FOLLOW sets for all non-terminals with worklist propagation.
+// Contributions from FIRST are added in a single pass; what remains is the FOLLOW(A) ⊆ FOLLOW(B)
+// edges for productions A -> α B β with nullable β, which the worklist closes over.
+inline TerminalSets followSetWorklist(const Grammar &grammar, const SuffixFirstSets &suffixes,
+                                      const SymbolTable &symbols, const TerminalIndex &terminals,
+                                      SymbolId startSymbol,
+                                      std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    TerminalSets follow;
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> edges(scratch);   // (A, B) with FOLLOW(A) ⊆ FOLLOW(B)
+    followContributions(grammar, suffixes, symbols, terminals, startSymbol, follow, edges);
+    std::pmr::vector<uint32_t> feedStart(scratch);
+    std::pmr::vector<SymbolId> feeds(scratch);
+    buildAdjacency(edges, symbols.size(), feedStart, feeds);
+
+    std::pmr::deque<SymbolId> worklist(grammar.nonTerminals.begin(), grammar.nonTerminals.end(), scratch);
+    std::pmr::vector<uint8_t> queued(symbols.size(), 0, scratch);
+    for (SymbolId nt : grammar.nonTerminals)
+        queued[nt] = true;
+    while (!worklist.empty())
+    {
+        SymbolId A = worklist.front();
+        worklist.pop_front();
+        queued[A] = false;
+        CFG_STAT_ADD(iterations, 1);
+        for (uint32_t f = feedStart[A]; f < feedStart[A + 1]; f++)
+        {
+            SymbolId B = feeds[f];
+            if (follow[B].unionWith(follow[A]) && !queued[B])
+            {
+                queued[B] = true;
+                worklist.push_back(B);
+            }
+        }
+    }
+    return follow;
+}
+
+// FIRST of a symbol sequence (a production right-hand side). Unlike the FIRST sets of
+// non-terminals, it includes ε when the whole sequence can derive ε, which is what the
+// table builder needs to know.
+inline TerminalSet firstOfSequence(SymbolSpan tokens, const TerminalSets &first, const NullableSet &nullable,
+                                   const SymbolTable &symbols, const TerminalIndex &terminals)
+{
+    TerminalSet result(terminals.size());
+    for (SymbolId token : tokens)
+    {
+        if (!symbols.isNonTerminal(token))
+        {
+            result.insert(terminals.denseOf[token]);
+            return result;
+        }
+        result.unionWith(first[token]);
+        if (!nullable.test(token))
+            return result;
+    }
+    result.insert(EPSILON_BIT);
+    return result;
+}
+
+#endif
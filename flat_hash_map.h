@@ -0,0 +1,150 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+/* Open-addressing hash map with linear probing, for the lookup tables of the grammar pipeline.
+   Keys and values sit in one flat slot array next to a parallel array of 32-bit hash tags, so
+   a lookup is one multiply, a short forward scan of the tags and usually a single key
+   comparison; there is no node per entry and no bucket list to chase. Entries are never
+   erased one at a time, which keeps probing free of tombstones; clear() empties the map and
+   keeps its capacity for the next use unless the map was mostly empty.
+
+   The map has no iteration order of its own. Tables whose order reaches the output keep it
+   beside the map, as an id assigned on insertion (SymbolTable's names, the DFA state list),
+   so output stays identical however keys hash.
+*/
+
+// Hash of a sequence of integers, for keys such as sorted NFA state sets.
+struct SequenceHash
+{
+    template <typename Sequence>
+    size_t operator()(const Sequence &sequence) const
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (auto value : sequence)
+            hash = (hash ^ static_cast<uint64_t>(value)) * 0x100000001b3ull;
+        return static_cast<size_t>(hash);
+    }
+};
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    explicit FlatHashMap(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : tags(resource), slots(resource)
+    {
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // The value stored for key, or nullptr.
+    Value *find(const Key &key)
+    {
+        if (count == 0)
+            return nullptr;
+        uint64_t hash = mix(key);
+        for (size_t i = home(hash);; i = (i + 1) & mask)
+        {
+            if (tags[i] == EMPTY)
+                return nullptr;
+            if (tags[i] == tagOf(hash) && equal(slots[i].first, key))
+                return &slots[i].second;
+        }
+    }
+    const Value *find(const Key &key) const { return const_cast<FlatHashMap *>(this)->find(key); }
+
+    bool contains(const Key &key) const { return find(key) != nullptr; }
+
+    // Inserts key with value unless it is present; returns the stored value and whether it was new.
+    std::pair<Value *, bool> emplace(const Key &key, Value value)
+    {
+        if ((count + 1) * 4 > tags.size() * 3)
+            grow();
+        uint64_t hash = mix(key);
+        size_t i = home(hash);
+        for (; tags[i] != EMPTY; i = (i + 1) & mask)
+            if (tags[i] == tagOf(hash) && equal(slots[i].first, key))
+                return {&slots[i].second, false};
+        tags[i] = tagOf(hash);
+        slots[i].first = key;
+        slots[i].second = std::move(value);
+        count++;
+        return {&slots[i].second, true};
+    }
+
+    Value &operator[](const Key &key) { return *emplace(key, Value()).first; }
+
+    void reserve(size_t entries)
+    {
+        while (entries * 4 > tags.size() * 3)
+            grow();
+    }
+
+    // A table that was mostly empty is given up rather than wiped, so clearing costs what the
+    // map held and not the largest size it ever had.
+    void clear()
+    {
+        if (count == 0)
+            return;
+        if (count * 8 < tags.size())
+        {
+            std::pmr::vector<uint32_t>(tags.get_allocator()).swap(tags);
+            std::pmr::vector<std::pair<Key, Value>>(slots.get_allocator()).swap(slots);
+            mask = 0;
+            shift = 64;
+        }
+        else
+            std::fill(tags.begin(), tags.end(), EMPTY);
+        count = 0;
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0;
+
+    std::pmr::vector<uint32_t> tags;   // EMPTY, or the high hash bits of the slot's key with bit 0 set
+    std::pmr::vector<std::pair<Key, Value>> slots;
+    size_t count = 0;
+    size_t mask = 0;
+    unsigned shift = 64;
+    Hash hasher;
+    Equal equal;
+
+    // Fibonacci hashing spreads identity-like hashes (std::hash of an integer) over the table.
+    uint64_t mix(const Key &key) const { return static_cast<uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ull; }
+    size_t home(uint64_t hash) const { return shift == 64 ? 0 : static_cast<size_t>(hash >> shift); }
+    static uint32_t tagOf(uint64_t hash) { return static_cast<uint32_t>(hash >> 32) | 1; }
+
+    void grow()
+    {
+        size_t capacity = tags.empty() ? 16 : tags.size() * 2;
+        std::pmr::vector<uint32_t> oldTags(capacity, EMPTY, tags.get_allocator());
+        std::pmr::vector<std::pair<Key, Value>> oldSlots(capacity, slots.get_allocator());
+        oldTags.swap(tags);
+        oldSlots.swap(slots);
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+            shift--;
+        for (size_t j = 0; j < oldTags.size(); j++)
+        {
+            if (oldTags[j] == EMPTY)
+                continue;
+            size_t i = home(mix(oldSlots[j].first));
+            while (tags[i] != EMPTY)
+                i = (i + 1) & mask;
+            tags[i] = oldTags[j];
+            slots[i] = std::move(oldSlots[j]);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef GRAMMAR_ANALYZER_H
+#define GRAMMAR_ANALYZER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "grammar_loader.h"
+#include "grammar_cache.h"
+#include "first_follow.h"
+#include "reference_sets.h"
+#include "parallel_sets.h"
+#include "left_factoring.h"
+#include "trie_factoring.h"
+#include "left_recursion.h"
+#include "grammar_simplifier.h"
+#include "ll1_table.h"
+#include "analysis.h"
+#include "incremental.h"
+#include "phase_memory.h"
+#include "phase_stats.h"
+
+/* Library interface to the whole cfg_parser pipeline, for grammars that are already in memory.
+
+   GrammarAnalyzer::analyze() tokenizes the text in place and runs the five phases:
+   left factoring, left recursion removal, FIRST, FOLLOW and the LL(1) table. The
+   AnalysisResult is owned by the analyzer. result() returns it by reference, and it stays
+   valid until the next analyze(). The last analysis also stays warm between calls. The same
+   text again is answered from it without running anything. With AnalyzerOptions::incremental,
+   an edited text is brought up to date from it by IncrementalAnalyzer.
+*/
+
+struct AnalyzerOptions
+{
+    bool referenceEngine = false;   // the std::set round-robin fixpoints of reference_sets.h
+    bool checkEngines = false;      // run both engines and fail if their sets differ
+    bool trieFactoring = false;     // factor every shared prefix, not just the first one
+    size_t threads = 0;             // FIRST/FOLLOW by SCC on this many threads; 0 runs sequentially
+    bool incremental = false;       // update the previous analysis instead of starting over
+    bool sharedSuffixes = false;    // store each distinct suffix FIRST set once (hash-consing)
+    bool simplify = false;          // drop non-productive, unreachable and unit-chain rules first
+
+    // The options that change the analysis, as they go into cache keys; empty for the defaults.
+    std::string key() const
+    {
+        std::string key = trieFactoring ? "factor=trie" : "";
+        if (simplify)
+            key += key.empty() ? "simplify" : ",simplify";
+        return key;
+    }
+
+    // The reference engine and --check-engines are about the full fixpoints, so they always run
+    // them. Simplification can remove rules an edit does not touch, so it needs them too.
+    bool updatesIncrementally() const { return incremental && !referenceEngine && !checkEngines && !simplify; }
+};
+
+// How analyze() arrived at its result.
+enum class AnalysisMode
+{
+    Full,          // all five phases ran
+    Incremental,   // the previous analysis was updated for the edit
+    Reused         // the text was the one analyzed last time
+};
+
+class GrammarAnalyzer
+{
+public:
+    /* scratch supplies the chunks of every phase arena and the loader's staging buffers. A
+       pool resource that outlives the analyzer lets a series of analyses reuse them. */
+    explicit GrammarAnalyzer(const AnalyzerOptions &options = AnalyzerOptions(),
+                             std::pmr::memory_resource *scratch = std::pmr::new_delete_resource())
+        : options(options), scratch(scratch), pool(options.threads) {}
+
+    GrammarAnalyzer(const GrammarAnalyzer &) = delete;
+    GrammarAnalyzer &operator=(const GrammarAnalyzer &) = delete;
+
+    // Makes previous (say, an analysis loaded from a cache) what the next analyze() updates
+    // incrementally. It is never answered from as it is, since its text is unknown.
+    void setBaseline(AnalysisResult &&previous)
+    {
+        current = std::move(previous);
+        hasBaseline = true;
+        reusable = false;
+    }
+
+    /* Analyzes the grammar in text, which only has to stay valid during the call. Returns false,
+       with the message in error() and result() unchanged, for a text without rules or when
+       checkEngines finds the two engines disagreeing. */
+    bool analyze(std::string_view text)
+    {
+        message.clear();
+        phaseMemory.clear();
+        phaseStats.clear();
+        triedUpdate = false;
+        uint64_t hash = hashGrammarText(text, options.key());
+        if (reusable && hash == currentHash)
+        {
+            load = LoadStats();
+            lastMode = AnalysisMode::Reused;
+            return true;
+        }
+
+        AnalysisResult next;
+        next.inputGrammar = parseGrammarText(text, next.symbols, &load, scratch);
+        if (next.inputGrammar.nonTerminals.empty())
+        {
+            message = "Error: the grammar defines no rules.\n";
+            return false;
+        }
+        bool updated = options.updatesIncrementally() && hasBaseline && updateFromBaseline(next);
+        if (!updated && !runPhases(next))
+            return false;
+        current = std::move(next);
+        currentHash = hash;
+        hasBaseline = reusable = true;
+        lastMode = updated ? AnalysisMode::Incremental : AnalysisMode::Full;
+        return true;
+    }
+
+    // Stops the current result from being reused or updated: the next analyze() runs the phases.
+    void forget() { hasBaseline = reusable = false; }
+
+    const AnalysisResult &result() const { return current; }
+    const std::string &error() const { return message; }
+    AnalysisMode mode() const { return lastMode; }
+
+    // Whether the last analyze() attempted an incremental update; report() covers it when that
+    // succeeded, i.e. when mode() is Incremental.
+    bool triedIncremental() const { return triedUpdate; }
+    const IncrementalReport &report() const { return updateReport; }
+
+    // What the last analyze() measured; empty when its result was reused.
+    const LoadStats &loadStats() const { return load; }
+    const std::vector<PhaseMemory> &memory() const { return phaseMemory; }
+    const std::vector<PhaseStats> &stats() const { return phaseStats; }
+
+private:
+    AnalyzerOptions options;
+    std::pmr::memory_resource *scratch;
+    WorkStealingPool pool;
+    AnalysisResult current;
+    uint64_t currentHash = 0;
+    bool hasBaseline = false;      // current can be updated incrementally
+    bool reusable = false;         // current is the analysis of the text hashing to currentHash
+    AnalysisMode lastMode = AnalysisMode::Full;
+    bool triedUpdate = false;
+    IncrementalReport updateReport;
+    std::string message;
+    LoadStats load;
+    std::vector<PhaseMemory> phaseMemory;
+    std::vector<PhaseStats> phaseStats;
+
+    void factor(SymbolId nt, const Grammar &grammar, GrammarBuilder &out, SymbolTable &symbols,
+                LeftFactoringTrie &trie) const
+    {
+        if (options.trieFactoring)
+            trie.factor(nt, grammar, out, symbols);
+        else
+            leftFactor(nt, grammar, out, symbols);
+    }
+
+    // Brings current up to date for the grammar loaded into next; false if the edit needs the full analysis.
+    bool updateFromBaseline(AnalysisResult &next)
+    {
+        triedUpdate = true;
+        updateReport = IncrementalReport();
+        PhaseArena arena("incremental", scratch);
+        bool updated;
+        {
+            IncrementalAnalyzer analyzer(current, arena.resource());
+            LeftFactoringTrie trie(arena.resource());
+            auto transform = [&](SymbolId nt, const Grammar &grammar, GrammarBuilder &out, SymbolTable &symbols) {
+                factor(nt, grammar, out, symbols, trie);
+            };
+            updated = analyzer.update(next, transform, updateReport, phaseStats);
+        }
+        phaseMemory.push_back(arena.finish());
+        return updated;
+    }
+
+    /* Reports every non-terminal whose set differs between the two engines; returns the mismatch count. */
+    size_t compareSets(const std::string &label, const TerminalSets &reference, const TerminalSets &sets,
+                       const Grammar &grammar, const SymbolTable &symbols)
+    {
+        size_t mismatches = 0;
+        for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+        {
+            if (reference[nt] == sets[nt])
+                continue;
+            message += label + "(" + symbols.name(nt) + ") differs between the reference and bitset engines\n";
+            mismatches++;
+        }
+        return mismatches;
+    }
+
+    // Same for nullability, which the bitset engines keep out of the FIRST sets.
+    size_t compareNullable(const NullableSet &reference, const NullableSet &nullable, const Grammar &grammar,
+                           const SymbolTable &symbols)
+    {
+        size_t mismatches = 0;
+        for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+        {
+            if (reference.test(nt) == nullable.test(nt))
+                continue;
+            message += "Nullability of " + symbols.name(nt) + " differs between the reference and bitset engines\n";
+            mismatches++;
+        }
+        return mismatches;
+    }
+
+    /* Runs Phases 1-5 on result.inputGrammar, simplified first with options.simplify. Returns
+       false if checkEngines found a mismatch. Each phase keeps its scratch data in its own
+       arena; what it used is appended to phaseMemory. */
+    bool runPhases(AnalysisResult &result)
+    {
+        SymbolTable &symbols = result.symbols;
+
+        // --- Simplification (optional): useless, unreachable and unit-chain rules ---
+        Grammar simplified;
+        if (options.simplify)
+        {
+            PhaseArena arena("simplification", scratch);
+            PhaseStatsProbe probe("simplification", phaseStats);
+            simplified = simplifyGrammar(result.inputGrammar, symbols.size(), result.simplification, arena.resource());
+            probe.finish(simplified.productionCount());
+            phaseMemory.push_back(arena.finish());
+        }
+        const Grammar &grammar = options.simplify ? simplified : result.inputGrammar;
+
+        // --- Phase 1: Left Factoring ---
+        {
+            PhaseArena arena("left factoring", scratch);
+            PhaseStatsProbe probe("left factoring", phaseStats);
+            size_t symbolsBefore = symbols.size();
+            {
+                // Everything built on the arena has to be gone before finish() releases it.
+                GrammarBuilder factoring(arena.resource());
+                LeftFactoringTrie trie(arena.resource());
+                // Phases visit non-terminals in name order, as the string-keyed maps used to.
+                for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+                    factor(nt, grammar, factoring, symbols, trie);
+                result.factoredGrammar = factoring.build(grammar.startSymbol, symbols.size());
+            }
+            probe.finish(result.factoredGrammar.productionCount(), symbols.size() - symbolsBefore);
+            phaseMemory.push_back(arena.finish());
+        }
+        const Grammar &factoredGrammar = result.factoredGrammar;
+
+        // --- Phase 2: Left Recursion Removal ---
+        {
+            PhaseArena arena("left recursion", scratch);
+            PhaseStatsProbe probe("left recursion", phaseStats);
+            size_t symbolsBefore = symbols.size();
+            {
+                GrammarBuilder recursionRemoval(arena.resource());
+                LeftRecursionEliminator eliminator(arena.resource());
+                eliminator.eliminate(factoredGrammar, sortedByName(factoredGrammar.nonTerminals, symbols),
+                                     recursionRemoval, symbols, result.recursionReports);
+                result.finalGrammar = recursionRemoval.build(factoredGrammar.startSymbol, symbols.size());
+            }
+            probe.finish(result.finalGrammar.productionCount(), symbols.size() - symbolsBefore);
+            phaseMemory.push_back(arena.finish());
+        }
+        const Grammar &finalGrammar = result.finalGrammar;
+
+        // FIRST and FOLLOW are bitsets over the terminals of the final grammar.
+        result.terminals = TerminalIndex(finalGrammar, symbols);
+        const TerminalIndex &terminals = result.terminals;
+        bool runReference = options.referenceEngine || options.checkEngines;
+        bool runBitset = !options.referenceEngine || options.checkEngines;
+
+        // --- Phase 3: FIRST Set Computation ---
+        // The bitset engines settle nullability first, in one linear pass, and keep ε out of FIRST.
+        // FIRST of every production suffix is then tabulated for FOLLOW and the table.
+        SymbolSets referenceFirst;
+        TerminalSets &firstSets = result.firstSets;
+        NullableSet &nullable = result.nullable;
+        std::optional<SuffixFirstSets> suffixes;
+        {
+            PhaseArena arena("FIRST sets", scratch);
+            PhaseStatsProbe probe("FIRST sets", phaseStats);
+            if (runReference)
+                referenceFirst = firstSet(finalGrammar, symbols);
+            if (runBitset)
+                nullable = computeNullable(finalGrammar, symbols, arena.resource());
+            if (runBitset && options.threads > 0)
+                firstSets = firstSetParallel(finalGrammar, symbols, terminals, nullable, pool, arena.resource());
+            else if (runBitset)
+                firstSets = firstSetWorklist(finalGrammar, symbols, terminals, nullable, arena.resource());
+            if (runBitset)
+                suffixes.emplace(finalGrammar, symbols, terminals, firstSets, nullable, options.sharedSuffixes,
+                                 arena.resource());
+            probe.finish();
+            phaseMemory.push_back(arena.finish());
+        }
+
+        // --- Phase 4: FOLLOW Set Computation ---
+        SymbolSets referenceFollow;
+        TerminalSets &followSets = result.followSets;
+        {
+            PhaseArena arena("FOLLOW sets", scratch);
+            PhaseStatsProbe probe("FOLLOW sets", phaseStats);
+            if (runReference)
+                referenceFollow = computeFollowSets(finalGrammar, referenceFirst, symbols, finalGrammar.startSymbol);
+            if (runBitset && options.threads > 0)
+                followSets = followSetParallel(finalGrammar, *suffixes, symbols, terminals,
+                                               finalGrammar.startSymbol, pool, arena.resource());
+            else if (runBitset)
+                followSets = followSetWorklist(finalGrammar, *suffixes, symbols, terminals,
+                                               finalGrammar.startSymbol, arena.resource());
+            probe.finish();
+            phaseMemory.push_back(arena.finish());
+        }
+
+        if (options.checkEngines)
+        {
+            size_t mismatches = compareNullable(toNullableSet(referenceFirst), nullable, finalGrammar, symbols)
+                              + compareSets("FIRST", toTerminalSets(referenceFirst, terminals), firstSets, finalGrammar, symbols)
+                              + compareSets("FOLLOW", toTerminalSets(referenceFollow, terminals), followSets, finalGrammar, symbols);
+            if (mismatches > 0)
+                return false;
+        }
+        if (options.referenceEngine)
+        {
+            nullable = toNullableSet(referenceFirst);
+            firstSets = toTerminalSets(referenceFirst, terminals);
+            followSets = toTerminalSets(referenceFollow, terminals);
+        }
+
+        // --- Phase 5: LL(1) Parsing Table Construction ---
+        // The parsing table is a dense [non-terminal x terminal] array of production indices.
+        PhaseArena tableArena("LL(1) table", scratch);
+        PhaseStatsProbe tableProbe("LL(1) table", phaseStats);
+        if (options.referenceEngine)
+            result.parsingTable = buildLL1Table(finalGrammar, followSets, terminals, [&](uint32_t p) {
+                return toTerminalSet(computeFirstOfString(finalGrammar.rhs(p), referenceFirst, symbols), terminals);
+            });
+        else
+            result.parsingTable = buildLL1Table(finalGrammar, followSets, terminals,
+                                                [&](uint32_t p) { return suffixes->production(p); });
+        tableProbe.finish();
+        phaseMemory.push_back(tableArena.finish());
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,427 @@
+#ifndef GRAMMAR_CACHE_H
+#define GRAMMAR_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "analysis.h"
+
+// FNV-1a over the raw grammar file, followed by a description of the options that shape the
+// analysis (empty for the defaults); the cache is only used when this matches.
+inline uint64_t hashGrammarText(std::string_view text, std::string_view config = "")
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    for (unsigned char c : config)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Versioned binary image of an AnalysisResult.
+
+   Layout: a fixed CacheHeader followed by length-prefixed arrays, each padded to 8 bytes,
+   in the order save() writes them. Arrays are copied out of the mapped file with memcpy, so
+   loading does no text processing at all; only the symbol table is rebuilt from the names.
+   The header also carries the hash of the options alone, so a cache written for an older
+   version of the grammar can still seed an incremental update (loadPrevious), and a hash of
+   everything after it. A file that fails the hash, or whose arrays do not fit together (CSR
+   offsets, symbol ids, table shape; see validBody), is not loaded and the phases run instead.
+*/
+class GrammarCache
+{
+public:
+    static constexpr uint32_t VERSION = 4;
+
+    // Writes the cache atomically (temporary file, then rename).
+    static bool save(const std::string &path, uint64_t grammarHash, uint64_t configHash, const AnalysisResult &result)
+    {
+        std::vector<char> out;
+        CacheHeader header;
+        header.grammarHash = grammarHash;
+        header.configHash = configHash;
+        append(out, &header, sizeof(header));
+
+        // Symbols: concatenated names with offsets, plus the non-terminal bitmap.
+        std::vector<char> nameChars;
+        std::vector<uint32_t> nameStart;
+        std::vector<uint8_t> nonTerminal;
+        for (size_t id = 0; id < result.symbols.size(); id++)
+        {
+            const std::string &name = result.symbols.name(static_cast<SymbolId>(id));
+            nameStart.push_back(static_cast<uint32_t>(nameChars.size()));
+            nameChars.insert(nameChars.end(), name.begin(), name.end());
+            nonTerminal.push_back(result.symbols.isNonTerminal(static_cast<SymbolId>(id)) ? 1 : 0);
+        }
+        nameStart.push_back(static_cast<uint32_t>(nameChars.size()));
+        putArray(out, nameChars);
+        putArray(out, nameStart);
+        putArray(out, nonTerminal);
+
+        putGrammar(out, result.inputGrammar);
+        putGrammar(out, result.factoredGrammar);
+        putGrammar(out, result.finalGrammar);
+
+        putArray(out, result.terminals.denseOf);
+        putArray(out, result.terminals.symbolOf);
+        putArray(out, result.nullable.words);
+        putSets(out, result.firstSets);
+        putSets(out, result.followSets);
+
+        const LL1Table &table = result.parsingTable;
+        std::vector<uint64_t> shape = {table.columns, table.wide ? 1u : 0u};
+        putArray(out, shape);
+        putArray(out, table.cells16);
+        putArray(out, table.cells32);
+        putArray(out, table.rowOf);
+        putArray(out, table.rowSymbol);
+        std::vector<TableConflict> conflicts = table.conflicts;
+        putArray(out, conflicts);
+
+        header.payloadHash = hashPayload(out.data() + sizeof(header), out.size() - sizeof(header));
+        std::memcpy(out.data(), &header, sizeof(header));
+
+        std::string temp = path + ".tmp";
+        FILE *file = std::fopen(temp.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        written = std::fclose(file) == 0 && written;
+        return written && std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    // Maps the cache file and fills result from it. Returns false if the file is missing, was
+    // written by another version, or belongs to a different grammar.
+    static bool load(const std::string &path, uint64_t grammarHash, AnalysisResult &result)
+    {
+        return loadMatching(path, &grammarHash, nullptr, result);
+    }
+
+    // Like load(), but takes the cache whatever grammar it was written for, as long as the
+    // options that shape the analysis were the same.
+    static bool loadPrevious(const std::string &path, uint64_t configHash, AnalysisResult &result)
+    {
+        return loadMatching(path, nullptr, &configHash, result);
+    }
+
+private:
+    struct CacheHeader
+    {
+        char magic[8] = {'C', 'F', 'G', 'C', 'A', 'C', 'H', 'E'};
+        uint32_t version = VERSION;
+        uint32_t reserved = 0;
+        uint64_t grammarHash = 0;
+        uint64_t configHash = 0;
+        uint64_t payloadHash = 0;
+    };
+
+    // FNV-1a over 64-bit words; every array is padded to 8 bytes, and so is the payload.
+    static uint64_t hashPayload(const char *data, size_t bytes)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (size_t pos = 0; pos + 8 <= bytes; pos += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + pos, sizeof(word));
+            hash ^= word;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static bool loadMatching(const std::string &path, const uint64_t *grammarHash, const uint64_t *configHash,
+                             AnalysisResult &result)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CacheHeader)))
+        {
+            ::close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+
+        Reader in{static_cast<const char *>(mapped), size, 0, true};
+        CacheHeader header;
+        in.read(&header, sizeof(header));
+        bool ok = std::memcmp(header.magic, CacheHeader().magic, sizeof(header.magic)) == 0 &&
+                  header.version == VERSION && (!grammarHash || header.grammarHash == *grammarHash) &&
+                  (!configHash || header.configHash == *configHash) &&
+                  header.payloadHash == hashPayload(in.data + in.pos, size - in.pos) && loadBody(in, result) &&
+                  validBody(result);
+        ::munmap(mapped, size);
+        return ok;
+    }
+
+    struct Reader
+    {
+        const char *data;
+        size_t size;
+        size_t pos;
+        bool ok;
+
+        void read(void *dest, size_t bytes)
+        {
+            if (!ok || bytes > size - pos)
+            {
+                ok = false;
+                return;
+            }
+            if (bytes == 0)
+                return;   // dest may be null for an empty array
+            std::memcpy(dest, data + pos, bytes);
+            pos += bytes;
+        }
+
+        template <typename T>
+        void getArray(std::vector<T> &values)
+        {
+            uint64_t count = 0;
+            read(&count, sizeof(count));
+            if (!ok || count > (size - pos) / sizeof(T))
+            {
+                ok = false;
+                return;
+            }
+            values.resize(count);
+            read(values.data(), count * sizeof(T));
+            pos = std::min(size, (pos + 7) & ~size_t(7));
+        }
+    };
+
+    static void append(std::vector<char> &out, const void *data, size_t bytes)
+    {
+        const char *p = static_cast<const char *>(data);
+        out.insert(out.end(), p, p + bytes);
+    }
+
+    template <typename T>
+    static void putArray(std::vector<char> &out, const std::vector<T> &values)
+    {
+        uint64_t count = values.size();
+        append(out, &count, sizeof(count));
+        append(out, values.data(), values.size() * sizeof(T));
+        out.resize((out.size() + 7) & ~size_t(7), 0);
+    }
+
+    static void putGrammar(std::vector<char> &out, const Grammar &g)
+    {
+        std::vector<SymbolId> start = {g.startSymbol};
+        putArray(out, start);
+        putArray(out, g.nonTerminals);
+        putArray(out, g.rhsSymbols);
+        putArray(out, g.prodStart);
+        putArray(out, g.prodLhs);
+        putArray(out, g.ruleBegin);
+        putArray(out, g.ruleEnd);
+    }
+
+    static void getGrammar(Reader &in, Grammar &g)
+    {
+        std::vector<SymbolId> start;
+        in.getArray(start);
+        g.startSymbol = start.empty() ? NO_SYMBOL : start[0];
+        in.getArray(g.nonTerminals);
+        in.getArray(g.rhsSymbols);
+        in.getArray(g.prodStart);
+        in.getArray(g.prodLhs);
+        in.getArray(g.ruleBegin);
+        in.getArray(g.ruleEnd);
+    }
+
+    // Sets are stored as one word count followed by all words back to back.
+    static void putSets(std::vector<char> &out, const TerminalSets &sets)
+    {
+        std::vector<uint64_t> shape = {sets.size(), sets.empty() ? 0 : sets[0].words.size()};
+        std::vector<uint64_t> words;
+        for (const auto &set : sets)
+            words.insert(words.end(), set.words.begin(), set.words.end());
+        putArray(out, shape);
+        putArray(out, words);
+    }
+
+    static void getSets(Reader &in, TerminalSets &sets)
+    {
+        std::vector<uint64_t> shape, words;
+        in.getArray(shape);
+        in.getArray(words);
+        if (!in.ok || shape.size() != 2 || shape[1] == 0 || words.size() % shape[1] != 0 ||
+            words.size() / shape[1] != shape[0])
+        {
+            in.ok = false;
+            return;
+        }
+        sets.assign(shape[0], TerminalSet());
+        for (size_t i = 0; i < shape[0]; i++)
+            sets[i].words.assign(words.begin() + i * shape[1], words.begin() + (i + 1) * shape[1]);
+    }
+
+    static bool loadBody(Reader &in, AnalysisResult &result)
+    {
+        std::vector<char> nameChars;
+        std::vector<uint32_t> nameStart;
+        std::vector<uint8_t> nonTerminal;
+        in.getArray(nameChars);
+        in.getArray(nameStart);
+        in.getArray(nonTerminal);
+        if (!in.ok || nameStart.size() != nonTerminal.size() + 1 || nonTerminal.size() < 2)
+            return false;
+        // The reserved symbols are interned by the constructor; the rest follow in id order.
+        for (size_t id = 2; id < nonTerminal.size(); id++)
+        {
+            if (nameStart[id] > nameStart[id + 1] || nameStart[id + 1] > nameChars.size())
+                return false;
+            std::string name(nameChars.data() + nameStart[id], nameStart[id + 1] - nameStart[id]);
+            SymbolId sym = result.symbols.intern(name);
+            if (nonTerminal[id])
+                result.symbols.markNonTerminal(sym);
+        }
+
+        getGrammar(in, result.inputGrammar);
+        getGrammar(in, result.factoredGrammar);
+        getGrammar(in, result.finalGrammar);
+
+        in.getArray(result.terminals.denseOf);
+        in.getArray(result.terminals.symbolOf);
+        in.getArray(result.nullable.words);
+        getSets(in, result.firstSets);
+        getSets(in, result.followSets);
+
+        LL1Table &table = result.parsingTable;
+        std::vector<uint64_t> shape;
+        in.getArray(shape);
+        if (!in.ok || shape.size() != 2)
+            return false;
+        table.columns = shape[0];
+        table.wide = shape[1] != 0;
+        in.getArray(table.cells16);
+        in.getArray(table.cells32);
+        in.getArray(table.rowOf);
+        in.getArray(table.rowSymbol);
+        in.getArray(table.conflicts);
+        return in.ok && result.symbols.size() == nonTerminal.size();
+    }
+
+    // CSR offsets in order and in range, and every symbol id below symbolCount.
+    static bool validGrammar(const Grammar &g, size_t symbolCount)
+    {
+        auto symbol = [&](SymbolId sym) { return sym >= 0 && static_cast<size_t>(sym) < symbolCount; };
+        size_t productions = g.prodLhs.size();
+        if (g.prodStart.empty())   // a grammar never built
+            return productions == 0 && g.rhsSymbols.empty() && g.nonTerminals.empty();
+        if ((g.startSymbol != NO_SYMBOL && !symbol(g.startSymbol)) || g.prodStart.size() != productions + 1 ||
+            g.prodStart[0] != 0 || g.prodStart.back() != g.rhsSymbols.size() || g.ruleBegin.size() != g.ruleEnd.size() ||
+            g.ruleBegin.size() > symbolCount)
+            return false;
+        for (size_t p = 0; p < productions; p++)
+            if (g.prodStart[p] > g.prodStart[p + 1] || !symbol(g.prodLhs[p]))
+                return false;
+        for (SymbolId sym : g.rhsSymbols)
+            if (!symbol(sym))
+                return false;
+        for (size_t nt = 0; nt < g.ruleBegin.size(); nt++)
+            if (g.ruleBegin[nt] > g.ruleEnd[nt] || g.ruleEnd[nt] > productions)
+                return false;
+        for (SymbolId nt : g.nonTerminals)
+        {
+            if (!symbol(nt) || static_cast<size_t>(nt) >= g.ruleBegin.size())
+                return false;
+            for (uint32_t p = g.ruleBegin[nt]; p < g.ruleEnd[nt]; p++)
+                if (g.prodLhs[p] != nt)
+                    return false;
+        }
+        return true;
+    }
+
+    // Whether the loaded arrays fit together, so no phase can index out of bounds with them.
+    static bool validBody(const AnalysisResult &result)
+    {
+        size_t symbolCount = result.symbols.size();
+        const Grammar &grammar = result.finalGrammar;
+        if (!validGrammar(result.inputGrammar, symbolCount) || !validGrammar(result.factoredGrammar, symbolCount) ||
+            !validGrammar(grammar, symbolCount))
+            return false;
+
+        const TerminalIndex &terminals = result.terminals;
+        if (terminals.denseOf.size() != symbolCount || terminals.size() < 2 || terminals.size() > symbolCount)
+            return false;
+        for (size_t c = 0; c < terminals.size(); c++)
+        {
+            SymbolId sym = terminals.symbolOf[c];
+            if (sym < 0 || static_cast<size_t>(sym) >= symbolCount || terminals.denseOf[sym] != static_cast<int32_t>(c))
+                return false;
+        }
+        for (int32_t column : terminals.denseOf)
+            if (column < -1 || column >= static_cast<int32_t>(terminals.size()))
+                return false;
+
+        size_t words = (terminals.size() + 63) / 64;
+        if (result.nullable.words.size() != (symbolCount + 63) / 64 || result.firstSets.size() != symbolCount ||
+            result.followSets.size() != symbolCount || result.firstSets[0].words.size() != words ||
+            result.followSets[0].words.size() != words)
+            return false;
+        // Bits past the last terminal (or symbol) would read past the arrays they index.
+        auto tailClear = [](const std::vector<uint64_t> &bits, size_t used) {
+            return used % 64 == 0 || (bits.back() >> (used % 64)) == 0;
+        };
+        if (!tailClear(result.nullable.words, symbolCount))
+            return false;
+        for (size_t sym = 0; sym < symbolCount; sym++)
+            if (!tailClear(result.firstSets[sym].words, terminals.size()) ||
+                !tailClear(result.followSets[sym].words, terminals.size()))
+                return false;
+
+        const LL1Table &table = result.parsingTable;
+        size_t rows = table.rowSymbol.size();
+        if (table.columns != terminals.size() || table.rowOf.size() > symbolCount ||
+            (table.wide ? table.cells32.size() != rows * table.columns || !table.cells16.empty()
+                        : table.cells16.size() != rows * table.columns || !table.cells32.empty()))
+            return false;
+        for (size_t r = 0; r < rows; r++)
+        {
+            SymbolId nt = table.rowSymbol[r];
+            if (nt < 0 || static_cast<size_t>(nt) >= table.rowOf.size() || table.rowOf[nt] != static_cast<int32_t>(r))
+                return false;
+        }
+        for (int32_t row : table.rowOf)
+            if (row < -1 || row >= static_cast<int32_t>(rows))
+                return false;
+        size_t productions = grammar.productionCount();
+        for (size_t i = 0; i < rows * table.columns; i++)
+        {
+            int32_t prod = table.wide ? table.cells32[i] : table.cells16[i];
+            if (prod < LL1Table::EMPTY || (prod != LL1Table::EMPTY && static_cast<size_t>(prod) >= productions))
+                return false;
+        }
+        for (const TableConflict &conflict : table.conflicts)
+            if (conflict.nonTerminal < 0 || static_cast<size_t>(conflict.nonTerminal) >= symbolCount ||
+                conflict.terminal < 0 || static_cast<size_t>(conflict.terminal) >= symbolCount ||
+                conflict.kept >= productions || conflict.rejected >= productions)
+                return false;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef GRAMMAR_GENERATOR_H
+#define GRAMMAR_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+/* Synthetic grammars for benchmarking, written in the grammar.txt format so they go through the
+   normal loader. Non-terminals are N0 (the start symbol) .. N{n-1}, terminals t0 .. t{k-1}.
+
+   The generator is seeded and uses its own PRNG (splitmix64), so a given shape produces the same
+   grammar on every platform and standard library, and timings stay comparable across versions.
+   Only immediate left recursion is generated: the first symbol of a production is a terminal,
+   a later non-terminal, or the rule's own non-terminal. Indirect cycles would make left
+   recursion removal grow the grammar exponentially and swamp everything else being measured.
+*/
+struct GrammarShape
+{
+    size_t nonTerminals = 1000;
+    size_t alternatives = 4;          // productions per rule
+    size_t rhsLength = 4;             // average symbols per production
+    size_t terminals = 64;
+    double nullableDensity = 0.1;     // fraction of rules with an ε alternative
+    double leftRecursionRatio = 0.1;  // fraction of rules with an A -> A α alternative
+    double sharedPrefixRatio = 0.2;   // fraction of rules where two alternatives share a prefix
+    uint64_t seed = 1;
+};
+
+/* Parses "key=value,key=value" (keys: nts, alts, len, terms, nullable, leftrec, prefix, seed)
+   into shape. Keys that are not given keep their defaults. */
+inline bool parseGrammarShape(const std::string &spec, GrammarShape &shape)
+{
+    size_t pos = 0;
+    while (pos < spec.size())
+    {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos)
+            end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        pos = end + 1;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            return false;
+        std::string key = item.substr(0, eq);
+        const char *value = item.c_str() + eq + 1;
+        char *rest = nullptr;
+        double number = std::strtod(value, &rest);
+        if (rest == value || *rest != '\0' || number < 0)
+            return false;
+        if (key == "nts" && number >= 1)
+            shape.nonTerminals = static_cast<size_t>(number);
+        else if (key == "alts" && number >= 1)
+            shape.alternatives = static_cast<size_t>(number);
+        else if (key == "len" && number >= 1)
+            shape.rhsLength = static_cast<size_t>(number);
+        else if (key == "terms" && number >= 1)
+            shape.terminals = static_cast<size_t>(number);
+        else if (key == "nullable" && number <= 1)
+            shape.nullableDensity = number;
+        else if (key == "leftrec" && number <= 1)
+            shape.leftRecursionRatio = number;
+        else if (key == "prefix" && number <= 1)
+            shape.sharedPrefixRatio = number;
+        else if (key == "seed")
+            shape.seed = static_cast<uint64_t>(number);
+        else
+            return false;
+    }
+    return true;
+}
+
+// One step of splitmix64: advances state and returns the next 64 random bits.
+inline uint64_t splitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+class GrammarGenerator
+{
+public:
+    explicit GrammarGenerator(const GrammarShape &shape) : shape(shape), state(shape.seed) {}
+
+    std::string generate()
+    {
+        std::string text;
+        std::vector<std::vector<std::string>> alternatives;
+        for (size_t nt = 0; nt < shape.nonTerminals; nt++)
+        {
+            alternatives.assign(shape.alternatives, std::vector<std::string>());
+            for (auto &alt : alternatives)
+                alt = production(nt);
+            size_t next = 0;
+            if (shape.alternatives > 1 && chance(shape.leftRecursionRatio))
+            {
+                auto &alt = alternatives[next++];
+                alt.insert(alt.begin(), nonTerminal(nt));
+            }
+            if (next + 1 < shape.alternatives && chance(shape.sharedPrefixRatio))
+            {
+                std::vector<std::string> prefix = production(nt);
+                prefix.resize(1 + below(prefix.size()));
+                for (size_t i = next; i < next + 2; i++)
+                    alternatives[i].insert(alternatives[i].begin(), prefix.begin(), prefix.end());
+                next += 2;
+            }
+            if (next < shape.alternatives && chance(shape.nullableDensity))
+                alternatives[shape.alternatives - 1].clear();
+
+            text += nonTerminal(nt) + " ->";
+            for (size_t i = 0; i < alternatives.size(); i++)
+            {
+                text += i ? " |" : "";
+                if (alternatives[i].empty())
+                    text += " ε";
+                for (const auto &sym : alternatives[i])
+                    text += " " + sym;
+            }
+            text += "\n";
+        }
+        return text;
+    }
+
+private:
+    uint64_t nextRandom() { return splitMix64(state); }
+
+    size_t below(size_t bound) { return bound ? static_cast<size_t>(nextRandom() % bound) : 0; }
+    bool chance(double p) { return (nextRandom() >> 11) * (1.0 / 9007199254740992.0) < p; }
+
+    static std::string nonTerminal(size_t i) { return "N" + std::to_string(i); }
+
+    std::string terminal() { return "t" + std::to_string(below(shape.terminals)); }
+
+    // A non-left-recursive production of rule nt, 1 .. 2 * rhsLength - 1 symbols long.
+    std::vector<std::string> production(size_t nt)
+    {
+        std::vector<std::string> rhs;
+        size_t length = 1 + below(2 * shape.rhsLength - 1);
+        for (size_t i = 0; i < length; i++)
+        {
+            if (chance(0.6))
+                rhs.push_back(terminal());
+            else if (i > 0)
+                rhs.push_back(nonTerminal(below(shape.nonTerminals)));
+            else if (nt + 1 < shape.nonTerminals)
+                rhs.push_back(nonTerminal(nt + 1 + below(shape.nonTerminals - nt - 1)));
+            else
+                rhs.push_back(terminal());
+        }
+        return rhs;
+    }
+
+    GrammarShape shape;
+    uint64_t state;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef GRAMMAR_IR_H
+#define GRAMMAR_IR_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "flat_hash_map.h"
+
+/* Grammar IR shared by every phase of cfg_parser.
+   Symbols are interned once when the grammar is loaded; from then on the phases only
+   compare dense integer ids, and names are looked up again when writing the output.
+*/
+typedef int32_t SymbolId;
+
+// Reserved ids, interned by every SymbolTable before any grammar symbol.
+const SymbolId EPSILON = 0;      // "ε"
+const SymbolId END_MARKER = 1;   // "$"
+const SymbolId NO_SYMBOL = -1;
+
+class SymbolTable
+{
+public:
+    SymbolTable()
+    {
+        intern("ε");
+        intern("$");
+    }
+
+    // The index holds views into names, so a copy has to rebuild it over its own strings.
+    SymbolTable(const SymbolTable &other) : names(other.names), nonTerminal(other.nonTerminal) { reindex(); }
+    SymbolTable &operator=(const SymbolTable &other)
+    {
+        if (this != &other)
+        {
+            names = other.names;
+            nonTerminal = other.nonTerminal;
+            reindex();
+        }
+        return *this;
+    }
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable &operator=(SymbolTable &&) = default;
+
+    // Returns the id of name, adding it to the table if it has not been seen yet. Only a new
+    // name is copied; looking up a known one allocates nothing.
+    SymbolId intern(std::string_view name)
+    {
+        if (const SymbolId *known = ids.find(name))
+            return *known;
+        SymbolId id = static_cast<SymbolId>(names.size());
+        names.emplace_back(name);
+        nonTerminal.push_back(false);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    // Returns the id of name, or NO_SYMBOL if it was never interned.
+    SymbolId lookup(std::string_view name) const
+    {
+        const SymbolId *known = ids.find(name);
+        return known ? *known : NO_SYMBOL;
+    }
+
+    // Interns a new non-terminal named after base that does not clash with any existing symbol:
+    // base', then base'2, base'3, ... The result only depends on the symbols already interned.
+    SymbolId freshNonTerminal(const std::string &base)
+    {
+        std::string candidate = base + "'";
+        for (int suffix = 2; ids.contains(candidate); suffix++)
+            candidate = base + "'" + std::to_string(suffix);
+        SymbolId id = intern(candidate);
+        markNonTerminal(id);
+        return id;
+    }
+
+    const std::string &name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    // A symbol is a non-terminal once it has appeared on the left-hand side of a rule.
+    bool isNonTerminal(SymbolId id) const { return nonTerminal[id]; }
+    void markNonTerminal(SymbolId id) { nonTerminal[id] = true; }
+
+private:
+    void reindex()
+    {
+        ids.clear();
+        ids.reserve(names.size());
+        for (size_t id = 0; id < names.size(); id++)
+            ids.emplace(names[id], static_cast<SymbolId>(id));
+    }
+
+    std::deque<std::string> names;   // a deque never moves its elements, so views stay valid
+    FlatHashMap<std::string_view, SymbolId> ids;   // names is the insertion order
+    std::vector<bool> nonTerminal;   // terminal/non-terminal bitmap, one bit per symbol
+};
+
+// Read-only view of a production's right-hand side. An empty span stands for ε.
+struct SymbolSpan
+{
+    const SymbolId *first = nullptr;
+    const SymbolId *last = nullptr;
+
+    const SymbolId *begin() const { return first; }
+    const SymbolId *end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    SymbolId operator[](size_t i) const { return first[i]; }
+};
+
+/* Grammar with every production tokenized once and stored in CSR form:
+   the right-hand sides of all productions are concatenated into one symbol array, and
+   production p occupies rhsSymbols[prodStart[p], prodStart[p + 1]).
+   The productions of a non-terminal are contiguous, [ruleBegin[nt], ruleEnd[nt]).
+*/
+struct Grammar
+{
+    SymbolId startSymbol = NO_SYMBOL;
+    std::vector<SymbolId> nonTerminals;   // left-hand sides in definition order
+    std::vector<SymbolId> rhsSymbols;     // all right-hand sides, back to back
+    std::vector<uint32_t> prodStart;      // size productionCount() + 1
+    std::vector<SymbolId> prodLhs;        // left-hand side of each production
+    std::vector<uint32_t> ruleBegin;      // indexed by SymbolId
+    std::vector<uint32_t> ruleEnd;
+
+    size_t productionCount() const { return prodLhs.size(); }
+
+    bool defines(SymbolId nt) const
+    {
+        return static_cast<size_t>(nt) < ruleBegin.size() && ruleBegin[nt] != ruleEnd[nt];
+    }
+
+    // Index of the first production of nt and one past its last; empty for undefined symbols.
+    uint32_t firstProduction(SymbolId nt) const
+    {
+        return static_cast<size_t>(nt) < ruleBegin.size() ? ruleBegin[nt] : 0;
+    }
+    uint32_t endProduction(SymbolId nt) const
+    {
+        return static_cast<size_t>(nt) < ruleEnd.size() ? ruleEnd[nt] : 0;
+    }
+
+    SymbolSpan rhs(size_t p) const
+    {
+        const SymbolId *base = rhsSymbols.data();
+        return SymbolSpan{base + prodStart[p], base + prodStart[p + 1]};
+    }
+};
+
+/* Accumulates rules for a new Grammar. Productions are appended symbol by symbol to a flat
+   staging buffer, so the phases never build per-production containers. A rule started for a
+   non-terminal that already has one replaces the earlier rule; extendRule() appends to it
+   instead. The staging buffers live on the given memory resource, typically the arena of the
+   phase that builds the grammar.
+*/
+class GrammarBuilder
+{
+public:
+    explicit GrammarBuilder(std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : symbols(scratch), starts(scratch), groups(scratch), firstGroup(scratch), latestGroup(scratch),
+          order(scratch) {}
+
+    // Starts the rule of nt; following productions belong to it until the next startRule().
+    void startRule(SymbolId nt)
+    {
+        if (static_cast<size_t>(nt) >= latestGroup.size())
+        {
+            firstGroup.resize(nt + 1, -1);
+            latestGroup.resize(nt + 1, -1);
+        }
+        if (latestGroup[nt] < 0)
+            order.push_back(nt);
+        firstGroup[nt] = latestGroup[nt] = static_cast<int32_t>(groups.size());
+        groups.push_back(Group{nt, static_cast<uint32_t>(starts.size()), static_cast<uint32_t>(starts.size()), -1});
+    }
+
+    // Like startRule(), but keeps the productions nt already has and appends after them.
+    void extendRule(SymbolId nt)
+    {
+        if (static_cast<size_t>(nt) >= latestGroup.size() || latestGroup[nt] < 0)
+        {
+            startRule(nt);
+            return;
+        }
+        groups[latestGroup[nt]].next = static_cast<int32_t>(groups.size());
+        latestGroup[nt] = static_cast<int32_t>(groups.size());
+        groups.push_back(Group{nt, static_cast<uint32_t>(starts.size()), static_cast<uint32_t>(starts.size()), -1});
+    }
+
+    void push(SymbolId sym) { symbols.push_back(sym); }
+
+    // Closes the production made of the symbols pushed since the previous one.
+    void endProduction()
+    {
+        starts.push_back(productionBegin);
+        productionBegin = static_cast<uint32_t>(symbols.size());
+        groups.back().end++;
+    }
+
+    void addProduction(SymbolSpan prod)
+    {
+        symbols.insert(symbols.end(), prod.begin(), prod.end());
+        endProduction();
+    }
+
+    // Copies the staged rules into contiguous CSR arrays, in first-definition order.
+    Grammar build(SymbolId startSymbol, size_t symbolCount) const
+    {
+        Grammar g;
+        g.startSymbol = startSymbol;
+        g.nonTerminals.assign(order.begin(), order.end());
+        g.ruleBegin.assign(std::max(symbolCount, latestGroup.size()), 0);
+        g.ruleEnd.assign(g.ruleBegin.size(), 0);
+        g.rhsSymbols.reserve(symbols.size());
+        g.prodStart.reserve(starts.size() + 1);
+        g.prodLhs.reserve(starts.size());
+        for (SymbolId nt : order)
+        {
+            g.ruleBegin[nt] = static_cast<uint32_t>(g.prodLhs.size());
+            for (int32_t group = firstGroup[nt]; group >= 0; group = groups[group].next)
+            {
+                for (uint32_t p = groups[group].begin; p < groups[group].end; p++)
+                {
+                    uint32_t from = starts[p];
+                    uint32_t to = p + 1 < starts.size() ? starts[p + 1] : static_cast<uint32_t>(symbols.size());
+                    g.prodStart.push_back(static_cast<uint32_t>(g.rhsSymbols.size()));
+                    g.prodLhs.push_back(nt);
+                    g.rhsSymbols.insert(g.rhsSymbols.end(), symbols.begin() + from, symbols.begin() + to);
+                }
+            }
+            g.ruleEnd[nt] = static_cast<uint32_t>(g.prodLhs.size());
+        }
+        g.prodStart.push_back(static_cast<uint32_t>(g.rhsSymbols.size()));
+        return g;
+    }
+
+private:
+    struct Group
+    {
+        SymbolId nt;
+        uint32_t begin, end;   // staged production indices
+        int32_t next;          // group continuing the same rule (extendRule), or -1
+    };
+
+    std::pmr::vector<SymbolId> symbols;     // staged right-hand sides
+    std::pmr::vector<uint32_t> starts;      // start of each staged production in symbols
+    uint32_t productionBegin = 0;
+    std::pmr::vector<Group> groups;
+    std::pmr::vector<int32_t> firstGroup;   // indexed by SymbolId, -1 when nt has no rule yet
+    std::pmr::vector<int32_t> latestGroup;
+    std::pmr::vector<SymbolId> order;
+};
+
+// Orders symbols by name, which is the order every section of output.txt uses.
+inline std::vector<SymbolId> sortedByName(std::vector<SymbolId> ids, const SymbolTable &symbols)
+{
+    std::sort(ids.begin(), ids.end(), [&](SymbolId a, SymbolId b) {
+        return symbols.name(a) < symbols.name(b);
+    });
+    return ids;
+}
+
+// Renders a production as space-separated symbol names, or "ε" when it is empty.
+inline std::string renderProduction(SymbolSpan prod, const SymbolTable &symbols)
+{
+    if (prod.empty())
+        return symbols.name(EPSILON);
+    std::string text;
+    for (size_t i = 0; i < prod.size(); i++)
+    {
+        if (i > 0)
+            text += ' ';
+        text += symbols.name(prod[i]);
+    }
+    return text;
+}
+
+#endif
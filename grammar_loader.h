@@ -0,0 +1,207 @@
+#ifndef GRAMMAR_LOADER_H
+#define GRAMMAR_LOADER_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "grammar_ir.h"
+
+/* Read-only view of a whole input file. Regular files are memory-mapped; anything that cannot
+   be mapped (pipes, empty files) is read in 1 MiB chunks into an owned buffer. */
+class MappedFile
+{
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            void *p = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                ::madvise(p, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                mapped = p;
+                mappedSize = static_cast<size_t>(info.st_size);
+                ::close(fd);
+                return true;
+            }
+        }
+        const size_t CHUNK = 1 << 20;
+        ssize_t got = 0;
+        do
+        {
+            size_t used = buffer.size();
+            buffer.resize(used + CHUNK);
+            got = ::read(fd, &buffer[used], CHUNK);
+            buffer.resize(used + (got > 0 ? static_cast<size_t>(got) : 0));
+        } while (got > 0);
+        ::close(fd);
+        return got == 0;
+    }
+
+    std::string_view text() const
+    {
+        return mapped ? std::string_view(static_cast<const char *>(mapped), mappedSize) : std::string_view(buffer);
+    }
+
+private:
+    void close()
+    {
+        if (mapped)
+            ::munmap(mapped, mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+        buffer.clear();
+    }
+
+    void *mapped = nullptr;
+    size_t mappedSize = 0;
+    std::string buffer;
+};
+
+struct LoadStats
+{
+    size_t bytes = 0;
+    size_t lines = 0;
+    size_t rules = 0;          // "A -> ..." lines; repeated left-hand sides count every time
+    size_t productions = 0;
+    double seconds = 0;
+
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / seconds / 1e6 : 0; }
+};
+
+/* Single-pass grammar tokenizer over an in-memory text. Lines look like
+       NonTerminal -> production1 | production2 | ...
+   and symbols are separated by blanks. Names are interned straight from views into the text,
+   so no per-line or per-token strings are built. Beyond the one-line form it accepts:
+     - continuation lines starting with '|', which add alternatives to the rule above;
+     - a trailing '\', which continues the current production on the next line;
+     - repeated left-hand sides, whose alternatives are appended to the earlier ones.
+   A lone "ε" is the empty production; blank alternatives and lines without "->" are skipped.
+*/
+inline Grammar parseGrammarText(std::string_view text, SymbolTable &symbols, LoadStats *stats = nullptr,
+                                std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    auto started = std::chrono::steady_clock::now();
+    GrammarBuilder builder(scratch);
+    SymbolId startSymbol = NO_SYMBOL;
+    bool inRule = false;          // a rule is open, so '|' lines continue it
+    bool joinNext = false;        // the previous line ended in '\'
+    bool sawToken = false;        // the open production has at least one symbol (or ε)
+    LoadStats counts;
+    counts.bytes = text.size();
+
+    auto isBlank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    auto closeProduction = [&] {
+        if (sawToken)
+        {
+            builder.endProduction();
+            counts.productions++;
+        }
+        sawToken = false;
+    };
+    // Tokenizes [p, end) as right-hand side text: blanks separate symbols, '|' alternatives.
+    auto scanBody = [&](const char *p, const char *end) {
+        while (p < end)
+        {
+            if (isBlank(*p))
+            {
+                p++;
+                continue;
+            }
+            if (*p == '|')
+            {
+                closeProduction();
+                p++;
+                continue;
+            }
+            const char *tokenStart = p;
+            while (p < end && !isBlank(*p) && *p != '|')
+                p++;
+            SymbolId id = symbols.intern(std::string_view(tokenStart, static_cast<size_t>(p - tokenStart)));
+            if (id != EPSILON)
+                builder.push(id);
+            sawToken = true;
+        }
+    };
+
+    const char *cursor = text.data();
+    const char *textEnd = cursor + text.size();
+    while (cursor < textEnd)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', textEnd - cursor));
+        if (!lineEnd)
+            lineEnd = textEnd;
+        const char *begin = cursor;
+        const char *end = lineEnd;
+        cursor = lineEnd + (lineEnd < textEnd ? 1 : 0);
+        counts.lines++;
+        while (begin < end && isBlank(*begin))
+            begin++;
+        while (end > begin && isBlank(end[-1]))
+            end--;
+
+        bool continues = end > begin && end[-1] == '\\';
+        if (continues)
+            end--;
+        if (joinNext)
+            scanBody(begin, end);                 // rest of the production on the line above
+        else if (begin < end && *begin == '|' && inRule)
+            scanBody(begin, end);                 // the leading '|' closes the previous alternative
+        else if (begin < end)
+        {
+            std::string_view line(begin, static_cast<size_t>(end - begin));
+            size_t arrow = line.find("->");
+            if (arrow == std::string_view::npos)
+            {
+                inRule = false;
+                continue;
+            }
+            size_t lhsEnd = arrow;
+            while (lhsEnd > 0 && isBlank(line[lhsEnd - 1]))
+                lhsEnd--;
+            if (lhsEnd == 0)
+            {
+                inRule = false;
+                continue;
+            }
+            SymbolId lhs = symbols.intern(line.substr(0, lhsEnd));
+            symbols.markNonTerminal(lhs);
+            if (startSymbol == NO_SYMBOL)
+                startSymbol = lhs;
+            builder.extendRule(lhs);
+            inRule = true;
+            counts.rules++;
+            scanBody(begin + arrow + 2, end);
+        }
+        joinNext = continues;
+        if (!joinNext)
+            closeProduction();
+    }
+    closeProduction();
+
+    Grammar grammar = builder.build(startSymbol, symbols.size());
+    counts.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (stats)
+        *stats = counts;
+    return grammar;
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef GRAMMAR_SERVICE_H
+#define GRAMMAR_SERVICE_H
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "grammar_analyzer.h"
+#include "output_writer.h"
+
+/* Long-lived analysis service behind --serve. Requests come over stdin/stdout, or over
+   the connections of a Unix domain socket, which are served one after another:
+
+       analyze <bytes> [format=F] [sections=S]\n   then <bytes> bytes of grammar text
+       quit\n                                      stops the service
+
+   Each analyze gets one of these replies:
+
+       ok <bytes> <full|incremental|reused> <conflicts>\n   then <bytes> bytes of output
+       error <bytes>\n                                      then <bytes> bytes of message
+
+   The output is what would have been written to output.txt, in the service's format and sections
+   unless the request names others. A single GrammarAnalyzer handles every request, so the
+   previous grammar's symbols, sets and table stay warm. An edited grammar is updated
+   incrementally, and a repeated one is answered straight from memory.
+*/
+class GrammarService
+{
+public:
+    GrammarService(const AnalyzerOptions &options, OutputFormat format, const OutputSections &sections)
+        : analyzer(withIncremental(options)), format(format), sections(sections) {}
+
+    ~GrammarService() { std::free(line); }
+
+    GrammarService(const GrammarService &) = delete;
+    GrammarService &operator=(const GrammarService &) = delete;
+
+    // Answers requests from in on out until end of input; returns false once quit was received.
+    bool serve(FILE *in, FILE *out)
+    {
+        ssize_t length;
+        while ((length = ::getline(&line, &lineCapacity, in)) > 0)
+        {
+            std::string_view request(line, static_cast<size_t>(length));
+            while (!request.empty() && (request.back() == '\n' || request.back() == '\r'))
+                request.remove_suffix(1);
+            std::string_view command = nextWord(request);
+            if (command.empty())
+                continue;
+            if (command == "quit")
+                return false;
+            if (command != "analyze")
+            {
+                reply(out, "error", "Error: unknown request '" + std::string(command) + "'.\n");
+                continue;
+            }
+            std::string size(nextWord(request));
+            char *end = nullptr;
+            unsigned long long bytes = std::strtoull(size.c_str(), &end, 10);
+            if (size.empty() || *end != '\0')
+            {
+                reply(out, "error", "Error: analyze needs the size of the grammar in bytes.\n");
+                continue;
+            }
+            if (bytes > MAX_REQUEST_BYTES)
+            {
+                reply(out, "error", "Error: a grammar of " + size + " bytes exceeds the limit of " +
+                                        std::to_string(MAX_REQUEST_BYTES) + " bytes.\n");
+                if (!skip(in, bytes))
+                    return true;
+                continue;
+            }
+            // Running out of memory ends this request only; the service keeps answering.
+            bool received = false, failed = false;
+            try
+            {
+                text.resize(static_cast<size_t>(bytes));
+                if (std::fread(&text[0], 1, text.size(), in) != text.size())
+                    return true;
+                received = true;
+                analyze(request, out);
+            }
+            catch (const std::bad_alloc &)
+            {
+                failed = true;
+            }
+            catch (const std::length_error &)
+            {
+                failed = true;
+            }
+            if (failed)
+            {
+                reply(out, "error", "Error: out of memory while analyzing the grammar.\n");
+                if (!received && !skip(in, bytes))
+                    return true;
+            }
+        }
+        return true;
+    }
+
+    // Listens on a Unix domain socket at path, replacing any stale one, until a client sends quit.
+    bool listen(const std::string &path)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0)
+            return false;
+        ::unlink(path.c_str());
+        if (::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(server, 16) != 0)
+        {
+            ::close(server);
+            return false;
+        }
+        // A client that hangs up mid-reply must not take the service down with it.
+        std::signal(SIGPIPE, SIG_IGN);
+        bool running = true;
+        while (running)
+        {
+            int client = ::accept(server, nullptr, nullptr);
+            if (client < 0)
+                continue;
+            FILE *in = ::fdopen(client, "rb");
+            FILE *out = ::fdopen(::dup(client), "wb");
+            if (in && out)
+                running = serve(in, out);
+            if (out)
+                std::fclose(out);
+            if (in)
+                std::fclose(in);
+            else
+                ::close(client);
+        }
+        ::close(server);
+        ::unlink(path.c_str());
+        return true;
+    }
+
+private:
+    static constexpr unsigned long long MAX_REQUEST_BYTES = 64ull << 20;   // largest grammar text accepted
+
+    GrammarAnalyzer analyzer;
+    OutputFormat format;
+    OutputSections sections;
+    std::string text;              // grammar of the current request, reused between requests
+    char *line = nullptr;          // getline() buffer
+    size_t lineCapacity = 0;
+
+    static AnalyzerOptions withIncremental(AnalyzerOptions options)
+    {
+        options.incremental = true;
+        return options;
+    }
+
+    // Reads and drops the body of a rejected request; false if the input ended first.
+    static bool skip(FILE *in, unsigned long long bytes)
+    {
+        char buffer[4096];
+        while (bytes > 0)
+        {
+            size_t chunk = static_cast<size_t>(std::min<unsigned long long>(bytes, sizeof(buffer)));
+            if (std::fread(buffer, 1, chunk, in) != chunk)
+                return false;
+            bytes -= chunk;
+        }
+        return true;
+    }
+
+    static std::string_view nextWord(std::string_view &rest)
+    {
+        size_t begin = rest.find_first_not_of(' ');
+        if (begin == std::string_view::npos)
+        {
+            rest = std::string_view();
+            return rest;
+        }
+        size_t end = std::min(rest.find(' ', begin), rest.size());
+        std::string_view word = rest.substr(begin, end - begin);
+        rest.remove_prefix(end);
+        return word;
+    }
+
+    // Analyzes text and replies with the output; options holds the rest of the request line.
+    void analyze(std::string_view options, FILE *out)
+    {
+        OutputFormat requestFormat = format;
+        OutputSections requestSections = sections;
+        for (std::string_view word = nextWord(options); !word.empty(); word = nextWord(options))
+        {
+            std::string option(word);
+            bool valid = (option.compare(0, 7, "format=") == 0 && parseOutputFormat(option.substr(7), requestFormat)) ||
+                         (option.compare(0, 9, "sections=") == 0 && parseOutputSections(option.substr(9), requestSections));
+            if (!valid)
+            {
+                reply(out, "error", "Error: unknown option '" + option + "'.\n");
+                return;
+            }
+        }
+        if (!analyzer.analyze(text))
+        {
+            reply(out, "error", analyzer.error());
+            return;
+        }
+
+        // The output is rendered into memory first, since the reply starts with its size.
+        char *buffer = nullptr;
+        size_t size = 0;
+        FILE *memory = ::open_memstream(&buffer, &size);
+        bool written = memory && AnalysisWriter(analyzer.result(), requestSections).write(memory, requestFormat);
+        if (memory)
+            std::fclose(memory);
+        if (!written)
+            reply(out, "error", "Error: unable to render the output.\n");
+        else
+        {
+            static const char *const modes[] = {"full", "incremental", "reused"};
+            std::fprintf(out, "ok %zu %s %zu\n", size, modes[static_cast<int>(analyzer.mode())],
+                         analyzer.result().parsingTable.conflicts.size());
+            std::fwrite(buffer, 1, size, out);
+            std::fflush(out);
+        }
+        std::free(buffer);
+    }
+
+    static void reply(FILE *out, const char *status, const std::string &payload)
+    {
+        std::fprintf(out, "%s %zu\n", status, payload.size());
+        std::fwrite(payload.data(), 1, payload.size(), out);
+        std::fflush(out);
+    }
+};
+
+#endif
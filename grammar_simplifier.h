@@ -0,0 +1,248 @@
+#ifndef GRAMMAR_SIMPLIFIER_H
+#define GRAMMAR_SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <memory_resource>
+#include <algorithm>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+#include "phase_stats.h"
+#include "flat_hash_map.h"
+
+/* --simplify: removes the dead weight of a grammar before left factoring.
+
+   Three linear passes:
+   - productive: a production is productive once every non-terminal in it is, counted down
+     with the same occurrence-list worklist computeNullable() uses; a non-terminal is
+     productive once one of its productions is. Productions that mention a non-productive
+     symbol are dropped.
+   - unit chains: a non-terminal other than the start symbol whose only production is another
+     non-terminal (B -> C) is an alias. Occurrences of an alias are replaced by the end of its
+     chain, so A -> B, B -> C, C -> c leaves A -> C, C -> c. A -> A that this leaves behind is
+     dropped, as are alternatives of a rule that became identical.
+   - reachable: a breadth-first walk from the start symbol over what is left. Non-terminals it
+     does not reach are dropped.
+   If the start symbol itself is not productive, the grammar derives no string at all; it is
+   then returned unchanged and the report says so.
+*/
+
+struct SimplifyReport
+{
+    bool ran = false;
+    bool emptyLanguage = false;         // the start symbol is not productive; nothing was removed
+    size_t nonTerminalsBefore = 0, nonTerminalsAfter = 0;
+    size_t productionsBefore = 0, productionsAfter = 0;
+    size_t symbolsBefore = 0, symbolsAfter = 0;   // right-hand side symbols
+    std::vector<SymbolId> nonProductive;
+    std::vector<SymbolId> collapsed;    // unit-chain aliases that were replaced
+    std::vector<SymbolId> unreachable;
+    size_t selfUnitProductions = 0;     // A -> A
+    size_t duplicateProductions = 0;
+};
+
+inline Grammar simplifyGrammar(const Grammar &grammar, size_t symbolCount, SimplifyReport &report,
+                               std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    report = SimplifyReport();
+    report.ran = true;
+    report.nonTerminalsBefore = grammar.nonTerminals.size();
+    report.productionsBefore = grammar.productionCount();
+    report.symbolsBefore = grammar.rhsSymbols.size();
+
+    // Productive: pending[p] counts the non-terminal occurrences of p not yet known productive.
+    std::pmr::vector<char> productive(symbolCount, 0, scratch);
+    std::pmr::vector<uint32_t> pending(grammar.productionCount(), 0, scratch);
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> occurrences(scratch);   // (non-terminal, production)
+    std::pmr::vector<SymbolId> found(scratch);
+    auto discover = [&](SymbolId nt) {
+        if (productive[nt])
+            return;
+        productive[nt] = 1;
+        found.push_back(nt);
+    };
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        for (SymbolId sym : grammar.rhs(p))
+            if (grammar.defines(sym))
+            {
+                pending[p]++;
+                occurrences.emplace_back(sym, static_cast<SymbolId>(p));
+            }
+        if (pending[p] == 0)
+            discover(grammar.prodLhs[p]);
+    }
+    std::pmr::vector<uint32_t> occurrenceStart(scratch);
+    std::pmr::vector<SymbolId> occurrenceAt(scratch);
+    buildAdjacency(occurrences, symbolCount, occurrenceStart, occurrenceAt);
+    while (!found.empty())
+    {
+        SymbolId nt = found.back();
+        found.pop_back();
+        CFG_STAT_ADD(iterations, 1);
+        for (uint32_t i = occurrenceStart[nt]; i < occurrenceStart[nt + 1]; i++)
+            if (--pending[occurrenceAt[i]] == 0)
+                discover(grammar.prodLhs[occurrenceAt[i]]);
+    }
+    if (!productive[grammar.startSymbol])
+    {
+        report.emptyLanguage = true;
+        report.nonTerminalsAfter = report.nonTerminalsBefore;
+        report.productionsAfter = report.productionsBefore;
+        report.symbolsAfter = report.symbolsBefore;
+        return grammar;
+    }
+    for (SymbolId nt : grammar.nonTerminals)
+        if (!productive[nt])
+            report.nonProductive.push_back(nt);
+
+    // Unit chains: alias[B] = C for B -> C when that is B's only productive production.
+    std::pmr::vector<SymbolId> alias(symbolCount, NO_SYMBOL, scratch);
+    for (SymbolId nt : grammar.nonTerminals)
+    {
+        if (!productive[nt] || nt == grammar.startSymbol)
+            continue;
+        SymbolId target = NO_SYMBOL;
+        size_t kept = 0;
+        for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+            if (pending[p] == 0 && kept++ == 0)
+            {
+                SymbolSpan rhs = grammar.rhs(p);
+                target = rhs.size() == 1 && grammar.defines(rhs[0]) && rhs[0] != nt ? rhs[0] : NO_SYMBOL;
+            }
+        if (kept == 1 && target != NO_SYMBOL)
+            alias[nt] = target;
+    }
+    // Every alias chain ends, since a cycle of aliases would derive nothing and is not productive.
+    auto resolve = [&](SymbolId sym) {
+        SymbolId end = sym;
+        while (static_cast<size_t>(end) < alias.size() && alias[end] != NO_SYMBOL)
+            end = alias[end];
+        while (static_cast<size_t>(sym) < alias.size() && alias[sym] != NO_SYMBOL)
+        {
+            SymbolId next = alias[sym];
+            alias[sym] = end;
+            sym = next;
+        }
+        return end;
+    };
+    for (SymbolId nt : grammar.nonTerminals)
+        if (alias[nt] != NO_SYMBOL)
+            report.collapsed.push_back(nt);
+
+    // The surviving productions with aliases replaced, staged per rule in grammar order.
+    std::pmr::vector<SymbolId> staged(scratch);
+    std::pmr::vector<uint32_t> stagedStart(scratch);   // production k is staged[stagedStart[k], stagedStart[k + 1])
+    std::pmr::vector<uint32_t> ruleStart(symbolCount + 1, 0, scratch);
+    std::pmr::vector<uint32_t> ruleEnd(symbolCount + 1, 0, scratch);
+    // Duplicates are compared by hash first. A short rule checks every alternative kept so far;
+    // a long one goes through latest[h], the last production of the rule hashing to h, and
+    // sameHash[k], the one before k. Hashes are seeded with the rule, so a chain walk can stop
+    // at the rule's first production.
+    const size_t linearScan = 16;
+    const uint32_t NONE = UINT32_MAX;
+    std::pmr::vector<uint64_t> stagedHash(scratch);
+    std::pmr::vector<uint32_t> sameHash(scratch);
+    FlatHashMap<uint64_t, uint32_t> latest(scratch);
+    stagedStart.push_back(0);
+    for (SymbolId nt : grammar.nonTerminals)
+    {
+        if (!productive[nt] || alias[nt] != NO_SYMBOL)
+            continue;
+        ruleStart[nt] = static_cast<uint32_t>(stagedStart.size() - 1);
+        bool hashed = grammar.endProduction(nt) - grammar.firstProduction(nt) > linearScan;
+        for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+        {
+            if (pending[p] != 0)
+                continue;
+            size_t begin = staged.size();
+            uint64_t hash = (0xcbf29ce484222325ull ^ static_cast<uint32_t>(nt)) * 0x100000001b3ull;
+            for (SymbolId sym : grammar.rhs(p))
+            {
+                SymbolId mapped = resolve(sym);
+                staged.push_back(mapped);
+                hash = (hash ^ static_cast<uint32_t>(mapped)) * 0x100000001b3ull;
+            }
+            size_t length = staged.size() - begin;
+            if (length == 1 && staged[begin] == nt)
+            {
+                report.selfUnitProductions++;
+                staged.resize(begin);
+                continue;
+            }
+            auto same = [&](uint32_t other) {
+                return stagedHash[other] == hash && stagedStart[other + 1] - stagedStart[other] == length &&
+                       std::equal(staged.begin() + stagedStart[other], staged.begin() + stagedStart[other + 1],
+                                  staged.begin() + begin);
+            };
+            uint32_t *previous = hashed ? latest.find(hash) : nullptr;
+            bool duplicate = false;
+            if (hashed)
+                for (uint32_t other = previous ? *previous : NONE; other != NONE && other >= ruleStart[nt] && !duplicate;
+                     other = sameHash[other])
+                    duplicate = same(other);
+            else
+                for (uint32_t other = ruleStart[nt]; other + 1 < stagedStart.size() && !duplicate; other++)
+                    duplicate = same(other);
+            if (duplicate)
+            {
+                report.duplicateProductions++;
+                staged.resize(begin);
+                continue;
+            }
+            stagedHash.push_back(hash);
+            sameHash.push_back(previous ? *previous : NONE);
+            if (hashed)
+                latest[hash] = static_cast<uint32_t>(stagedStart.size() - 1);
+            stagedStart.push_back(static_cast<uint32_t>(staged.size()));
+        }
+        ruleEnd[nt] = static_cast<uint32_t>(stagedStart.size() - 1);
+    }
+
+    // Reachable from the start symbol.
+    std::pmr::vector<char> reached(symbolCount, 0, scratch);
+    std::pmr::vector<SymbolId> queue(scratch);
+    reached[grammar.startSymbol] = 1;
+    queue.push_back(grammar.startSymbol);
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        SymbolId nt = queue[head];
+        for (uint32_t k = ruleStart[nt]; k < ruleEnd[nt]; k++)
+            for (uint32_t i = stagedStart[k]; i < stagedStart[k + 1]; i++)
+            {
+                SymbolId sym = staged[i];
+                if (grammar.defines(sym) && !reached[sym])
+                {
+                    reached[sym] = 1;
+                    queue.push_back(sym);
+                }
+            }
+    }
+
+    GrammarBuilder builder(scratch);
+    for (SymbolId nt : grammar.nonTerminals)
+    {
+        if (!productive[nt] || alias[nt] != NO_SYMBOL)
+            continue;
+        if (!reached[nt])
+        {
+            report.unreachable.push_back(nt);
+            continue;
+        }
+        builder.startRule(nt);
+        for (uint32_t k = ruleStart[nt]; k < ruleEnd[nt]; k++)
+        {
+            for (uint32_t i = stagedStart[k]; i < stagedStart[k + 1]; i++)
+                builder.push(staged[i]);
+            builder.endProduction();
+        }
+    }
+    Grammar simplified = builder.build(grammar.startSymbol, symbolCount);
+    report.nonTerminalsAfter = simplified.nonTerminals.size();
+    report.productionsAfter = simplified.productionCount();
+    report.symbolsAfter = simplified.rhsSymbols.size();
+    return simplified;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef HEADER_WRITER_H
+#define HEADER_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include "analysis.h"
+#include "output_writer.h"
+
+/* --emit-header: writes the analysis of a grammar as a C++17 header for static_parser.h. The
+   header holds one namespace with a Tables struct of static constexpr arrays (symbol names,
+   row and column of every symbol, the productions of the final grammar in CSR form and the
+   dense LL(1) table), an enum class Symbol naming every symbol whose name is a C++
+   identifier, and Grammar and Parser aliases of the static_parser.h templates. Symbol ids,
+   production numbers and columns are those of the analysis, so output.txt describes the
+   header's tables.
+*/
+
+// Whether name can be used as an enumerator: an identifier that is neither a keyword nor
+// reserved to the implementation.
+inline bool usableIdentifier(const std::string &name)
+{
+    static const char *const keywords[] = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case",
+        "catch", "char", "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast",
+        "continue", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+        "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int",
+        "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+        "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "return", "short",
+        "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template",
+        "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+        "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+        return false;
+    for (char c : name)
+        if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+            return false;
+    if (name.find("__") != std::string::npos || (name[0] == '_' && name.size() > 1 && name[1] >= 'A' && name[1] <= 'Z'))
+        return false;
+    for (const char *keyword : keywords)
+        if (name == keyword)
+            return false;
+    return true;
+}
+
+class HeaderWriter
+{
+public:
+    HeaderWriter(const AnalysisResult &result, const std::string &nameSpace) : result(result), nameSpace(nameSpace) {}
+
+    bool write(FILE *file)
+    {
+        const SymbolTable &symbols = result.symbols;
+        const Grammar &grammar = result.finalGrammar;
+        const LL1Table &table = result.parsingTable;
+        const TerminalIndex &terminals = result.terminals;
+        OutputBuffer buffer(file);
+        out = &buffer;
+
+        std::string guard;
+        for (char c : nameSpace)
+            guard += c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        guard += "_H";
+        line("// Generated by cfg_parser --emit-header. Do not edit; regenerate from the grammar instead.");
+        out->append("// ");
+        out->appendNumber(grammar.nonTerminals.size());
+        out->append(" non-terminals, ");
+        out->appendNumber(grammar.productionCount());
+        out->append(" productions, ");
+        out->appendNumber(terminals.size());
+        out->append(" table columns, ");
+        out->appendNumber(table.conflicts.size());
+        line(" LL(1) conflicts (each cell keeps the first production).");
+        line("#ifndef " + guard);
+        line("#define " + guard);
+        line("");
+        line("#include \"static_parser.h\"");
+        line("");
+        line("namespace " + nameSpace);
+        line("{");
+        line("");
+        line("struct Tables");
+        line("{");
+        constant("symbolCount", symbols.size());
+        constant("startSymbol", static_cast<uint64_t>(grammar.startSymbol));
+        constant("endSymbol", static_cast<uint64_t>(END_MARKER));
+        constant("endColumn", static_cast<uint64_t>(terminals.denseOf[END_MARKER]));
+        constant("rows", table.rowCount());
+        constant("columns", table.columnCount());
+        constant("productionCount", grammar.productionCount());
+        line("");
+
+        out->append("    static constexpr std::string_view symbolNames[symbolCount] = {");
+        for (size_t id = 0; id < symbols.size(); id++)
+        {
+            out->append(id % 8 == 0 ? "\n        " : " ");
+            quoted(symbols.name(static_cast<SymbolId>(id)));
+            out->append(',');
+        }
+        line("\n    };");
+
+        std::vector<int64_t> values;
+        for (size_t id = 0; id < symbols.size(); id++)
+            values.push_back(table.row(static_cast<SymbolId>(id)));
+        array("int32_t", "rowOf", "symbolCount", values, "table row of each non-terminal, -1 for terminals");
+        values.clear();
+        for (size_t id = 0; id < symbols.size(); id++)
+            values.push_back(id < terminals.denseOf.size() ? terminals.denseOf[id] : -1);
+        array("int32_t", "columnOf", "symbolCount", values, "table column of each terminal, -1 for non-terminals");
+        values.assign(grammar.prodLhs.begin(), grammar.prodLhs.end());
+        array("int32_t", "productionLhs", "productionCount", values, "");
+        values.assign(grammar.prodStart.begin(), grammar.prodStart.end());
+        array("uint32_t", "productionStart", "productionCount + 1", values,
+              "production p is rhsSymbols[productionStart[p], productionStart[p + 1])");
+        values.assign(grammar.rhsSymbols.begin(), grammar.rhsSymbols.end());
+        if (values.empty())
+            values.push_back(0);   // arrays cannot be empty; productionStart never reaches it
+        array("int32_t", "rhsSymbols", std::to_string(values.size()), values, "");
+        values.clear();
+        for (size_t row = 0; row < table.rowCount(); row++)
+            for (size_t column = 0; column < table.columnCount(); column++)
+                values.push_back(table.at(row, column));
+        if (values.empty())
+            values.push_back(-1);
+        array(table.wideCells() ? "int32_t" : "int16_t", "table", table.rowCount() > 0 ? "rows * columns" : "1",
+              values, "production for [row * columns + column], -1 for an error");
+        line("};");
+        line("");
+
+        line("// Ids of the symbols whose names are C++ identifiers.");
+        line("enum class Symbol : int32_t");
+        line("{");
+        for (size_t id = 0; id < symbols.size(); id++)
+        {
+            const std::string &name = symbols.name(static_cast<SymbolId>(id));
+            if (!usableIdentifier(name))
+                continue;
+            out->append("    ");
+            out->append(name);
+            out->append(" = ");
+            out->appendNumber(id);
+            line(",");
+        }
+        line("};");
+        line("");
+        line("using Grammar = StaticGrammar<Tables>;");
+        line("using Parser = StaticParser<Tables>;");
+        line("");
+        line("}");
+        line("");
+        line("#endif");
+        return buffer.flush();
+    }
+
+private:
+    const AnalysisResult &result;
+    std::string nameSpace;
+    OutputBuffer *out = nullptr;
+
+    void line(std::string_view text)
+    {
+        out->append(text);
+        out->append('\n');
+    }
+
+    void constant(const char *name, uint64_t value)
+    {
+        out->append("    static constexpr int32_t ");
+        out->append(name);
+        out->append(" = ");
+        out->appendNumber(value);
+        line(";");
+    }
+
+    void signedNumber(int64_t value)
+    {
+        if (value < 0)
+            out->append('-');
+        out->appendNumber(static_cast<uint64_t>(value < 0 ? -value : value));
+    }
+
+    void array(const char *type, const char *name, const std::string &size, const std::vector<int64_t> &values,
+               const char *comment)
+    {
+        if (*comment)
+        {
+            out->append("    // ");
+            line(comment);
+        }
+        out->append("    static constexpr ");
+        out->append(type);
+        out->append(' ');
+        out->append(name);
+        out->append('[');
+        out->append(size);
+        out->append("] = {");
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            out->append(i % 16 == 0 ? "\n        " : " ");
+            signedNumber(values[i]);
+            out->append(',');
+        }
+        line("\n    };");
+    }
+
+    // A string literal for text; quotes, backslashes and control bytes become octal escapes.
+    void quoted(const std::string &text)
+    {
+        out->append('"');
+        for (unsigned char c : text)
+        {
+            if (c == '"' || c == '\\' || c < 0x20 || c == 0x7F)
+            {
+                char escape[5] = {'\\', static_cast<char>('0' + (c >> 6)), static_cast<char>('0' + ((c >> 3) & 7)),
+                                  static_cast<char>('0' + (c & 7)), 0};
+                out->append(escape);
+            }
+            else
+                out->append(static_cast<char>(c));
+        }
+        out->append('"');
+    }
+};
+
+#endif
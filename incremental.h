@@ -0,0 +1,787 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "left_recursion.h"
+#include "analysis.h"
+#include "phase_stats.h"
+
+/* Incremental re-analysis after an edit to the grammar.
+
+   The previous AnalysisResult (normally the --cache file) is brought up to date for a newly
+   loaded grammar. Each phase redoes only what the edit can reach:
+     1. left factoring      input rules whose productions changed are factored again; the
+                            others, with their new non-terminals, are copied over;
+     2. left recursion      components of the leftmost-symbol graph are rewritten again only if
+                            a member's factored rule or the component itself changed;
+     3. FIRST               rules that changed, plus everything that reads them (transitively,
+                            through nullable prefixes), are reset and iterated to a fixpoint
+                            with all other sets held fixed;
+     4. FOLLOW              the same, seeded from the symbols that occur in changed rules or in
+                            front of a symbol whose FIRST changed, closed over FOLLOW(A) ⊆ FOLLOW(B);
+     5. LL(1) table         rows of changed rules, changed FOLLOW sets and rules that mention a
+                            changed FIRST set are predicted again; the others keep their cells.
+   Both runs see rules in name order, so the result is the same as a full analysis of the new
+   grammar, new non-terminal names and symbol ids included. Edits that change what a symbol is
+   (a terminal gaining a rule, a name taking over one the previous run had generated) or the
+   start symbol are not handled: update() returns false and the caller runs the full analysis.
+
+   Everything from the old run is matched by symbol name, so the two symbol tables can differ.
+   When they agree and the rows keep their places, the old table is patched in place.
+*/
+
+struct IncrementalReport
+{
+    size_t rulesChanged = 0;    // input rules added, removed or edited
+    size_t rulesFactored = 0;   // input rules factored again in Phase 1
+    size_t components = 0;      // left-recursive components rewritten again in Phase 2
+    size_t firstSets = 0;       // FIRST sets recomputed
+    size_t followSets = 0;      // FOLLOW sets recomputed
+    size_t tableRows = 0;       // table rows predicted again
+    bool tablePatched = false;  // the old table was updated in place rather than copied
+    double seconds = 0;
+};
+
+class IncrementalAnalyzer
+{
+public:
+    // previous is consumed: its table is moved into the new result when it can be patched.
+    IncrementalAnalyzer(AnalysisResult &previous, std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : old(previous), scratch(scratch), toNew(previous.symbols.size(), UNRESOLVED, scratch), toOld(scratch) {}
+
+    /* result.symbols and result.inputGrammar hold the newly loaded grammar; fills in the rest of
+       result. factor(nt, grammar, out, symbols) is the Phase 1 transform used for the previous
+       run. Returns false, with result incomplete, for edits that need a full analysis. */
+    template <typename Factor>
+    bool update(AnalysisResult &result, Factor factor, IncrementalReport &report, std::vector<PhaseStats> &stats)
+    {
+        auto started = std::chrono::steady_clock::now();
+        symbols = &result.symbols;
+        oldInputRules = rulesOf(old.inputGrammar);
+        oldFactoredRules = rulesOf(old.factoredGrammar);
+        oldFinalRules = rulesOf(old.finalGrammar);
+        if (!compatible(result.inputGrammar))
+            return false;
+
+        {
+            PhaseStatsProbe probe("left factoring", stats);
+            refactor(result, factor, report);
+            probe.finish(result.factoredGrammar.productionCount());
+        }
+        {
+            PhaseStatsProbe probe("left recursion", stats);
+            removeRecursion(result, report);
+            probe.finish(result.finalGrammar.productionCount());
+        }
+        result.terminals = TerminalIndex(result.finalGrammar, *symbols);
+        mapTerminals(result);
+        {
+            PhaseStatsProbe probe("FIRST sets", stats);
+            updateFirst(result, report);
+            probe.finish();
+        }
+        {
+            PhaseStatsProbe probe("FOLLOW sets", stats);
+            updateFollow(result, report);
+            probe.finish();
+        }
+        {
+            PhaseStatsProbe probe("LL(1) table", stats);
+            updateTable(result, report);
+            probe.finish();
+        }
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return true;
+    }
+
+private:
+    static constexpr SymbolId UNRESOLVED = -2;
+
+    AnalysisResult &old;
+    std::pmr::memory_resource *scratch;
+    SymbolTable *symbols = nullptr;
+    std::pmr::vector<SymbolId> toNew;              // old id -> new id, by name
+    std::pmr::vector<SymbolId> toOld;              // new id -> old id, by name
+    std::pmr::vector<int32_t> denseMap{scratch};   // old terminal index -> new one, -1 once gone
+    bool sameTerminals = false;                    // denseMap is the identity
+
+    // Old symbols with a rule in the old input, factored and final grammars.
+    std::pmr::vector<uint8_t> oldInputRules{scratch};
+    std::pmr::vector<uint8_t> oldFactoredRules{scratch};
+    std::pmr::vector<uint8_t> oldFinalRules{scratch};
+
+    // Non-terminals of the final grammar whose rule, FIRST or FOLLOW set differs from the old run.
+    std::pmr::vector<uint8_t> ruleChanged{scratch};
+    std::pmr::vector<uint8_t> firstChanged{scratch};
+    std::pmr::vector<uint8_t> followChanged{scratch};
+
+    // New id of an old symbol, NO_SYMBOL while its name has not been interned (yet).
+    SymbolId newId(SymbolId oldSym)
+    {
+        SymbolId &cached = toNew[oldSym];
+        if (cached == UNRESOLVED)
+        {
+            SymbolId found = symbols->lookup(old.symbols.name(oldSym));
+            if (found == NO_SYMBOL)
+                return NO_SYMBOL;
+            cached = found;
+        }
+        return cached;
+    }
+
+    SymbolId oldId(SymbolId newSym)
+    {
+        if (static_cast<size_t>(newSym) >= toOld.size())
+            toOld.resize(symbols->size(), UNRESOLVED);
+        SymbolId &cached = toOld[newSym];
+        if (cached == UNRESOLVED)
+            cached = old.symbols.lookup(symbols->name(newSym));
+        return cached;
+    }
+
+    // Old counterpart of a non-terminal of the new grammar, if the old grammar had a rule for it
+    // (possibly without productions, like A -> A α once its recursion is removed).
+    SymbolId oldRule(SymbolId nt, const std::pmr::vector<uint8_t> &hasRule)
+    {
+        SymbolId o = oldId(nt);
+        return o != NO_SYMBOL && hasRule[o] ? o : NO_SYMBOL;
+    }
+
+    std::pmr::vector<uint8_t> rulesOf(const Grammar &grammar)
+    {
+        std::pmr::vector<uint8_t> hasRule(old.symbols.size(), 0, scratch);
+        for (SymbolId nt : grammar.nonTerminals)
+            hasRule[nt] = true;
+        return hasRule;
+    }
+
+    // Whether rule a of grammar has the same productions, by name, as rule o of oldGrammar.
+    bool sameRule(const Grammar &grammar, SymbolId a, const Grammar &oldGrammar, SymbolId o)
+    {
+        uint32_t first = grammar.firstProduction(a), count = grammar.endProduction(a) - first;
+        uint32_t oldFirst = oldGrammar.firstProduction(o);
+        if (oldGrammar.endProduction(o) - oldFirst != count)
+            return false;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            SymbolSpan now = grammar.rhs(first + i), before = oldGrammar.rhs(oldFirst + i);
+            if (now.size() != before.size())
+                return false;
+            for (size_t j = 0; j < now.size(); j++)
+                if (newId(before[j]) != now[j])
+                    return false;
+        }
+        return true;
+    }
+
+    // Copies the old rules of nts [first, last) into out, renamed into the new symbol table.
+    void copyRules(const Grammar &oldGrammar, const SymbolId *first, const SymbolId *last, GrammarBuilder &out)
+    {
+        for (const SymbolId *nt = first; nt != last; nt++)
+        {
+            out.startRule(newId(*nt));
+            for (uint32_t p = oldGrammar.firstProduction(*nt); p < oldGrammar.endProduction(*nt); p++)
+            {
+                for (SymbolId sym : oldGrammar.rhs(p))
+                    out.push(newId(sym));
+                out.endProduction();
+            }
+        }
+    }
+
+    // The base a generated name was made from: base' or base'N (N >= 2), see freshNonTerminal.
+    static std::string_view freshBase(std::string_view name)
+    {
+        size_t end = name.size();
+        while (end > 0 && name[end - 1] >= '0' && name[end - 1] <= '9')
+            end--;
+        if (end < name.size() && (name[end] == '0' || name.substr(end) == "1"))
+            return std::string_view();
+        if (end < 2 || name[end - 1] != '\'')
+            return std::string_view();
+        return name.substr(0, end - 1);
+    }
+
+    /* Re-creates the non-terminals the old run generated, [first, last) in creation order, and
+       returns true if the new table gives every one of them the same name. When any name would
+       come out differently nothing is interned and false is returned. */
+    bool replayFreshNames(const SymbolId *first, const SymbolId *last)
+    {
+        std::pmr::vector<std::string_view> pending(scratch);
+        for (const SymbolId *nt = first; nt != last; nt++)
+        {
+            std::string_view name = old.symbols.name(*nt);
+            std::string_view base = freshBase(name);
+            if (base.empty())
+                return false;
+            auto taken = [&](const std::string &candidate) {
+                return symbols->lookup(candidate) != NO_SYMBOL ||
+                       std::find(pending.begin(), pending.end(), candidate) != pending.end();
+            };
+            std::string candidate = std::string(base) + "'";
+            for (int suffix = 2; taken(candidate); suffix++)
+                candidate = std::string(base) + "'" + std::to_string(suffix);
+            if (candidate != name)
+                return false;
+            pending.push_back(name);
+        }
+        for (std::string_view name : pending)
+            symbols->freshNonTerminal(std::string(freshBase(name)));
+        return true;
+    }
+
+    // Rejects edits that change the role of a symbol or the start symbol.
+    bool compatible(const Grammar &input)
+    {
+        const Grammar &oldInput = old.inputGrammar;
+        if (input.startSymbol == NO_SYMBOL || oldInput.startSymbol == NO_SYMBOL ||
+            symbols->name(input.startSymbol) != old.symbols.name(oldInput.startSymbol))
+            return false;
+        for (size_t id = END_MARKER + 1; id < symbols->size(); id++)
+        {
+            SymbolId o = oldId(static_cast<SymbolId>(id));
+            if (o == NO_SYMBOL)
+                continue;
+            if (old.symbols.isNonTerminal(o) != symbols->isNonTerminal(static_cast<SymbolId>(id)))
+                return false;
+            if (old.symbols.isNonTerminal(o) && !oldInputRules[o])
+                return false;   // takes the name of a non-terminal the old run generated
+        }
+        return true;
+    }
+
+    /* Positions in nts where each group starts: a group is a non-terminal for which starts()
+       holds and the non-terminals after it up to the next one, which the phase that wrote them
+       generated for it. groupStart[nt] is the position, -1 outside. */
+    template <typename Starts>
+    static void findGroups(const std::vector<SymbolId> &nts, size_t symbolCount, Starts starts,
+                           std::pmr::vector<int32_t> &groupStart, std::pmr::vector<int32_t> &groupEnd)
+    {
+        groupStart.assign(symbolCount, -1);
+        groupEnd.assign(symbolCount, -1);
+        SymbolId open = NO_SYMBOL;
+        for (size_t i = 0; i < nts.size(); i++)
+        {
+            if (!starts(nts[i]))
+                continue;
+            if (open != NO_SYMBOL)
+                groupEnd[open] = static_cast<int32_t>(i);
+            open = nts[i];
+            groupStart[open] = static_cast<int32_t>(i);
+        }
+        if (open != NO_SYMBOL)
+            groupEnd[open] = static_cast<int32_t>(nts.size());
+    }
+
+    // --- Phase 1 ---
+
+    template <typename Factor>
+    void refactor(AnalysisResult &result, Factor &factor, IncrementalReport &report)
+    {
+        const Grammar &input = result.inputGrammar;
+        const Grammar &oldInput = old.inputGrammar;
+        const Grammar &oldFactored = old.factoredGrammar;
+        std::pmr::vector<int32_t> groupStart(scratch), groupEnd(scratch);
+        findGroups(oldFactored.nonTerminals, old.symbols.size(), [&](SymbolId nt) { return oldInputRules[nt] != 0; },
+                   groupStart, groupEnd);
+
+        for (SymbolId nt : oldInput.nonTerminals)
+        {
+            SymbolId now = newId(nt);
+            if (now == NO_SYMBOL || !symbols->isNonTerminal(now))
+                report.rulesChanged++;   // removed
+        }
+        GrammarBuilder out(scratch);
+        for (SymbolId nt : sortedByName(input.nonTerminals, *symbols))
+        {
+            SymbolId o = oldRule(nt, oldInputRules);
+            bool same = o != NO_SYMBOL && sameRule(input, nt, oldInput, o);
+            if (!same)
+                report.rulesChanged++;
+            if (same && groupStart[o] >= 0)
+            {
+                const SymbolId *group = oldFactored.nonTerminals.data() + groupStart[o];
+                const SymbolId *groupLast = oldFactored.nonTerminals.data() + groupEnd[o];
+                if (replayFreshNames(group + 1, groupLast))
+                {
+                    copyRules(oldFactored, group, groupLast, out);
+                    continue;
+                }
+            }
+            factor(nt, input, out, *symbols);
+            report.rulesFactored++;
+        }
+        result.factoredGrammar = out.build(input.startSymbol, symbols->size());
+    }
+
+    // --- Phase 2 ---
+
+    void removeRecursion(AnalysisResult &result, IncrementalReport &report)
+    {
+        const Grammar &factored = result.factoredGrammar;
+        const Grammar &oldFactored = old.factoredGrammar;
+        const Grammar &oldFinal = old.finalGrammar;
+        LeftRecursionEliminator before(scratch);
+        before.findComponents(oldFactored, old.symbols.size());
+        std::pmr::vector<uint32_t> componentSize(before.components(), 0, scratch);
+        for (SymbolId nt : oldFactored.nonTerminals)
+            componentSize[before.componentOf(nt)]++;
+        std::pmr::vector<int32_t> groupStart(scratch), groupEnd(scratch);
+        findGroups(oldFinal.nonTerminals, old.symbols.size(), [&](SymbolId nt) { return oldFactoredRules[nt] != 0; },
+                   groupStart, groupEnd);
+
+        GrammarBuilder out(scratch);
+        // A component is kept if it had exactly the same members, with the same rules, before.
+        auto keep = [&](const std::pmr::vector<SymbolId> &members) {
+            uint32_t component = NO_COMPONENT;
+            std::pmr::vector<SymbolId> generated(scratch);
+            for (SymbolId nt : members)
+            {
+                SymbolId o = oldRule(nt, oldFactoredRules);
+                if (o == NO_SYMBOL || !sameRule(factored, nt, oldFactored, o) || groupStart[o] < 0)
+                    return false;
+                if (component == NO_COMPONENT)
+                    component = before.componentOf(o);
+                if (before.componentOf(o) != component)
+                    return false;
+                generated.insert(generated.end(), oldFinal.nonTerminals.begin() + groupStart[o] + 1,
+                                 oldFinal.nonTerminals.begin() + groupEnd[o]);
+            }
+            if (componentSize[component] != members.size() ||
+                !replayFreshNames(generated.data(), generated.data() + generated.size()))
+                return false;
+            for (SymbolId nt : members)
+            {
+                SymbolId o = oldId(nt);
+                copyRules(oldFinal, oldFinal.nonTerminals.data() + groupStart[o],
+                          oldFinal.nonTerminals.data() + groupEnd[o], out);
+            }
+            return true;
+        };
+        LeftRecursionEliminator eliminator(scratch);
+        eliminator.eliminate(factored, sortedByName(factored.nonTerminals, *symbols), out, *symbols,
+                             result.recursionReports, keep);
+        report.components = result.recursionReports.size();
+        result.finalGrammar = out.build(factored.startSymbol, symbols->size());
+
+        const Grammar &finalGrammar = result.finalGrammar;
+        ruleChanged.assign(symbols->size(), 0);
+        for (SymbolId nt : finalGrammar.nonTerminals)
+        {
+            SymbolId o = oldRule(nt, oldFinalRules);
+            ruleChanged[nt] = o == NO_SYMBOL || !sameRule(finalGrammar, nt, oldFinal, o);
+        }
+    }
+
+    // --- Sets ---
+
+    void mapTerminals(const AnalysisResult &result)
+    {
+        const TerminalIndex &terminals = result.terminals;
+        denseMap.assign(old.terminals.size(), -1);
+        sameTerminals = old.terminals.size() == terminals.size();
+        for (size_t bit = 0; bit < old.terminals.size(); bit++)
+        {
+            SymbolId sym = newId(old.terminals.symbolOf[bit]);
+            if (sym != NO_SYMBOL && terminals.denseOf[sym] >= 0)
+                denseMap[bit] = terminals.denseOf[sym];
+            sameTerminals = sameTerminals && denseMap[bit] == static_cast<int32_t>(bit);
+        }
+    }
+
+    // An old FIRST or FOLLOW set in the new terminal numbering.
+    TerminalSet translate(const TerminalSet &set, size_t bits) const
+    {
+        if (sameTerminals)
+            return set;
+        TerminalSet moved(bits);
+        set.forEach([&](size_t bit) {
+            if (denseMap[bit] >= 0)
+                moved.insert(static_cast<size_t>(denseMap[bit]));
+        });
+        return moved;
+    }
+
+    // Whether the set of new non-terminal nt differs from its old one in sets, counting
+    // terminals that are no longer part of the grammar.
+    bool differs(SymbolId nt, const TerminalSet &now, const TerminalSets &oldSets, size_t bits)
+    {
+        SymbolId o = oldRule(nt, oldFinalRules);
+        if (o == NO_SYMBOL)
+            return true;
+        bool lost = false;
+        if (!sameTerminals)
+            oldSets[o].forEach([&](size_t bit) { lost = lost || denseMap[bit] < 0; });
+        return lost || now != translate(oldSets[o], bits);
+    }
+
+    // Breadth-first closure of the marked nodes over the (from, to) edges; returns the marked list.
+    std::pmr::vector<SymbolId> closure(std::pmr::vector<uint8_t> &marked,
+                                       const std::pmr::vector<std::pair<SymbolId, SymbolId>> &edges)
+    {
+        std::pmr::vector<uint32_t> offsets(scratch);
+        std::pmr::vector<SymbolId> targets(scratch);
+        buildAdjacency(edges, marked.size(), offsets, targets);
+        std::pmr::vector<SymbolId> list(scratch);
+        for (size_t nt = 0; nt < marked.size(); nt++)
+            if (marked[nt])
+                list.push_back(static_cast<SymbolId>(nt));
+        for (size_t i = 0; i < list.size(); i++)
+        {
+            SymbolId from = list[i];
+            for (uint32_t e = offsets[from]; e < offsets[from + 1]; e++)
+            {
+                if (!marked[targets[e]])
+                {
+                    marked[targets[e]] = true;
+                    list.push_back(targets[e]);
+                }
+            }
+        }
+        return list;
+    }
+
+    void updateFirst(AnalysisResult &result, IncrementalReport &report)
+    {
+        const Grammar &grammar = result.finalGrammar;
+        const TerminalIndex &terminals = result.terminals;
+        TerminalSets &first = result.firstSets;
+        first.assign(symbols->size(), TerminalSet(terminals.size()));
+        // Nullability is redone whole; the pass is linear and needs no sets.
+        result.nullable = computeNullable(grammar, *symbols, scratch);
+        const NullableSet &nullable = result.nullable;
+
+        // X reads Y when Y starts one of its productions after a nullable prefix. Unchanged rules
+        // read what they read before, so the old sets decide which edges they have.
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> readBy(scratch);   // (Y, X)
+        for (SymbolId X : grammar.nonTerminals)
+        {
+            if (ruleChanged[X])
+                continue;
+            first[X] = translate(old.firstSets[oldId(X)], terminals.size());
+            for (uint32_t p = grammar.firstProduction(X); p < grammar.endProduction(X); p++)
+            {
+                for (SymbolId sym : grammar.rhs(p))
+                {
+                    if (!symbols->isNonTerminal(sym))
+                        break;
+                    readBy.emplace_back(sym, X);
+                    SymbolId o = oldRule(sym, oldFinalRules);
+                    if (o == NO_SYMBOL || !old.nullable.test(o))
+                        break;
+                }
+            }
+        }
+        std::pmr::vector<uint8_t> affected(ruleChanged.begin(), ruleChanged.end(), scratch);
+        std::pmr::vector<SymbolId> recompute = closure(affected, readBy);
+        report.firstSets = recompute.size();
+
+        // Least fixpoint over the affected sets, everything else held at its old value.
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> mentions(scratch);
+        for (SymbolId X : recompute)
+        {
+            first[X] = TerminalSet(terminals.size());
+            for (uint32_t p = grammar.firstProduction(X); p < grammar.endProduction(X); p++)
+                for (SymbolId sym : grammar.rhs(p))
+                    if (affected[sym])
+                        mentions.emplace_back(sym, X);
+        }
+        std::pmr::vector<uint32_t> userStart(scratch);
+        std::pmr::vector<SymbolId> users(scratch);
+        buildAdjacency(mentions, symbols->size(), userStart, users);
+        std::pmr::deque<SymbolId> worklist(recompute.begin(), recompute.end(), scratch);
+        std::pmr::vector<uint8_t> queued(affected.begin(), affected.end(), scratch);
+        while (!worklist.empty())
+        {
+            SymbolId X = worklist.front();
+            worklist.pop_front();
+            queued[X] = false;
+            CFG_STAT_ADD(iterations, 1);
+            if (!refineFirst(X, grammar, *symbols, terminals, nullable, first))
+                continue;
+            for (uint32_t u = userStart[X]; u < userStart[X + 1]; u++)
+            {
+                if (!queued[users[u]])
+                {
+                    queued[users[u]] = true;
+                    worklist.push_back(users[u]);
+                }
+            }
+        }
+
+        // A set counts as changed when its terminals or its nullability did.
+        firstChanged.assign(symbols->size(), 0);
+        for (SymbolId X : recompute)
+        {
+            SymbolId o = oldRule(X, oldFinalRules);
+            firstChanged[X] = differs(X, first[X], old.firstSets, terminals.size()) ||
+                              nullable.test(X) != old.nullable.test(o);
+        }
+    }
+
+    void updateFollow(AnalysisResult &result, IncrementalReport &report)
+    {
+        const Grammar &grammar = result.finalGrammar;
+        const Grammar &oldFinal = old.finalGrammar;
+        const TerminalIndex &terminals = result.terminals;
+        const TerminalSets &first = result.firstSets;
+        const NullableSet &nullable = result.nullable;
+        TerminalSets &follow = result.followSets;
+        follow.assign(symbols->size(), TerminalSet(terminals.size()));
+        for (SymbolId nt : grammar.nonTerminals)
+        {
+            SymbolId o = oldRule(nt, oldFinalRules);
+            if (o != NO_SYMBOL)
+                follow[nt] = translate(old.followSets[o], terminals.size());
+        }
+
+        // Where every non-terminal occurs: (B, position in rhsSymbols).
+        std::pmr::vector<uint32_t> productionAt(grammar.rhsSymbols.size(), 0, scratch);
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> occurrences(scratch);
+        for (uint32_t p = 0; p < grammar.productionCount(); p++)
+        {
+            for (uint32_t k = grammar.prodStart[p]; k < grammar.prodStart[p + 1]; k++)
+            {
+                productionAt[k] = p;
+                if (symbols->isNonTerminal(grammar.rhsSymbols[k]))
+                    occurrences.emplace_back(grammar.rhsSymbols[k], static_cast<SymbolId>(k));
+            }
+        }
+        std::pmr::vector<uint32_t> occurrenceStart(scratch);
+        std::pmr::vector<SymbolId> occurrenceAt(scratch);
+        buildAdjacency(occurrences, symbols->size(), occurrenceStart, occurrenceAt);
+        occurrenceIndex.swap(occurrenceStart);
+        occurrencePosition.swap(occurrenceAt);
+        productionOf.swap(productionAt);
+
+        // FOLLOW(B) can only change if B occurs in a changed rule (old or new version), in front
+        // of a symbol whose FIRST changed, or behind a nullable tail of a rule whose FOLLOW did.
+        std::pmr::vector<uint8_t> affected(symbols->size(), 0, scratch);
+        auto mark = [&](SymbolId sym) {
+            if (symbols->isNonTerminal(sym))
+                affected[sym] = true;
+        };
+        for (SymbolId nt : grammar.nonTerminals)
+        {
+            if (!ruleChanged[nt])
+                continue;
+            for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                for (SymbolId sym : grammar.rhs(p))
+                    mark(sym);
+        }
+        for (SymbolId o : oldFinal.nonTerminals)
+        {
+            SymbolId now = newId(o);
+            if (now != NO_SYMBOL && symbols->isNonTerminal(now) && !ruleChanged[now])
+                continue;
+            for (uint32_t p = oldFinal.firstProduction(o); p < oldFinal.endProduction(o); p++)
+            {
+                for (SymbolId sym : oldFinal.rhs(p))
+                {
+                    SymbolId moved = newId(sym);
+                    if (moved != NO_SYMBOL)
+                        mark(moved);
+                }
+            }
+        }
+        for (SymbolId Y : grammar.nonTerminals)
+        {
+            if (!firstChanged[Y])
+                continue;
+            for (uint32_t i = occurrenceIndex[Y]; i < occurrenceIndex[Y + 1]; i++)
+            {
+                uint32_t k = static_cast<uint32_t>(occurrencePosition[i]);
+                for (uint32_t j = grammar.prodStart[productionOf[k]]; j < k; j++)
+                    mark(grammar.rhsSymbols[j]);
+            }
+        }
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> feeds(scratch);   // (A, B): FOLLOW(A) ⊆ FOLLOW(B)
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+        {
+            SymbolSpan rhs = grammar.rhs(p);
+            for (size_t j = rhs.size(); j-- > 0;)
+            {
+                if (symbols->isNonTerminal(rhs[j]) && rhs[j] != grammar.prodLhs[p])
+                    feeds.emplace_back(grammar.prodLhs[p], rhs[j]);
+                if (!nullable.test(rhs[j]))
+                    break;
+            }
+        }
+        std::pmr::vector<SymbolId> recompute = closure(affected, feeds);
+        report.followSets = recompute.size();
+
+        // Contributions into the affected sets, then the FOLLOW(A) ⊆ FOLLOW(B) edges among them.
+        for (SymbolId B : recompute)
+        {
+            follow[B] = TerminalSet(terminals.size());
+            if (B == grammar.startSymbol)
+                follow[B].insert(terminals.denseOf[END_MARKER]);
+        }
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> edges(scratch);
+        for (SymbolId B : recompute)
+        {
+            for (uint32_t i = occurrenceIndex[B]; i < occurrenceIndex[B + 1]; i++)
+            {
+                uint32_t k = static_cast<uint32_t>(occurrencePosition[i]);
+                uint32_t p = productionOf[k];
+                bool restNullable = true;
+                for (uint32_t j = k + 1; j < grammar.prodStart[p + 1]; j++)
+                {
+                    SymbolId beta = grammar.rhsSymbols[j];
+                    if (!symbols->isNonTerminal(beta))
+                    {
+                        follow[B].insert(terminals.denseOf[beta]);
+                        restNullable = false;
+                        break;
+                    }
+                    follow[B].unionWith(first[beta]);
+                    if (!nullable.test(beta))
+                    {
+                        restNullable = false;
+                        break;
+                    }
+                }
+                SymbolId A = grammar.prodLhs[p];
+                if (!restNullable || A == B)
+                    continue;
+                if (affected[A])
+                    edges.emplace_back(A, B);
+                else
+                    follow[B].unionWith(follow[A]);
+            }
+        }
+        std::pmr::vector<uint32_t> feedStart(scratch);
+        std::pmr::vector<SymbolId> fed(scratch);
+        buildAdjacency(edges, symbols->size(), feedStart, fed);
+        std::pmr::deque<SymbolId> worklist(recompute.begin(), recompute.end(), scratch);
+        std::pmr::vector<uint8_t> queued(affected.begin(), affected.end(), scratch);
+        while (!worklist.empty())
+        {
+            SymbolId A = worklist.front();
+            worklist.pop_front();
+            queued[A] = false;
+            CFG_STAT_ADD(iterations, 1);
+            for (uint32_t f = feedStart[A]; f < feedStart[A + 1]; f++)
+            {
+                SymbolId B = fed[f];
+                if (follow[B].unionWith(follow[A]) && !queued[B])
+                {
+                    queued[B] = true;
+                    worklist.push_back(B);
+                }
+            }
+        }
+
+        followChanged.assign(symbols->size(), 0);
+        for (SymbolId B : recompute)
+            followChanged[B] = differs(B, follow[B], old.followSets, terminals.size());
+    }
+
+    std::pmr::vector<uint32_t> occurrenceIndex{scratch};      // CSR over SymbolId into occurrencePosition
+    std::pmr::vector<SymbolId> occurrencePosition{scratch};   // positions in rhsSymbols
+    std::pmr::vector<uint32_t> productionOf{scratch};         // production of each rhsSymbols position
+
+    // --- Phase 5 ---
+
+    void updateTable(AnalysisResult &result, IncrementalReport &report)
+    {
+        const Grammar &grammar = result.finalGrammar;
+        const Grammar &oldFinal = old.finalGrammar;
+        const TerminalIndex &terminals = result.terminals;
+        const LL1Table &oldTable = old.parsingTable;
+
+        // A row changes with its rule, its FOLLOW set, or FIRST of a symbol its productions use.
+        std::pmr::vector<uint8_t> predict(symbols->size(), 0, scratch);
+        for (SymbolId nt : grammar.nonTerminals)
+            predict[nt] = ruleChanged[nt] || followChanged[nt];
+        for (SymbolId Y : grammar.nonTerminals)
+        {
+            if (!firstChanged[Y])
+                continue;
+            for (uint32_t i = occurrenceIndex[Y]; i < occurrenceIndex[Y + 1]; i++)
+                predict[grammar.prodLhs[productionOf[occurrencePosition[i]]]] = true;
+        }
+
+        // Old conflicts of each row; predictRow() records them row by row, so they are contiguous.
+        std::pmr::vector<uint32_t> conflictStart(old.symbols.size(), 0, scratch);
+        std::pmr::vector<uint32_t> conflictEnd(old.symbols.size(), 0, scratch);
+        for (uint32_t i = 0; i < oldTable.conflicts.size(); i++)
+        {
+            SymbolId nt = oldTable.conflicts[i].nonTerminal;
+            if (conflictEnd[nt] == 0)
+                conflictStart[nt] = i;
+            conflictEnd[nt] = i + 1;
+        }
+
+        // The old table can be patched in place when rows, columns and cell width all agree; the
+        // rows only need renaming when the edit interned the symbols in a different order.
+        bool inPlace = sameTerminals && grammar.nonTerminals.size() == oldFinal.nonTerminals.size() &&
+                       (grammar.productionCount() > static_cast<size_t>(INT16_MAX)) == oldTable.wideCells();
+        for (size_t i = 0; inPlace && i < grammar.nonTerminals.size(); i++)
+            inPlace = oldRule(grammar.nonTerminals[i], oldFinalRules) == oldFinal.nonTerminals[i];
+        std::vector<TableConflict> oldConflicts = oldTable.conflicts;
+        LL1Table table;
+        if (inPlace)
+        {
+            table = std::move(old.parsingTable);
+            table.relabelRows(grammar);
+            table.conflicts.clear();
+        }
+        else
+            table = LL1Table(grammar, terminals);
+
+        auto firstOfProduction = [&](uint32_t p) {
+            return firstOfSequence(grammar.rhs(p), result.firstSets, result.nullable, *symbols, terminals);
+        };
+        for (SymbolId nt : grammar.nonTerminals)
+        {
+            size_t row = static_cast<size_t>(table.row(nt));
+            SymbolId o = oldRule(nt, oldFinalRules);
+            // Conflicts are recorded in terminal order, so renumbered terminals reorder them.
+            bool reorders = o != NO_SYMBOL && !sameTerminals && conflictEnd[o] > conflictStart[o];
+            if (predict[nt] || o == NO_SYMBOL || reorders)
+            {
+                if (inPlace)
+                    table.clearRow(row);
+                predictRow(table, nt, grammar, result.followSets, terminals, firstOfProduction);
+                report.tableRows++;
+                continue;
+            }
+            int32_t delta = static_cast<int32_t>(grammar.firstProduction(nt)) - static_cast<int32_t>(oldFinal.firstProduction(o));
+            if (inPlace && delta != 0)
+                table.shiftRow(row, delta);
+            else if (!inPlace)
+            {
+                size_t oldRow = static_cast<size_t>(oldTable.row(o));
+                for (size_t column = 0; column < oldTable.columnCount(); column++)
+                {
+                    int32_t prod = oldTable.at(oldRow, column);
+                    if (prod != LL1Table::EMPTY && denseMap[column] >= 0)
+                        table.predict(row, static_cast<size_t>(denseMap[column]), static_cast<uint32_t>(prod + delta), terminals);
+                }
+            }
+            for (uint32_t i = conflictStart[o]; i < conflictEnd[o]; i++)
+            {
+                const TableConflict &conflict = oldConflicts[i];
+                table.conflicts.push_back(TableConflict{nt, newId(conflict.terminal),
+                                                         static_cast<uint32_t>(conflict.kept + delta),
+                                                         static_cast<uint32_t>(conflict.rejected + delta)});
+            }
+        }
+        report.tablePatched = inPlace;
+        result.parsingTable = std::move(table);
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef LEFT_FACTORING_H
+#define LEFT_FACTORING_H
+
+#include <cstddef>
+
+#include "grammar_ir.h"
+
+/* Phase 1 as first written: factors out the prefix shared by all alternatives of a rule.
+   trie_factoring.h has the variant that factors every shared prefix (--factor=trie).
+*/
+
+/* function for returning the length of the longest common prefix*/
+inline size_t commonPrefix(SymbolSpan a, SymbolSpan b, size_t limit)
+{
+    size_t i = 0;
+    // Continue while symbols are equal and within bounds.
+    while (i < limit && i < a.size() && i < b.size() && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+/* Copies the productions of nonTerminal from grammar into the rule being built. */
+inline void copyRule(SymbolId nonTerminal, const Grammar &grammar, GrammarBuilder &newProds)
+{
+    newProds.startRule(nonTerminal);
+    for (uint32_t p = grammar.firstProduction(nonTerminal); p < grammar.endProduction(nonTerminal); p++)
+        newProds.addProduction(grammar.rhs(p));
+}
+
+/* Performs left factoring on productions for a single non-terminal.
+ If multiple productions share a common prefix, the function factors it out by introducing a new non-terminal.
+*/
+inline void leftFactor(SymbolId nonTerminal, const Grammar& grammar, GrammarBuilder& newProds,
+                SymbolTable& symbols)
+    {
+    uint32_t first = grammar.firstProduction(nonTerminal);
+    uint32_t last = grammar.endProduction(nonTerminal);
+    // If only one production exists, no left factoring is needed.
+    if (last - first < 2)
+    {
+        copyRule(nonTerminal, grammar, newProds);
+        return;
+    }
+
+    // Compute the common prefix among all productions.
+    SymbolSpan head = grammar.rhs(first);
+    size_t common = head.size();
+    for (uint32_t p = first + 1; p < last; p++)
+    {
+        common = commonPrefix(head, grammar.rhs(p), common);
+        if (common == 0)
+            break;
+    }
+
+    // If there is a non-trivial common prefix, perform factoring.
+    if (common > 0)
+    {
+        // Create a new non-terminal (e.g., E', or E'2 if E' is taken).
+        SymbolId newNT = symbols.freshNonTerminal(symbols.name(nonTerminal));
+
+        // Create a new production for the original non-terminal:
+        // A -> common newNT
+        newProds.startRule(nonTerminal);
+        for (size_t i = 0; i < common; i++)
+            newProds.push(head[i]);
+        newProds.push(newNT);
+        newProds.endProduction();
+
+        // Create productions for the new non-terminal with the suffixes.
+        // If no suffix remains, the suffix is the empty production (ε).
+        newProds.startRule(newNT);
+        for (uint32_t p = first; p < last; p++)
+        {
+            SymbolSpan prod = grammar.rhs(p);
+            newProds.addProduction(SymbolSpan{prod.begin() + common, prod.end()});
+        }
+    }
+    else
+    {
+        // No common prefix found; simply copy the original productions.
+        copyRule(nonTerminal, grammar, newProds);
+    }
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef LEFT_RECURSION_H
+#define LEFT_RECURSION_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+
+/* Left-recursion elimination, direct and indirect.
+
+   Left recursion can only run through non-terminals that reach each other via the first
+   symbol of a production, i.e. through a strongly connected component of the "leftmost
+   symbol" graph (A -> B when some production A -> B γ exists). Tarjan's algorithm finds the
+   components; each one is handled on its own with the classic ordering algorithm: members are
+   numbered A1..An (in name order), then for every Ai the productions Ai -> Aj γ with j < i get
+   Aj substituted, and the immediate recursion left on Ai is removed. Substitution never leaves
+   the component, so non-terminals outside any cycle are copied as they are.
+
+   Components of one non-terminal are exactly the old immediate removal:
+       A -> A α | β    becomes    A -> β A'    A' -> α A' | ε
+   Productions A -> A (which add nothing to the language) are dropped. Recursion hidden behind
+   a nullable prefix (A -> B A x with B =>* ε) is not an edge of the graph and is left alone.
+   Substitution can still expose it: Aj -> ε turns Ai -> Aj Ak γ into Ai -> Ak γ, and Ak may
+   come before Aj. Such productions are kept as they are and their members reported.
+*/
+
+// One left-recursive component and how much substitution grew it.
+struct RecursionReport
+{
+    std::vector<SymbolId> members;   // in processing order
+    size_t productionsBefore = 0;
+    size_t productionsAfter = 0;     // including the rules of the new non-terminals
+    std::vector<SymbolId> hidden;    // members still left-recursive through a nullable prefix
+};
+
+class LeftRecursionEliminator
+{
+public:
+    explicit LeftRecursionEliminator(std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : scratch(scratch), component(scratch), current(scratch), rules(scratch), suffixes(scratch) {}
+
+    /* Writes grammar without left recursion into out. Non-terminals are visited in order (name
+       order in the caller); a member of a cyclic component pulls in the whole component. */
+    void eliminate(const Grammar &grammar, const std::vector<SymbolId> &order, GrammarBuilder &out,
+                   SymbolTable &symbols, std::vector<RecursionReport> &reports)
+    {
+        eliminate(grammar, order, out, symbols, reports, [](const std::pmr::vector<SymbolId> &) { return false; });
+    }
+
+    /* Like eliminate(), but offers every left-recursive component to keep(members) first. When
+       keep returns true it has written the component's rules to out itself (an incremental
+       update copies them from the previous run) and the component is not rewritten. */
+    template <typename Keep>
+    void eliminate(const Grammar &grammar, const std::vector<SymbolId> &order, GrammarBuilder &out,
+                   SymbolTable &symbols, std::vector<RecursionReport> &reports, Keep keep)
+    {
+        findComponents(grammar, symbols.size());
+        std::pmr::vector<std::pmr::vector<SymbolId>> members(componentCount, scratch);
+        for (SymbolId nt : order)
+            members[component[nt]].push_back(nt);
+        std::pmr::vector<uint8_t> done(componentCount, 0, scratch);
+
+        for (SymbolId nt : order)
+        {
+            uint32_t c = component[nt];
+            if (done[c])
+                continue;
+            done[c] = true;
+            if (members[c].size() == 1 && !leftRecursive(grammar, nt))
+            {
+                out.startRule(nt);
+                for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                    out.addProduction(grammar.rhs(p));
+                continue;
+            }
+            if (!keep(members[c]))
+                reports.push_back(eliminateComponent(grammar, members[c], out, symbols));
+        }
+    }
+
+    // Components of the leftmost-symbol graph; fills component[] for every defined
+    // non-terminal and sets componentCount.
+    void findComponents(const Grammar &grammar, size_t symbolCount)
+    {
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> edges(scratch);
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+        {
+            SymbolSpan rhs = grammar.rhs(p);
+            if (!rhs.empty() && grammar.defines(rhs[0]))
+                edges.emplace_back(grammar.prodLhs[p], rhs[0]);
+        }
+        std::pmr::vector<uint32_t> offsets(scratch);
+        std::pmr::vector<SymbolId> targets(scratch);
+        buildAdjacency(edges, symbolCount, offsets, targets);
+        componentCount = stronglyConnectedComponents(offsets, targets, grammar.nonTerminals, component, scratch);
+    }
+
+    // After findComponents(): the component of a defined non-terminal, and how many there are.
+    uint32_t componentOf(SymbolId nt) const { return component[nt]; }
+    uint32_t components() const { return componentCount; }
+
+private:
+    typedef std::pmr::vector<SymbolId> Production;
+    typedef std::pmr::vector<Production> Rule;
+
+    static bool leftRecursive(const Grammar &grammar, SymbolId nt)
+    {
+        for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+            if (!grammar.rhs(p).empty() && grammar.rhs(p)[0] == nt)
+                return true;
+        return false;
+    }
+
+    RecursionReport eliminateComponent(const Grammar &grammar, const std::pmr::vector<SymbolId> &members,
+                                       GrammarBuilder &out, SymbolTable &symbols)
+    {
+        RecursionReport report;
+        report.members.assign(members.begin(), members.end());
+        // Position of each member in the processing order, -1 outside the component.
+        current.assign(symbols.size(), -1);
+        for (size_t i = 0; i < members.size(); i++)
+            current[members[i]] = static_cast<int32_t>(i);
+
+        rules.clear();
+        for (SymbolId nt : members)
+        {
+            Rule rule(scratch);
+            for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                rule.emplace_back(grammar.rhs(p).begin(), grammar.rhs(p).end());
+            report.productionsBefore += rule.size();
+            rules.push_back(std::move(rule));
+        }
+
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            // Substitute earlier members (already free of immediate recursion) for a leading Aj.
+            if (substitute(rules[i], i))
+                report.hidden.push_back(members[i]);
+            report.productionsAfter += removeImmediate(members[i], rules[i], out, symbols);
+        }
+        return report;
+    }
+
+    // Position of prod's leading symbol in the component, -1 if it is not a member. Non-terminals
+    // introduced while processing (A -> A' for a nullable base) are not members.
+    int32_t leadingMember(const Production &prod) const
+    {
+        return prod.empty() || static_cast<size_t>(prod[0]) >= current.size() ? -1 : current[prod[0]];
+    }
+
+    /* Replaces every Ai -> Aj γ of rule (the productions of Ai) with Aj's productions followed
+       by γ, for j = 0 .. i-1 in turn, one level each. Aj only starts with later members, so a
+       pass only exposes Ak with k > j, except through Aj -> ε; a production that then starts
+       with some Ak, k <= j, is left as it is. Returns true if any was. */
+    bool substitute(Rule &rule, size_t i)
+    {
+        bool hidden = false;
+        for (size_t j = 0; j < i; j++)
+        {
+            Rule substituted(scratch);
+            for (Production &prod : rule)
+            {
+                if (leadingMember(prod) != static_cast<int32_t>(j))
+                {
+                    substituted.push_back(std::move(prod));
+                    continue;
+                }
+                for (const Production &delta : rules[j])
+                {
+                    Production expanded(delta, scratch);
+                    expanded.insert(expanded.end(), prod.begin() + 1, prod.end());
+                    int32_t k = leadingMember(expanded);
+                    if (k >= 0 && k <= static_cast<int32_t>(j))
+                        hidden = true;
+                    substituted.push_back(std::move(expanded));
+                }
+            }
+            rule = std::move(substituted);
+        }
+        return hidden;
+    }
+
+    // Removes A -> A α from rule (the productions of A), writes A's rules to out and leaves the
+    // rewritten productions of A in rule for later substitutions. Returns the productions written.
+    size_t removeImmediate(SymbolId nt, Rule &rule, GrammarBuilder &out, SymbolTable &symbols)
+    {
+        suffixes.clear();
+        Rule bases(scratch);
+        for (Production &prod : rule)
+        {
+            if (prod.empty() || prod[0] != nt)
+                bases.push_back(std::move(prod));
+            else if (prod.size() > 1)
+                suffixes.emplace_back(prod.begin() + 1, prod.end());
+        }
+        if (suffixes.empty())
+        {
+            rule = std::move(bases);
+            writeRule(nt, rule, out);
+            return rule.size();
+        }
+
+        SymbolId newNT = symbols.freshNonTerminal(symbols.name(nt));
+        for (Production &beta : bases)
+            beta.push_back(newNT);
+        for (Production &alpha : suffixes)
+            alpha.push_back(newNT);
+        suffixes.emplace_back();   // A' -> ε
+        rule = std::move(bases);
+        writeRule(nt, rule, out);
+        writeRule(newNT, suffixes, out);
+        return rule.size() + suffixes.size();
+    }
+
+    static void writeRule(SymbolId nt, const Rule &rule, GrammarBuilder &out)
+    {
+        out.startRule(nt);
+        for (const Production &prod : rule)
+            out.addProduction(SymbolSpan{prod.data(), prod.data() + prod.size()});
+    }
+
+    std::pmr::memory_resource *scratch;
+    std::pmr::vector<uint32_t> component;   // indexed by SymbolId
+    uint32_t componentCount = 0;
+    std::pmr::vector<int32_t> current;      // member position within the component being processed
+    std::pmr::vector<Rule> rules;           // working productions of that component's members
+    Rule suffixes;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef LL1_DRIVER_H
+#define LL1_DRIVER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+
+/* Token stream for the predictive parser. Each token is stored as the table column of the
+   terminal it matches, followed by a final $ column, so the driver never looks at text.
+   The text of a token is only kept as a span, into the lexed source or into ownText.
+*/
+struct TokenStream
+{
+    std::vector<int32_t> columns;        // table column of each token; the last entry is $
+    std::vector<uint32_t> lexemeStart;   // token text, only used for diagnostics
+    std::vector<uint32_t> lexemeLength;
+    const char *source = nullptr;        // text the spans point into; ownText if null
+    std::string ownText;
+    size_t unknownTokens = 0;            // tokens that match no terminal of the grammar
+
+    std::string_view lexeme(size_t token) const
+    {
+        if (token >= lexemeStart.size())
+            return "$";
+        const char *text = source ? source : ownText.data();
+        return std::string_view(text + lexemeStart[token], lexemeLength[token]);
+    }
+};
+
+/* Reads tokens in the format Lexer.java prints them, one per line:
+       Token{type=IDENTIFIER, value='x'}
+   A token matches the grammar terminal named like its value, or else the one named like its
+   type (so a grammar can use either "x" or "IDENTIFIER"). Other lines are ignored.
+*/
+inline bool loadTokenFile(const std::string &path, const SymbolTable &symbols, const TerminalIndex &terminals,
+                          TokenStream &stream)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    auto columnOf = [&](const std::string &text) -> int32_t {
+        SymbolId id = symbols.lookup(text);
+        if (id == NO_SYMBOL || static_cast<size_t>(id) >= terminals.denseOf.size())
+            return -1;
+        return terminals.denseOf[id];
+    };
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t typePos = line.find("Token{type=");
+        size_t valuePos = line.find(", value='", typePos);
+        size_t valueEnd = line.rfind("'}");
+        if (typePos == std::string::npos || valuePos == std::string::npos || valueEnd == std::string::npos ||
+            valueEnd < valuePos + 9)
+            continue;
+        std::string type = line.substr(typePos + 11, valuePos - typePos - 11);
+        std::string value = line.substr(valuePos + 9, valueEnd - valuePos - 9);
+        if (type == "EOF")
+            break;
+        // ε and $ are never input: a token spelled "$" would end the parse in mid-stream.
+        int32_t column = columnOf(value);
+        if (column <= static_cast<int32_t>(END_MARKER_BIT))
+            column = columnOf(type);
+        if (column <= static_cast<int32_t>(END_MARKER_BIT))
+        {
+            column = -1;
+            stream.unknownTokens++;
+        }
+        stream.columns.push_back(column);
+        stream.lexemeStart.push_back(static_cast<uint32_t>(stream.ownText.size()));
+        stream.lexemeLength.push_back(static_cast<uint32_t>(value.size()));
+        stream.ownText += value;
+    }
+    stream.columns.push_back(terminals.denseOf[END_MARKER]);
+    return true;
+}
+
+struct ParseResult
+{
+    bool accepted = false;
+    size_t tokensConsumed = 0;   // tokens matched before the parse stopped
+    size_t errorToken = 0;       // index of the offending token when !accepted
+    SymbolId expected = NO_SYMBOL;   // stack symbol that could not be matched or expanded
+    bool diverged = false;       // expected kept expanding without matching a token
+    size_t maxDepth = 0;         // deepest the symbol stack got
+    double seconds = 0;
+};
+
+/* What the parser reports while it parses, in pre-order: enter(A, p) when A is expanded by
+   production p, token(a, i) when terminal a matches token i, and exit(A) once everything A
+   derived has been matched. A sink whose events is false gets none of these calls and costs
+   nothing; parse(input) uses one. */
+struct NoParseEvents
+{
+    static constexpr bool events = false;
+    void enter(SymbolId, int32_t) {}
+    void token(SymbolId, size_t) {}
+    void exit(SymbolId) {}
+};
+
+/* Finds expansion cycles that match nothing, as a conflicted cell or left recursion behind ε
+   (S -> B S x with B -> ε) makes. Without a match the lookahead is fixed, so when a row is
+   expanded from stack slot s while an earlier expansion of it, from slot s' <= s, is still
+   open (the stack has not gone below s' since), the steps in between repeat forever. The
+   stack may or may not grow on the way. Open expansions are nested, so they form a stack
+   ordered by slot, and at most one of them per row is open at a time.
+*/
+class ExpansionCycles
+{
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    void reset(size_t rows)
+    {
+        open.clear();
+        openAt.assign(rows, 0);
+    }
+
+    // A token was matched or skipped, so the lookahead changed.
+    void matched()
+    {
+        for (const Open &o : open)
+            openAt[o.row] = 0;
+        open.clear();
+    }
+
+    // Row is about to be expanded from slot: returns the slot of the open expansion of row this
+    // repeats, or NONE (and opens this one).
+    size_t expand(size_t row, size_t slot)
+    {
+        while (!open.empty() && open.back().slot > slot)
+        {
+            openAt[open.back().row] = 0;
+            open.pop_back();
+        }
+        if (openAt[row] != 0)
+            return openAt[row] - 1;
+        openAt[row] = slot + 1;
+        open.push_back(Open{slot, row});
+        return NONE;
+    }
+
+private:
+    struct Open
+    {
+        size_t slot;
+        size_t row;
+    };
+
+    std::vector<Open> open;
+    std::vector<size_t> openAt;   // indexed by row: slot + 1 of its open expansion, 0 if none
+};
+
+/* Non-recursive table-driven LL(1) parser. The symbol stack is allocated once, sized from the
+   grammar, and reused across parses; it only grows if an input nests deeper than that.
+*/
+class PredictiveParser
+{
+public:
+    PredictiveParser(const Grammar &grammar, const LL1Table &table, const TerminalIndex &terminals)
+        : grammar(grammar), table(table), terminals(terminals)
+    {
+        size_t longest = 1;
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+            longest = std::max(longest, grammar.rhs(p).size());
+        stack.resize(std::max<size_t>(1024, longest * 64));
+        cycles.reset(table.rowCount());
+
+        // Precomputed per-symbol dispatch: table row for non-terminals, column for terminals.
+        rowOf.assign(terminals.denseOf.size(), -1);
+        for (size_t r = 0; r < table.rowCount(); r++)
+            rowOf[table.rowNonTerminal(r)] = static_cast<int32_t>(r);
+    }
+
+    ParseResult parse(const TokenStream &input)
+    {
+        NoParseEvents none;
+        return parse(input, none);
+    }
+
+    template <typename Sink>
+    ParseResult parse(const TokenStream &input, Sink &sink)
+    {
+        auto started = std::chrono::steady_clock::now();
+        ParseResult result;
+        const std::vector<int32_t> &columns = input.columns;
+        size_t top = 0;
+        stack[top++] = END_MARKER;
+        stack[top++] = grammar.startSymbol;
+        size_t pos = 0;
+        cycles.matched();
+
+        while (top > 0)
+        {
+            result.maxDepth = std::max(result.maxDepth, top);
+            SymbolId sym = stack[top - 1];
+            if constexpr (Sink::events)
+            {
+                // Below the symbols of an expansion sits a marker for its exit event.
+                if (sym < 0)
+                {
+                    sink.exit(EXIT_MARKER - sym);
+                    top--;
+                    continue;
+                }
+            }
+            int32_t lookahead = columns[pos];
+            int32_t row = rowOf[sym];
+            if (row < 0)
+            {
+                // Terminal (or $) on top: it must match the lookahead, and $ only the last one.
+                if (lookahead < 0 || terminals.denseOf[sym] != lookahead || (sym == END_MARKER && pos != columns.size() - 1))
+                {
+                    result.expected = sym;
+                    break;
+                }
+                if constexpr (Sink::events)
+                {
+                    if (sym != END_MARKER)
+                        sink.token(sym, pos);
+                }
+                top--;
+                pos++;
+                cycles.matched();
+                continue;
+            }
+            int32_t prod = lookahead < 0 ? LL1Table::EMPTY : table.at(static_cast<size_t>(row), lookahead);
+            if (prod == LL1Table::EMPTY)
+            {
+                result.expected = sym;
+                break;
+            }
+            // Replace the non-terminal with the production's symbols, leftmost on top.
+            SymbolSpan rhs = grammar.rhs(static_cast<size_t>(prod));
+            top--;
+            if (cycles.expand(static_cast<size_t>(row), top) != ExpansionCycles::NONE)
+            {
+                result.expected = sym;
+                result.diverged = true;
+                break;
+            }
+            size_t needed = top + rhs.size() + (Sink::events ? 1 : 0);
+            if (needed > stack.size())
+                stack.resize(std::max(stack.size() * 2, needed));
+            if constexpr (Sink::events)
+            {
+                sink.enter(sym, prod);
+                stack[top++] = EXIT_MARKER - sym;
+            }
+            for (size_t i = rhs.size(); i > 0; i--)
+                stack[top++] = rhs[i - 1];
+        }
+
+        result.accepted = top == 0 && pos == columns.size();
+        result.tokensConsumed = std::min(pos, columns.size() - 1);
+        result.errorToken = pos;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+private:
+    const Grammar &grammar;
+    const LL1Table &table;
+    const TerminalIndex &terminals;
+    std::vector<SymbolId> stack;
+    std::vector<int32_t> rowOf;   // indexed by SymbolId
+    ExpansionCycles cycles;
+
+    static constexpr SymbolId EXIT_MARKER = -2;   // EXIT_MARKER - A on the stack: exit(A) is due
+};
+
+#endif
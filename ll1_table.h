@@ -0,0 +1,159 @@
+#ifndef LL1_TABLE_H
+#define LL1_TABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+
+// A cell of the table that two productions of the same non-terminal both claim.
+struct TableConflict
+{
+    SymbolId nonTerminal;
+    SymbolId terminal;
+    uint32_t kept;       // production left in the cell (the one listed first in the grammar)
+    uint32_t rejected;   // production that also predicts this terminal
+};
+
+/* LL(1) parsing table as one flat [non-terminal row x terminal column] array of production
+   indices. Columns are the dense terminal indices of the grammar's TerminalIndex, and cells are
+   16 bits wide unless the grammar has too many productions to fit, in which case they are 32.
+*/
+class LL1Table
+{
+public:
+    static constexpr int32_t EMPTY = -1;
+
+    LL1Table() {}
+    LL1Table(const Grammar &grammar, const TerminalIndex &terminals)
+        : columns(terminals.size())
+    {
+        rowOf.assign(grammar.ruleBegin.size(), -1);
+        for (SymbolId nt : grammar.nonTerminals)
+        {
+            rowOf[nt] = static_cast<int32_t>(rowSymbol.size());
+            rowSymbol.push_back(nt);
+        }
+        wide = grammar.productionCount() > static_cast<size_t>(std::numeric_limits<int16_t>::max());
+        if (wide)
+            cells32.assign(rowSymbol.size() * columns, EMPTY);
+        else
+            cells16.assign(rowSymbol.size() * columns, EMPTY);
+    }
+
+    size_t rowCount() const { return rowSymbol.size(); }
+    size_t columnCount() const { return columns; }
+    SymbolId rowNonTerminal(size_t row) const { return rowSymbol[row]; }
+    int32_t row(SymbolId nt) const { return static_cast<size_t>(nt) < rowOf.size() ? rowOf[nt] : -1; }
+    bool wideCells() const { return wide; }
+    size_t bytes() const { return cells16.size() * sizeof(int16_t) + cells32.size() * sizeof(int32_t); }
+
+    // Production predicted for (row, column), or EMPTY.
+    int32_t at(size_t row, size_t column) const
+    {
+        size_t i = row * columns + column;
+        return wide ? cells32[i] : cells16[i];
+    }
+
+    // Fills an empty cell; an occupied cell keeps its production and the clash is recorded.
+    void predict(size_t row, size_t column, uint32_t prod, const TerminalIndex &terminals)
+    {
+        int32_t current = at(row, column);
+        if (current == EMPTY)
+        {
+            size_t i = row * columns + column;
+            if (wide)
+                cells32[i] = static_cast<int32_t>(prod);
+            else
+                cells16[i] = static_cast<int16_t>(prod);
+        }
+        else if (current != static_cast<int32_t>(prod))
+        {
+            conflicts.push_back(TableConflict{rowSymbol[row], terminals.symbolOf[column],
+                                              static_cast<uint32_t>(current), prod});
+        }
+    }
+
+    // Empties every cell of row; conflicts recorded for it are left to the caller.
+    void clearRow(size_t row)
+    {
+        size_t begin = row * columns;
+        if (wide)
+            std::fill(cells32.begin() + begin, cells32.begin() + begin + columns, EMPTY);
+        else
+            std::fill(cells16.begin() + begin, cells16.begin() + begin + columns, EMPTY);
+    }
+
+    // Adds delta to every production index in row, for a rule that moved within the grammar.
+    void shiftRow(size_t row, int32_t delta)
+    {
+        for (size_t column = 0, i = row * columns; column < columns; column++, i++)
+        {
+            if (wide && cells32[i] != EMPTY)
+                cells32[i] += delta;
+            else if (!wide && cells16[i] != EMPTY)
+                cells16[i] = static_cast<int16_t>(cells16[i] + delta);
+        }
+    }
+
+    // Renames the rows to grammar's non-terminals, position for position, keeping every cell.
+    void relabelRows(const Grammar &grammar)
+    {
+        rowOf.assign(grammar.ruleBegin.size(), -1);
+        for (size_t row = 0; row < rowSymbol.size(); row++)
+        {
+            rowSymbol[row] = grammar.nonTerminals[row];
+            rowOf[rowSymbol[row]] = static_cast<int32_t>(row);
+        }
+    }
+
+    std::vector<TableConflict> conflicts;
+
+private:
+    friend class GrammarCache;
+    size_t columns = 0;
+    bool wide = false;
+    std::vector<int16_t> cells16;
+    std::vector<int32_t> cells32;
+    std::vector<int32_t> rowOf;        // indexed by SymbolId, -1 for symbols without a row
+    std::vector<SymbolId> rowSymbol;
+};
+
+/* Fills the (empty) row of nonTerminal from FIRST(alpha) of each of its productions and, for
+   productions that can derive ε, FOLLOW(nonTerminal). firstOfProduction(p) returns FIRST of
+   production p's right-hand side as a TerminalSet or TerminalSetView.
+*/
+template <typename FirstOfProduction>
+void predictRow(LL1Table &table, SymbolId nonTerminal, const Grammar &grammar, const TerminalSets &follow,
+                const TerminalIndex &terminals, FirstOfProduction &firstOfProduction)
+{
+    size_t row = static_cast<size_t>(table.row(nonTerminal));
+    for (uint32_t p = grammar.firstProduction(nonTerminal); p < grammar.endProduction(nonTerminal); p++)
+    {
+        const auto &firstAlpha = firstOfProduction(p);
+        // Every terminal in FIRST(alpha) except ε predicts this production.
+        firstAlpha.forEach([&](size_t bit) {
+            if (bit != EPSILON_BIT)
+                table.predict(row, bit, p, terminals);
+        });
+        // If ε is in FIRST(alpha), so does every terminal in FOLLOW(nonTerminal).
+        if (firstAlpha.test(EPSILON_BIT))
+            follow[nonTerminal].forEach([&](size_t bit) { table.predict(row, bit, p, terminals); });
+    }
+}
+
+/* Phase 5: fills the table row by row, in the order the grammar defines its non-terminals. */
+template <typename FirstOfProduction>
+LL1Table buildLL1Table(const Grammar &grammar, const TerminalSets &follow, const TerminalIndex &terminals,
+                       FirstOfProduction firstOfProduction)
+{
+    LL1Table table(grammar, terminals);
+    for (SymbolId nonTerminal : grammar.nonTerminals)
+        predictRow(table, nonTerminal, grammar, follow, terminals, firstOfProduction);
+    return table;
+}
+
+#endif
@@ -0,0 +1,735 @@
+#ifndef LOOKAHEAD_ANALYSIS_H
+#define LOOKAHEAD_ANALYSIS_H
+
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "dependency_graph.h"
+#include "flat_hash_map.h"
+#include "output_writer.h"
+
+/* --lookahead: explains the conflicting cells of the LL(1) table and tries to resolve them
+   with up to k tokens of lookahead.
+
+   For a cell M[A, a] claimed by several productions, the alternatives are simulated side by
+   side over a trie of lookahead sequences. A trie node is a prefix t1..td of the input after
+   A; it holds the configurations (alternative, stack of symbols still to derive) that can
+   match that prefix. Expanding a non-terminal on top of a stack pushes each of its
+   productions, and when an alternative has derived all of A the stack continues with what
+   follows A: every occurrence B -> γ A δ continues with δ and then with what follows B, and
+   the start symbol with $. This is FIRST_k(α FOLLOW_k(A)), the lookahead a strong LL(k)
+   table would use, computed one prefix at a time. Stacks are hash-consed into one pool, so
+   equal configurations are found by comparing two integers.
+
+   Children of a node are only built while it still holds more than one alternative, so the
+   trie holds just the prefixes that need another token. A node left with one alternative
+   is an entry of the LL(k) decision table. A node at depth k with several alternatives means
+   the cell is not LL(k). Two alternatives that reach the same stack after the same prefix
+   derive the same inputs from there on, which no amount of lookahead decides; for this test
+   a follow marker of X stands for B's when X only ever ends productions of B. A stack is cut
+   below the symbols that already yield the tokens still needed, and the cut is marked per
+   alternative, so a shortened stack is never mistaken for another's. Breadth-first order finds
+   the shortest such prefix. Every cell has its own budget of configurations and time; a cell
+   that exceeds it is reported as undecided instead of holding up the rest.
+
+   The example printed for a cell is a shortest input that reaches A (S =>* w A ...)
+   followed by the shared lookahead, which is where the LL(1) parser has to guess.
+*/
+
+struct LookaheadBudget
+{
+    size_t maxTokens = 3;                  // k
+    size_t configurations = 100000;        // per cell
+    double seconds = 0.25;                 // per cell
+};
+
+enum class LookaheadVerdict
+{
+    Resolved,     // decided with depth tokens
+    NotLLk,       // prefix of maxTokens tokens still predicts several alternatives
+    Ambiguous,    // a complete input is predicted by several alternatives
+    OverBudget
+};
+
+struct LookaheadDecision
+{
+    std::vector<SymbolId> lookahead;   // terminals, starting with the cell's
+    uint32_t production;
+};
+
+struct LookaheadCell
+{
+    SymbolId nonTerminal = NO_SYMBOL;
+    SymbolId terminal = NO_SYMBOL;
+    std::vector<uint32_t> alternatives;   // the production kept in the table first
+    LookaheadVerdict verdict = LookaheadVerdict::OverBudget;
+    size_t depth = 1;                     // tokens needed when resolved
+    std::vector<SymbolId> shared;         // a longest examined prefix predicting several alternatives
+    std::vector<uint32_t> sharedBy;       // the alternatives predicting it
+    std::vector<LookaheadDecision> decisions;   // resolved cells only
+    size_t configurations = 0;
+    double seconds = 0;
+};
+
+class LookaheadAnalyzer
+{
+public:
+    LookaheadAnalyzer(const Grammar &grammar, const LL1Table &table, const TerminalIndex &terminals,
+                      const NullableSet &nullable, const TerminalSets &first, const TerminalSets &follow)
+        : grammar(grammar), table(table), terminals(terminals), nullable(nullable), first(first), follow(follow),
+          endColumn(static_cast<size_t>(terminals.denseOf[END_MARKER]))
+    {
+        size_t symbolCount = grammar.ruleBegin.size();
+        productionAt.resize(grammar.rhsSymbols.size());
+        std::pmr::vector<std::pair<SymbolId, SymbolId>> edges;   // (non-terminal, rhs position)
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+            for (uint32_t g = grammar.prodStart[p]; g < grammar.prodStart[p + 1]; g++)
+            {
+                productionAt[g] = static_cast<uint32_t>(p);
+                if (!isTerminal(grammar.rhsSymbols[g]))
+                    edges.emplace_back(grammar.rhsSymbols[g], static_cast<SymbolId>(g));
+            }
+        buildAdjacency(edges, symbolCount, occurrenceStart, occurrenceAt);
+
+        // What follows X is what follows B when X only ever ends productions of B, so the two
+        // markers are made one and stacks that continue the same way compare equal.
+        std::vector<SymbolId> tailOf(symbolCount, NO_SYMBOL);
+        for (SymbolId nt : grammar.nonTerminals)
+        {
+            SymbolId owner = NO_SYMBOL;
+            bool tail = nt != grammar.startSymbol && occurrenceStart[nt] != occurrenceStart[nt + 1];
+            for (uint32_t i = occurrenceStart[nt]; i < occurrenceStart[nt + 1] && tail; i++)
+            {
+                uint32_t g = static_cast<uint32_t>(occurrenceAt[i]);
+                uint32_t p = productionAt[g];
+                tail = g + 1 == grammar.prodStart[p + 1] && grammar.prodLhs[p] != nt &&
+                       (owner == NO_SYMBOL || owner == grammar.prodLhs[p]);
+                owner = grammar.prodLhs[p];
+            }
+            if (tail)
+                tailOf[nt] = owner;
+        }
+        followOf.resize(symbolCount);
+        for (size_t sym = 0; sym < symbolCount; sym++)
+        {
+            SymbolId end = static_cast<SymbolId>(sym);
+            for (size_t steps = 0; tailOf[end] != NO_SYMBOL && steps < grammar.nonTerminals.size(); steps++)
+                end = tailOf[end];
+            followOf[sym] = tailOf[end] == NO_SYMBOL ? end : static_cast<SymbolId>(sym);   // a cycle keeps its own
+        }
+        shortestYields();
+        shortestContexts();
+    }
+
+    std::vector<LookaheadCell> analyze(const LookaheadBudget &budget)
+    {
+        std::vector<LookaheadCell> cells;
+        FlatHashMap<uint64_t, uint32_t> cellOf;
+        for (const TableConflict &conflict : table.conflicts)
+        {
+            uint64_t key = (uint64_t(uint32_t(conflict.nonTerminal)) << 32) | uint32_t(conflict.terminal);
+            auto found = cellOf.emplace(key, static_cast<uint32_t>(cells.size()));
+            if (found.second)
+            {
+                cells.emplace_back();
+                cells.back().nonTerminal = conflict.nonTerminal;
+                cells.back().terminal = conflict.terminal;
+                cells.back().alternatives.push_back(conflict.kept);
+            }
+            std::vector<uint32_t> &alternatives = cells[*found.first].alternatives;
+            if (std::find(alternatives.begin(), alternatives.end(), conflict.rejected) == alternatives.end())
+                alternatives.push_back(conflict.rejected);
+        }
+        for (LookaheadCell &cell : cells)
+            analyzeCell(cell, budget);
+        return cells;
+    }
+
+    // A shortest terminal string w with S =>* w nt ..., at most limit tokens; false if nt is
+    // unreachable or the string would be longer.
+    bool shortestPrefix(SymbolId nt, size_t limit, std::vector<SymbolId> &prefix) const
+    {
+        prefix.clear();
+        if (static_cast<size_t>(nt) >= context.size() || context[nt] == UNREACHED || context[nt] > limit)
+            return false;
+        std::vector<uint32_t> steps;   // rhs positions from nt up to the start symbol
+        for (SymbolId sym = nt; sym != grammar.startSymbol; sym = grammar.prodLhs[productionAt[via[sym]]])
+            steps.push_back(via[sym]);
+        for (size_t s = steps.size(); s > 0; s--)
+        {
+            uint32_t position = steps[s - 1];
+            for (uint32_t g = grammar.prodStart[productionAt[position]]; g < position; g++)
+                appendYield(grammar.rhsSymbols[g], prefix);
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t EMPTY_STACK = UINT32_MAX;
+    static constexpr uint64_t UNREACHED = UINT64_MAX;
+    static constexpr size_t ANY_COLUMN = SIZE_MAX;
+
+    // A stack cell: symbol on top of the stack below. A symbol below NO_SYMBOL is the marker
+    // "what follows X" for X = NO_SYMBOL - 1 - symbol; past the last SymbolId it marks where a
+    // stack of one alternative was cut off.
+    struct StackCell
+    {
+        SymbolId symbol;
+        uint32_t below;
+    };
+
+    struct Configuration
+    {
+        uint32_t alternative;   // index into the cell's alternatives
+        uint32_t stack;
+    };
+
+    // A configuration with its next terminal matched.
+    struct Ready
+    {
+        uint32_t column;
+        uint32_t alternative;
+        uint32_t below;
+
+        bool operator<(const Ready &other) const
+        {
+            if (column != other.column)
+                return column < other.column;
+            return below != other.below ? below < other.below : alternative < other.alternative;
+        }
+        bool operator==(const Ready &other) const
+        {
+            return column == other.column && alternative == other.alternative && below == other.below;
+        }
+    };
+
+    struct TrieNode
+    {
+        uint32_t parent;
+        SymbolId terminal;
+        uint32_t depth;
+        uint32_t kernelBegin, kernelEnd;   // configurations after matching terminal
+    };
+
+    const Grammar &grammar;
+    const LL1Table &table;
+    const TerminalIndex &terminals;
+    const NullableSet &nullable;
+    const TerminalSets &first;
+    const TerminalSets &follow;
+    size_t endColumn;
+    std::vector<uint32_t> productionAt;   // production of each rhsSymbols position
+    std::pmr::vector<uint32_t> occurrenceStart;
+    std::pmr::vector<SymbolId> occurrenceAt;     // rhs positions where a non-terminal appears
+    std::vector<SymbolId> followOf;       // the non-terminal whose follow marker stands for each
+    std::vector<uint64_t> yieldLength;    // shortest terminal string a non-terminal derives
+    std::vector<uint32_t> yieldVia;       // the production giving it
+    std::vector<uint64_t> context;        // length of a shortest w with S =>* w nt ...
+    std::vector<uint32_t> via;            // rhs position nt is reached through
+
+    std::vector<StackCell> pool;
+    FlatHashMap<uint64_t, uint32_t> consed;   // (symbol, below) -> pool index
+    std::vector<Configuration> work;
+    FlatHashMap<uint64_t, char> seen;         // (alternative, stack) already in work
+    std::vector<SymbolId> cut;
+
+    SymbolId followMarker(SymbolId nt) const { return NO_SYMBOL - 1 - followOf[nt]; }
+    SymbolId cutMarker(uint32_t alternative) const
+    {
+        return NO_SYMBOL - 1 - static_cast<SymbolId>(grammar.ruleBegin.size() + alternative);
+    }
+
+    uint32_t push(SymbolId symbol, uint32_t below)
+    {
+        uint64_t key = (uint64_t(uint32_t(symbol)) << 32) | below;
+        auto found = consed.emplace(key, static_cast<uint32_t>(pool.size()));
+        if (found.second)
+            pool.push_back(StackCell{symbol, below});
+        return *found.first;
+    }
+
+    // Pushes rhsSymbols[from, to) so that rhsSymbols[from] ends up on top.
+    uint32_t pushSymbols(uint32_t from, uint32_t to, uint32_t below)
+    {
+        for (uint32_t g = to; g > from; g--)
+            below = push(grammar.rhsSymbols[g - 1], below);
+        return below;
+    }
+
+    // Symbols are told apart by their table column: a non-terminal can have no productions
+    // left (B -> B x after left recursion removal) and then derives nothing.
+    bool isTerminal(SymbolId sym) const { return terminals.denseOf[sym] >= 0; }
+
+    uint64_t symbolLength(SymbolId sym) const { return isTerminal(sym) ? 1 : yieldLength[sym]; }
+
+    // Knuth's generalization of Dijkstra: a production's length is known once all its
+    // non-terminals are, and the shortest known production settles its left-hand side.
+    void shortestYields()
+    {
+        size_t symbolCount = grammar.ruleBegin.size();
+        yieldLength.assign(symbolCount, UNREACHED);
+        yieldVia.assign(symbolCount, 0);
+        std::vector<uint32_t> pending(grammar.productionCount(), 0);
+        std::vector<uint64_t> length(grammar.productionCount(), 0);
+        typedef std::pair<uint64_t, uint32_t> Candidate;   // (length, production)
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+        for (size_t p = 0; p < grammar.productionCount(); p++)
+        {
+            for (SymbolId sym : grammar.rhs(p))
+                isTerminal(sym) ? length[p]++ : pending[p]++;
+            if (pending[p] == 0)
+                queue.emplace(length[p], static_cast<uint32_t>(p));
+        }
+        while (!queue.empty())
+        {
+            Candidate best = queue.top();
+            queue.pop();
+            SymbolId nt = grammar.prodLhs[best.second];
+            if (yieldLength[nt] != UNREACHED)
+                continue;
+            yieldLength[nt] = best.first;
+            yieldVia[nt] = best.second;
+            for (uint32_t i = occurrenceStart[nt]; i < occurrenceStart[nt + 1]; i++)
+            {
+                uint32_t p = productionAt[occurrenceAt[i]];
+                length[p] += best.first;
+                if (--pending[p] == 0)
+                    queue.emplace(length[p], p);
+            }
+        }
+    }
+
+    // Dijkstra from the start symbol: reaching rhs position i of A -> X1..Xn costs the
+    // shortest yields of X1..Xi-1.
+    void shortestContexts()
+    {
+        size_t symbolCount = grammar.ruleBegin.size();
+        context.assign(symbolCount, UNREACHED);
+        via.assign(symbolCount, 0);
+        if (!grammar.defines(grammar.startSymbol))
+            return;
+        typedef std::pair<uint64_t, SymbolId> Candidate;
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+        std::vector<char> settled(symbolCount, 0);
+        context[grammar.startSymbol] = 0;
+        queue.emplace(0, grammar.startSymbol);
+        while (!queue.empty())
+        {
+            Candidate best = queue.top();
+            queue.pop();
+            SymbolId nt = best.second;
+            if (settled[nt])
+                continue;
+            settled[nt] = 1;
+            for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+            {
+                uint64_t reached = best.first;
+                for (uint32_t g = grammar.prodStart[p]; g < grammar.prodStart[p + 1] && reached != UNREACHED; g++)
+                {
+                    SymbolId sym = grammar.rhsSymbols[g];
+                    if (!isTerminal(sym) && reached < context[sym])
+                    {
+                        context[sym] = reached;
+                        via[sym] = g;
+                        queue.emplace(reached, sym);
+                    }
+                    uint64_t length = symbolLength(sym);
+                    reached = length == UNREACHED ? UNREACHED : reached + length;
+                }
+            }
+        }
+    }
+
+    void appendYield(SymbolId sym, std::vector<SymbolId> &out) const
+    {
+        std::vector<SymbolId> work{sym};
+        while (!work.empty())
+        {
+            SymbolId top = work.back();
+            work.pop_back();
+            if (isTerminal(top))
+            {
+                out.push_back(top);
+                continue;
+            }
+            SymbolSpan rhs = grammar.rhs(yieldVia[top]);
+            for (size_t i = rhs.size(); i > 0; i--)
+                work.push_back(rhs[i - 1]);
+        }
+    }
+
+    /* Cuts stack off below the point where at least needed tokens are derived before it is
+       reached, since no lookahead gets that far. This keeps stacks from growing without bound
+       when a non-terminal reappears on top through left recursion hidden behind ε, and makes
+       configurations that only differ further down equal. The cut is marked per alternative,
+       so two alternatives never look as if they continued identically because of it. */
+    uint32_t truncate(uint32_t stack, uint64_t needed, uint32_t alternative)
+    {
+        uint64_t produced = 0;
+        size_t kept = 0;
+        uint32_t s = stack;
+        for (; s != EMPTY_STACK && produced < needed; s = pool[s].below, kept++)
+        {
+            SymbolId sym = pool[s].symbol;
+            uint64_t length = sym < 0 ? 0 : symbolLength(sym);
+            produced = length == UNREACHED ? UNREACHED : produced + length;
+        }
+        if (s == EMPTY_STACK)
+            return stack;
+        cut.clear();
+        for (s = stack; kept > 0; s = pool[s].below, kept--)
+            cut.push_back(pool[s].symbol);
+        uint32_t top = push(cutMarker(alternative), EMPTY_STACK);
+        for (size_t i = cut.size(); i > 0; i--)
+            top = push(cut[i - 1], top);
+        return top;
+    }
+
+    enum class Start
+    {
+        No,        // the symbols cannot begin with the terminal
+        Begins,    // they can
+        Vanishes   // they cannot, but they derive ε
+    };
+
+    // Whether rhsSymbols[from, to) can derive a string that begins with column.
+    Start startsWith(uint32_t from, uint32_t to, size_t column) const
+    {
+        for (uint32_t g = from; g < to; g++)
+        {
+            SymbolId sym = grammar.rhsSymbols[g];
+            if (isTerminal(sym))
+                return static_cast<size_t>(terminals.denseOf[sym]) == column ? Start::Begins : Start::No;
+            if (first[sym].test(column))
+                return Start::Begins;
+            if (!nullable.test(sym))
+                return Start::No;
+        }
+        return Start::Vanishes;
+    }
+
+    // The configurations of kernel with their next terminal matched, by column. The closure
+    // goes through every production; with a column given it only expands productions and
+    // continuations that can begin with it, which is how the root follows the cell's own
+    // terminal without exploring the rest of FOLLOW(A).
+    void advance(const Configuration *kernel, size_t count, size_t column, uint64_t needed, std::vector<Ready> &matched,
+                 LookaheadCell &cell, const std::function<bool()> &overBudget)
+    {
+        work.assign(kernel, kernel + count);
+        seen.clear();
+        for (const Configuration &c : work)
+            seen.emplace((uint64_t(c.alternative) << 32) | c.stack, 1);
+        auto reach = [&](uint32_t alternative, uint32_t stack) {
+            stack = truncate(stack, needed, alternative);
+            if (seen.emplace((uint64_t(alternative) << 32) | stack, 1).second)
+            {
+                work.push_back(Configuration{alternative, stack});
+                cell.configurations++;
+            }
+        };
+        auto reachSymbols = [&](uint32_t alternative, uint32_t from, uint32_t to, uint32_t below) {
+            Start start = column == ANY_COLUMN ? Start::Begins : startsWith(from, to, column);
+            if (start == Start::Begins)
+                reach(alternative, pushSymbols(from, to, below));
+            else if (start == Start::Vanishes)
+                reach(alternative, below);
+        };
+        matched.clear();
+        for (size_t i = 0; i < work.size(); i++)
+        {
+            if (overBudget())
+                return;
+            Configuration c = work[i];
+            if (c.stack == EMPTY_STACK)
+                continue;
+            StackCell top = pool[c.stack];
+            if (top.symbol >= 0 && isTerminal(top.symbol))
+            {
+                size_t at = static_cast<size_t>(terminals.denseOf[top.symbol]);
+                if (column == ANY_COLUMN || at == column)
+                    matched.push_back(Ready{static_cast<uint32_t>(at), c.alternative, top.below});
+            }
+            else if (top.symbol >= 0)
+            {
+                for (uint32_t p = grammar.firstProduction(top.symbol); p < grammar.endProduction(top.symbol); p++)
+                    reachSymbols(c.alternative, grammar.prodStart[p], grammar.prodStart[p + 1], top.below);
+            }
+            else
+            {
+                SymbolId derived = NO_SYMBOL - 1 - top.symbol;
+                if (static_cast<size_t>(derived) >= grammar.ruleBegin.size())
+                    continue;   // cut off; only reached past k tokens
+                if (derived == grammar.startSymbol && (column == ANY_COLUMN || column == endColumn))
+                    matched.push_back(Ready{static_cast<uint32_t>(endColumn), c.alternative, top.below});
+                for (uint32_t j = occurrenceStart[derived]; j < occurrenceStart[derived + 1]; j++)
+                {
+                    uint32_t g = static_cast<uint32_t>(occurrenceAt[j]);
+                    uint32_t p = productionAt[g];
+                    reachSymbols(c.alternative, g + 1, grammar.prodStart[p + 1],
+                                 push(followMarker(grammar.prodLhs[p]), top.below));
+                }
+            }
+        }
+        std::sort(matched.begin(), matched.end());
+        matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+    }
+
+    void analyzeCell(LookaheadCell &cell, const LookaheadBudget &budget)
+    {
+        auto started = std::chrono::steady_clock::now();
+        pool.clear();
+        consed.clear();
+        std::vector<Configuration> kernels;
+        std::vector<Ready> matched;
+        std::vector<TrieNode> nodes;
+        std::vector<char> present(cell.alternatives.size());
+        cell.verdict = LookaheadVerdict::Resolved;
+
+        size_t steps = 0;
+        std::function<bool()> overBudget = [&]() {
+            if (cell.verdict == LookaheadVerdict::OverBudget)
+                return true;
+            if (cell.configurations <= budget.configurations &&
+                (++steps % 1024 != 0 ||
+                 std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() <= budget.seconds))
+                return false;
+            cell.verdict = LookaheadVerdict::OverBudget;
+            return true;
+        };
+        auto pathOf = [&](uint32_t node) {
+            std::vector<SymbolId> path;
+            for (; nodes[node].parent != UINT32_MAX; node = nodes[node].parent)
+                path.push_back(nodes[node].terminal);
+            std::reverse(path.begin(), path.end());
+            return path;
+        };
+
+        for (uint32_t a = 0; a < cell.alternatives.size(); a++)
+        {
+            uint32_t p = cell.alternatives[a];
+            uint32_t stack = pushSymbols(grammar.prodStart[p], grammar.prodStart[p + 1],
+                                         push(followMarker(cell.nonTerminal), EMPTY_STACK));
+            kernels.push_back(Configuration{a, truncate(stack, budget.maxTokens, a)});
+        }
+        nodes.push_back(TrieNode{UINT32_MAX, NO_SYMBOL, 0, 0, static_cast<uint32_t>(kernels.size())});
+
+        for (uint32_t n = 0; n < nodes.size() && cell.verdict != LookaheadVerdict::OverBudget; n++)
+        {
+            TrieNode node = nodes[n];
+            std::fill(present.begin(), present.end(), 0);
+            size_t alternatives = 0;
+            for (uint32_t i = node.kernelBegin; i < node.kernelEnd; i++)
+            {
+                alternatives += present[kernels[i].alternative] == 0;
+                present[kernels[i].alternative] = 1;
+            }
+            if (alternatives == 1)
+            {
+                uint32_t a = static_cast<uint32_t>(std::find(present.begin(), present.end(), 1) - present.begin());
+                cell.decisions.push_back(LookaheadDecision{pathOf(n), cell.alternatives[a]});
+                cell.depth = std::max<size_t>(cell.depth, node.depth);
+                continue;
+            }
+            if (n > 0 && node.depth > cell.shared.size())
+            {
+                cell.shared = pathOf(n);
+                cell.sharedBy.clear();
+                for (uint32_t a = 0; a < present.size(); a++)
+                    if (present[a])
+                        cell.sharedBy.push_back(cell.alternatives[a]);
+            }
+
+            // One child per terminal that can come next; the root only follows the cell's own.
+            advance(kernels.data() + node.kernelBegin, node.kernelEnd - node.kernelBegin,
+                    n == 0 ? static_cast<size_t>(terminals.denseOf[cell.terminal]) : ANY_COLUMN,
+                    budget.maxTokens - node.depth, matched, cell, overBudget);
+            if (cell.verdict == LookaheadVerdict::OverBudget)
+                break;
+            size_t children = 0;
+            // A child where two alternatives are left with the same stack is ambiguous: they
+            // derive the same inputs from there on. Otherwise a child at depth k that still has
+            // several alternatives shows the cell is not LL(k).
+            uint32_t ambiguous = UINT32_MAX, undecided = UINT32_MAX;
+            for (size_t i = 0; i < matched.size(); children++)
+            {
+                uint32_t begin = static_cast<uint32_t>(kernels.size());
+                size_t end = i;
+                bool mixed = false, same = false;
+                for (; end < matched.size() && matched[end].column == matched[i].column; end++)
+                {
+                    mixed = mixed || matched[end].alternative != matched[i].alternative;
+                    same = same || (end > i && matched[end].below == matched[end - 1].below);
+                    kernels.push_back(Configuration{matched[end].alternative, matched[end].below});
+                }
+                SymbolId terminal = terminals.symbolOf[matched[i].column];
+                if (same && ambiguous == UINT32_MAX)
+                    ambiguous = static_cast<uint32_t>(nodes.size());
+                if (mixed && undecided == UINT32_MAX && node.depth + 1 == budget.maxTokens)
+                    undecided = static_cast<uint32_t>(nodes.size());
+                nodes.push_back(TrieNode{n, terminal, node.depth + 1, begin, static_cast<uint32_t>(kernels.size())});
+                i = end;
+            }
+            if (ambiguous != UINT32_MAX || undecided != UINT32_MAX)
+            {
+                uint32_t shown = ambiguous != UINT32_MAX ? ambiguous : undecided;
+                cell.verdict = ambiguous != UINT32_MAX ? LookaheadVerdict::Ambiguous : LookaheadVerdict::NotLLk;
+                cell.shared = pathOf(shown);
+                std::fill(present.begin(), present.end(), 0);
+                for (uint32_t i = nodes[shown].kernelBegin; i < nodes[shown].kernelEnd; i++)
+                    present[kernels[i].alternative] = 1;
+                cell.sharedBy.clear();
+                for (uint32_t a = 0; a < present.size(); a++)
+                    if (present[a])
+                        cell.sharedBy.push_back(cell.alternatives[a]);
+                break;
+            }
+            // Several alternatives derive this prefix and nothing can follow it.
+            if (children == 0)
+            {
+                cell.verdict = LookaheadVerdict::Ambiguous;
+                break;
+            }
+        }
+        if (cell.verdict != LookaheadVerdict::Resolved)
+            cell.decisions.clear();
+        cell.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+};
+
+// Writes the explanation of every cell and the LL(k) decision table of those resolved.
+inline bool writeLookaheadReport(FILE *file, const std::vector<LookaheadCell> &cells, const LookaheadAnalyzer &analyzer,
+                                 const LookaheadBudget &budget, const Grammar &grammar, const SymbolTable &symbols)
+{
+    OutputBuffer out(file);
+    auto appendTokens = [&](const std::vector<SymbolId> &tokens) {
+        for (size_t i = 0; i < tokens.size(); i++)
+        {
+            if (i > 0)
+                out.append(' ');
+            out.append(symbols.name(tokens[i]));
+        }
+    };
+    auto appendProduction = [&](uint32_t p) {
+        out.append(symbols.name(grammar.prodLhs[p]));
+        out.append(" -> ");
+        out.append(renderProduction(grammar.rhs(p), symbols));
+    };
+
+    out.append("LL(k) lookahead for ");
+    out.appendNumber(cells.size());
+    out.append(" conflicting LL(1) cells, k <= ");
+    out.appendNumber(budget.maxTokens);
+    out.append(" (");
+    out.appendNumber(budget.configurations);
+    out.append(" configurations and ");
+    out.appendNumber(static_cast<uint64_t>(budget.seconds * 1000 + 0.5));
+    out.append(" ms per cell)\n");
+
+    const size_t exampleLimit = 64;
+    std::vector<SymbolId> prefix;
+    for (const LookaheadCell &cell : cells)
+    {
+        out.append("\nM[");
+        out.append(symbols.name(cell.nonTerminal));
+        out.append(", ");
+        out.append(symbols.name(cell.terminal));
+        out.append("]:");
+        for (uint32_t p : cell.alternatives)
+        {
+            out.append("\n  ");
+            out.appendNumber(p);
+            out.append(": ");
+            appendProduction(p);
+        }
+        out.append("\n  verdict: ");
+        switch (cell.verdict)
+        {
+        case LookaheadVerdict::Resolved:
+            out.append("LL(");
+            out.appendNumber(cell.depth);
+            out.append("), decided by ");
+            out.appendNumber(cell.depth);
+            out.append(cell.depth == 1 ? " token" : " tokens");
+            break;
+        case LookaheadVerdict::NotLLk:
+            out.append("not LL(");
+            out.appendNumber(budget.maxTokens);
+            out.append(")");
+            break;
+        case LookaheadVerdict::Ambiguous:
+            out.append("not LL(k) for any k, the same input is predicted by several productions");
+            break;
+        case LookaheadVerdict::OverBudget:
+            out.append("undecided, over budget");
+            break;
+        }
+        out.append(" (");
+        out.appendNumber(cell.configurations);
+        out.append(" configurations)\n");
+
+        if (!cell.shared.empty())
+        {
+            out.append("  shared lookahead: ");
+            appendTokens(cell.shared);
+            out.append(" (");
+            for (size_t i = 0; i < cell.sharedBy.size(); i++)
+            {
+                out.append(i == 0 ? "productions " : ", ");
+                out.appendNumber(cell.sharedBy[i]);
+            }
+            out.append(")\n  example: ");
+            if (analyzer.shortestPrefix(cell.nonTerminal, exampleLimit, prefix))
+            {
+                appendTokens(prefix);
+                out.append(prefix.empty() ? "." : " .");
+            }
+            else
+                out.append("... .");
+            out.append(' ');
+            appendTokens(cell.shared);
+            out.append('\n');
+        }
+        for (const LookaheadDecision &decision : cell.decisions)
+        {
+            out.append("  on ");
+            appendTokens(decision.lookahead);
+            out.append(": ");
+            appendProduction(decision.production);
+            out.append('\n');
+        }
+    }
+
+    // The decision table: one row per resolved cell, one entry per lookahead sequence.
+    size_t resolved = 0;
+    for (const LookaheadCell &cell : cells)
+        resolved += cell.verdict == LookaheadVerdict::Resolved;
+    if (resolved > 0)
+    {
+        out.append("\nLL(k) decision table (non-terminal [lookahead] production):\n");
+        for (const LookaheadCell &cell : cells)
+        {
+            if (cell.verdict != LookaheadVerdict::Resolved)
+                continue;
+            for (const LookaheadDecision &decision : cell.decisions)
+            {
+                out.append(symbols.name(cell.nonTerminal));
+                out.append(" [");
+                appendTokens(decision.lookahead);
+                out.append("] ");
+                out.appendNumber(decision.production);
+                out.append('\n');
+            }
+        }
+    }
+    return out.flush();
+}
+
+#endif
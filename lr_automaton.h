@@ -0,0 +1,374 @@
+#ifndef LR_AUTOMATON_H
+#define LR_AUTOMATON_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+#include "first_follow.h"
+
+/* LR(0) automaton and LALR(1) lookaheads over the same Grammar IR the LL(1) phases use.
+
+   The grammar is augmented with S' -> S without touching the symbol table: S' is production
+   number productionCount() and has no SymbolId. An item (production p, dot d) is the id
+   itemBase(p) + d, so items of one production are consecutive and advancing the dot is +1.
+   A state is identified by its kernel, the sorted list of its non-closure items. Kernels are
+   deduplicated through an open-addressing hash table. States are numbered in the
+   breadth-first order they are discovered from S' -> . S, following transitions in SymbolId
+   order, so the automaton only depends on the grammar.
+*/
+class LR0Automaton
+{
+public:
+    struct Transition
+    {
+        SymbolId symbol;
+        uint32_t target;
+    };
+
+    LR0Automaton(const Grammar &grammar, const SymbolTable &symbols,
+                 std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : grammar(grammar), symbols(symbols)
+    {
+        size_t productions = grammar.productionCount();
+        itemStart.resize(productions + 2);
+        for (size_t p = 0; p <= productions; p++)
+            itemStart[p + 1] = itemStart[p] + static_cast<uint32_t>(length(p)) + 1;
+        itemProduction.resize(itemStart.back());
+        for (size_t p = 0; p <= productions; p++)
+            std::fill(itemProduction.begin() + itemStart[p], itemProduction.begin() + itemStart[p + 1],
+                      static_cast<uint32_t>(p));
+        build(scratch);
+    }
+
+    size_t stateCount() const { return kernelStart.size() - 1; }
+    size_t transitionCount() const { return transitions.size(); }
+
+    // The augmented production S' -> S.
+    uint32_t startProduction() const { return static_cast<uint32_t>(grammar.productionCount()); }
+    size_t length(size_t p) const { return p == grammar.productionCount() ? 1 : grammar.rhs(p).size(); }
+    SymbolId lhs(size_t p) const { return p == grammar.productionCount() ? NO_SYMBOL : grammar.prodLhs[p]; }
+    SymbolId symbolAt(size_t p, size_t i) const
+    {
+        return p == grammar.productionCount() ? grammar.startSymbol : grammar.rhs(p)[i];
+    }
+
+    uint32_t itemBase(size_t p) const { return itemStart[p]; }
+    uint32_t production(uint32_t item) const { return itemProduction[item]; }
+    uint32_t dot(uint32_t item) const { return item - itemStart[itemProduction[item]]; }
+    // The symbol after the dot, or NO_SYMBOL for a completed item.
+    SymbolId next(uint32_t item) const
+    {
+        uint32_t p = itemProduction[item];
+        uint32_t d = item - itemStart[p];
+        return d < length(p) ? symbolAt(p, d) : NO_SYMBOL;
+    }
+
+    const uint32_t *kernelBegin(size_t state) const { return kernelItems.data() + kernelStart[state]; }
+    const uint32_t *kernelEnd(size_t state) const { return kernelItems.data() + kernelStart[state + 1]; }
+
+    const Transition *transitionsBegin(size_t state) const { return transitions.data() + transitionStart[state]; }
+    const Transition *transitionsEnd(size_t state) const { return transitions.data() + transitionStart[state + 1]; }
+    uint32_t transitionIndex(const Transition *t) const { return static_cast<uint32_t>(t - transitions.data()); }
+    const Transition &transitionAt(uint32_t index) const { return transitions[index]; }
+
+    // Transition of state on symbol, or nullptr.
+    const Transition *transition(size_t state, SymbolId symbol) const
+    {
+        const Transition *end = transitionsEnd(state);
+        const Transition *t = std::lower_bound(transitionsBegin(state), end, symbol,
+                                               [](const Transition &a, SymbolId s) { return a.symbol < s; });
+        return t != end && t->symbol == symbol ? t : nullptr;
+    }
+
+    /* Productions reduced in a state: its completed kernel items and the ε-productions of its
+       closure, in increasing production order. Entry r of the whole list is reduction r; the
+       lookahead sets are indexed the same way. */
+    size_t reductionCount() const { return reduceProductions.size(); }
+    uint32_t reductionsBegin(size_t state) const { return reduceStart[state]; }
+    uint32_t reductionsEnd(size_t state) const { return reduceStart[state + 1]; }
+    uint32_t reducedProduction(uint32_t reduction) const { return reduceProductions[reduction]; }
+
+    // Whether state holds S' -> S . and so accepts on $.
+    bool accepts(size_t state) const
+    {
+        return std::binary_search(kernelBegin(state), kernelEnd(state), itemBase(startProduction()) + 1);
+    }
+
+private:
+    const Grammar &grammar;
+    const SymbolTable &symbols;
+    std::vector<uint32_t> itemStart;        // first item of each production, augmented one included
+    std::vector<uint32_t> itemProduction;   // indexed by item
+    std::vector<uint32_t> kernelStart;
+    std::vector<uint32_t> kernelItems;
+    std::vector<uint32_t> transitionStart;
+    std::vector<Transition> transitions;
+    std::vector<uint32_t> reduceStart;
+    std::vector<uint32_t> reduceProductions;
+
+    static uint64_t hashKernel(const uint32_t *begin, const uint32_t *end)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (const uint32_t *item = begin; item != end; item++)
+            hash = (hash ^ *item) * 1099511628211ULL;
+        return hash ^ (hash >> 29);
+    }
+
+    void build(std::pmr::memory_resource *scratch)
+    {
+        const int32_t EMPTY_SLOT = -1;
+        std::pmr::vector<int32_t> slots(1024, EMPTY_SLOT, scratch);   // state ids, open addressing
+        std::pmr::vector<uint64_t> stateHash(scratch);
+
+        // Returns the state whose kernel is [begin, end), adding it if it is new.
+        auto stateOf = [&](const uint32_t *begin, const uint32_t *end) {
+            uint64_t hash = hashKernel(begin, end);
+            size_t mask = slots.size() - 1;
+            for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                int32_t s = slots[slot];
+                if (s == EMPTY_SLOT)
+                {
+                    s = static_cast<int32_t>(stateCount());
+                    kernelItems.insert(kernelItems.end(), begin, end);
+                    kernelStart.push_back(static_cast<uint32_t>(kernelItems.size()));
+                    stateHash.push_back(hash);
+                    slots[slot] = s;
+                    if (stateHash.size() * 2 > slots.size())
+                    {
+                        // Rehash at half load.
+                        slots.assign(slots.size() * 2, EMPTY_SLOT);
+                        size_t grownMask = slots.size() - 1;
+                        for (size_t t = 0; t < stateHash.size(); t++)
+                        {
+                            size_t k = stateHash[t] & grownMask;
+                            while (slots[k] != EMPTY_SLOT)
+                                k = (k + 1) & grownMask;
+                            slots[k] = static_cast<int32_t>(t);
+                        }
+                    }
+                    return static_cast<uint32_t>(s);
+                }
+                if (stateHash[s] == hash &&
+                    std::equal(begin, end, kernelBegin(s), kernelEnd(s)))
+                    return static_cast<uint32_t>(s);
+            }
+        };
+
+        kernelStart.assign(1, 0);
+        transitionStart.assign(1, 0);
+        reduceStart.assign(1, 0);
+        uint32_t startItem = itemBase(startProduction());
+        stateOf(&startItem, &startItem + 1);
+
+        std::pmr::vector<uint32_t> closedIn(symbols.size(), UINT32_MAX, scratch);   // last state that closed over nt
+        std::pmr::vector<SymbolId> pending(scratch);
+        std::pmr::vector<uint32_t> closure(scratch);
+        std::pmr::vector<std::pair<SymbolId, uint32_t>> moves(scratch);   // (symbol, advanced item)
+        std::pmr::vector<uint32_t> kernel(scratch);
+        for (uint32_t state = 0; state < stateCount(); state++)
+        {
+            closure.assign(kernelBegin(state), kernelEnd(state));
+            auto reach = [&](SymbolId sym) {
+                if (sym == NO_SYMBOL || !symbols.isNonTerminal(sym) || closedIn[sym] == state)
+                    return;
+                closedIn[sym] = state;
+                pending.push_back(sym);
+            };
+            for (uint32_t item : closure)
+                reach(next(item));
+            while (!pending.empty())
+            {
+                SymbolId nt = pending.back();
+                pending.pop_back();
+                for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                {
+                    closure.push_back(itemBase(p));
+                    reach(next(itemBase(p)));
+                }
+            }
+
+            moves.clear();
+            size_t firstReduction = reduceProductions.size();
+            for (uint32_t item : closure)
+            {
+                SymbolId sym = next(item);
+                if (sym != NO_SYMBOL)
+                    moves.emplace_back(sym, item + 1);
+                else if (production(item) != startProduction())
+                    reduceProductions.push_back(production(item));
+            }
+            std::sort(reduceProductions.begin() + firstReduction, reduceProductions.end());
+            reduceStart.push_back(static_cast<uint32_t>(reduceProductions.size()));
+
+            std::sort(moves.begin(), moves.end());
+            for (size_t i = 0; i < moves.size();)
+            {
+                SymbolId sym = moves[i].first;
+                kernel.clear();
+                for (; i < moves.size() && moves[i].first == sym; i++)
+                    kernel.push_back(moves[i].second);
+                uint32_t target = stateOf(kernel.data(), kernel.data() + kernel.size());
+                transitions.push_back(Transition{sym, target});
+            }
+            transitionStart.push_back(static_cast<uint32_t>(transitions.size()));
+        }
+    }
+};
+
+/* LALR(1) lookaheads by DeRemer and Pennello's relations over the non-terminal transitions
+   (p, A) of the LR(0) automaton:
+     DR(p, A)    terminals shifted right after goto(p, A), plus $ after (0, S);
+     reads       (p, A) reads (r, C) if goto(p, A) = r and goto(r, C) exists for a nullable C;
+     includes    (p, A) includes (p', B) if B -> β A γ, γ is nullable and p' reaches p over β;
+     lookback    reduction of A -> ω in q looks back at (p, A) if p reaches q over ω.
+   Read = DR closed over reads, Follow = Read closed over includes, and the lookahead of a
+   reduction is the union of Follow over its lookbacks. Both closures take the strongly
+   connected components of their relation and are unioned component by component, since
+   every member of a component has the same set. */
+inline TerminalSets lalrLookaheads(const LR0Automaton &automaton, const Grammar &grammar, const SymbolTable &symbols,
+                                   const TerminalIndex &terminals, const NullableSet &nullable,
+                                   std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+
+    // Number the non-terminal transitions.
+    std::pmr::vector<int32_t> gotoOf(automaton.transitionCount(), -1, scratch);   // transition -> node
+    std::pmr::vector<uint32_t> nodeState(scratch);
+    std::pmr::vector<uint32_t> nodeTransition(scratch);
+    for (uint32_t state = 0; state < automaton.stateCount(); state++)
+    {
+        for (const auto *t = automaton.transitionsBegin(state); t != automaton.transitionsEnd(state); t++)
+        {
+            if (!symbols.isNonTerminal(t->symbol))
+                continue;
+            gotoOf[automaton.transitionIndex(t)] = static_cast<int32_t>(nodeState.size());
+            nodeState.push_back(state);
+            nodeTransition.push_back(automaton.transitionIndex(t));
+        }
+    }
+    size_t nodes = nodeState.size();
+    auto nodeOf = [&](uint32_t state, SymbolId nt) {
+        return gotoOf[automaton.transitionIndex(automaton.transition(state, nt))];
+    };
+
+    // DR and reads.
+    TerminalSets sets(nodes, TerminalSet(terminals.size()));
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> reads(scratch);
+    for (size_t x = 0; x < nodes; x++)
+    {
+        const LR0Automaton::Transition &t = automaton.transitionAt(nodeTransition[x]);
+        uint32_t r = t.target;
+        if (nodeState[x] == 0 && t.symbol == grammar.startSymbol)
+            sets[x].insert(terminals.denseOf[END_MARKER]);
+        for (const auto *u = automaton.transitionsBegin(r); u != automaton.transitionsEnd(r); u++)
+        {
+            if (!symbols.isNonTerminal(u->symbol))
+                sets[x].insert(terminals.denseOf[u->symbol]);
+            else if (nullable.test(u->symbol))
+                reads.emplace_back(static_cast<SymbolId>(x), gotoOf[automaton.transitionIndex(u)]);
+        }
+    }
+
+    // includes and lookback, by walking every production of B from p' for each node (p', B).
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> includes(scratch);
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> lookback(scratch);   // (reduction, node)
+    for (size_t y = 0; y < nodes; y++)
+    {
+        uint32_t origin = nodeState[y];
+        SymbolId B = automaton.transitionAt(nodeTransition[y]).symbol;
+        for (uint32_t p = grammar.firstProduction(B); p < grammar.endProduction(B); p++)
+        {
+            SymbolSpan rhs = grammar.rhs(p);
+            size_t nullableFrom = rhs.size();   // rhs[nullableFrom..] is all nullable
+            while (nullableFrom > 0 && nullable.test(rhs[nullableFrom - 1]))
+                nullableFrom--;
+            uint32_t q = origin;
+            for (size_t i = 0; i < rhs.size(); i++)
+            {
+                if (symbols.isNonTerminal(rhs[i]) && i + 1 >= nullableFrom)
+                    includes.emplace_back(nodeOf(q, rhs[i]), static_cast<SymbolId>(y));
+                q = automaton.transition(q, rhs[i])->target;
+            }
+            for (uint32_t r = automaton.reductionsBegin(q); r < automaton.reductionsEnd(q); r++)
+            {
+                if (automaton.reducedProduction(r) == p)
+                {
+                    lookback.emplace_back(r, static_cast<uint32_t>(y));
+                    break;
+                }
+            }
+        }
+    }
+
+    // Closes sets over relation: afterwards sets[x] also holds sets[y] for every x -> y path.
+    auto closeOver = [&](const std::pmr::vector<std::pair<SymbolId, SymbolId>> &relation) {
+        std::pmr::vector<uint32_t> offsets(scratch);
+        std::pmr::vector<SymbolId> targets(scratch);
+        buildAdjacency(relation, nodes, offsets, targets);
+        std::vector<SymbolId> roots(nodes);
+        for (size_t x = 0; x < nodes; x++)
+            roots[x] = static_cast<SymbolId>(x);
+        std::pmr::vector<uint32_t> component(scratch);
+        uint32_t count = stronglyConnectedComponents(offsets, targets, roots, component, scratch);
+        // Components only point at smaller numbers, so ascending order sees every target final.
+        std::pmr::vector<uint32_t> memberStart(count + 1, 0, scratch);
+        for (size_t x = 0; x < nodes; x++)
+            memberStart[component[x] + 1]++;
+        for (uint32_t c = 0; c < count; c++)
+            memberStart[c + 1] += memberStart[c];
+        std::pmr::vector<SymbolId> members(nodes, 0, scratch);
+        std::pmr::vector<uint32_t> fill(memberStart.begin(), memberStart.end() - 1, scratch);
+        for (size_t x = 0; x < nodes; x++)
+            members[fill[component[x]]++] = static_cast<SymbolId>(x);
+        for (uint32_t c = 0; c < count; c++)
+        {
+            SymbolId head = members[memberStart[c]];
+            TerminalSet merged = sets[head];
+            for (uint32_t m = memberStart[c]; m < memberStart[c + 1]; m++)
+            {
+                SymbolId x = members[m];
+                merged.unionWith(sets[x]);
+                for (uint32_t e = offsets[x]; e < offsets[x + 1]; e++)
+                    if (component[targets[e]] != c)
+                        merged.unionWith(sets[targets[e]]);
+            }
+            for (uint32_t m = memberStart[c]; m < memberStart[c + 1]; m++)
+                sets[members[m]] = merged;
+        }
+    };
+    closeOver(reads);
+    closeOver(includes);
+
+    TerminalSets lookaheads(automaton.reductionCount(), TerminalSet(terminals.size()));
+    for (const auto &edge : lookback)
+        lookaheads[edge.first].unionWith(sets[edge.second]);
+    return lookaheads;
+}
+
+// LR(0) lookaheads: a reduction happens on every terminal, $ included.
+inline TerminalSets lr0Lookaheads(const LR0Automaton &automaton, const TerminalIndex &terminals)
+{
+    TerminalSet all(terminals.size());
+    for (size_t t = 0; t < terminals.size(); t++)
+        if (t != EPSILON_BIT)
+            all.insert(t);
+    return TerminalSets(automaton.reductionCount(), all);
+}
+
+// SLR(1) lookaheads: a reduction of A -> ω happens on FOLLOW(A).
+inline TerminalSets slrLookaheads(const LR0Automaton &automaton, const TerminalSets &follow)
+{
+    TerminalSets lookaheads;
+    lookaheads.reserve(automaton.reductionCount());
+    for (uint32_t r = 0; r < automaton.reductionCount(); r++)
+        lookaheads.push_back(follow[automaton.lhs(automaton.reducedProduction(r))]);
+    return lookaheads;
+}
+
+#endif
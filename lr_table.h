@@ -0,0 +1,424 @@
+#ifndef LR_TABLE_H
+#define LR_TABLE_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "lr_automaton.h"
+#include "output_writer.h"
+
+/* Row-displacement ("comb") packing of a sparse [row x column] table. Each distinct row
+   is placed at an offset base[row] into one shared value array, at the first offset where
+   its entries land only on free slots. check[] records which row owns each slot. A lookup
+   that hits a slot owned by another row is an empty cell. Identical rows are stored
+   once, and rows are placed densest-first so the sparse ones fill the gaps.
+*/
+class PackedTable
+{
+public:
+    static constexpr uint32_t EMPTY = 0;
+
+    // cells is row-major [rows x columns], EMPTY for no entry.
+    void pack(const std::vector<uint32_t> &cells, size_t rows, size_t columns)
+    {
+        columnCount = columns;
+        base.assign(rows, 0);
+        owner.assign(rows, 0);
+        value.clear();
+        check.clear();
+
+        // Identical rows share one placement; owner[] is the first row with the same cells.
+        const uint32_t NONE = UINT32_MAX;
+        FlatHashMap<uint64_t, uint32_t> byHash;   // latest distinct row with that hash
+        std::vector<uint32_t> sameHash(rows, NONE);   // the distinct row before it with the same hash
+        std::vector<uint32_t> distinct;
+        byHash.reserve(rows);
+        for (size_t r = 0; r < rows; r++)
+        {
+            const uint32_t *row = cells.data() + r * columns;
+            uint64_t hash = 1469598103934665603ULL;
+            for (size_t c = 0; c < columns; c++)
+                hash = (hash ^ row[c]) * 1099511628211ULL;
+            uint32_t *latest = byHash.find(hash);
+            owner[r] = static_cast<uint32_t>(r);
+            for (uint32_t other = latest ? *latest : NONE; other != NONE; other = sameHash[other])
+            {
+                if (std::equal(row, row + columns, cells.data() + other * columns))
+                {
+                    owner[r] = other;
+                    break;
+                }
+            }
+            if (owner[r] == r)
+            {
+                sameHash[r] = latest ? *latest : NONE;
+                byHash[hash] = static_cast<uint32_t>(r);
+                distinct.push_back(static_cast<uint32_t>(r));
+            }
+        }
+
+        std::vector<std::vector<uint32_t>> entries(rows);   // columns of the non-empty cells
+        for (uint32_t r : distinct)
+            for (size_t c = 0; c < columns; c++)
+                if (cells[r * columns + c] != EMPTY)
+                    entries[r].push_back(static_cast<uint32_t>(c));
+        std::stable_sort(distinct.begin(), distinct.end(),
+                         [&](uint32_t a, uint32_t b) { return entries[a].size() > entries[b].size(); });
+
+        // nextFree[i] leads to the first free slot at or after i (path-compressed), so the
+        // search only tries offsets that put a row's first entry on a free slot.
+        std::vector<uint32_t> nextFree;
+        auto findFree = [&](size_t slot) {
+            size_t root = slot;
+            while (root < nextFree.size() && nextFree[root] != root)
+                root = nextFree[root];
+            while (slot < nextFree.size() && nextFree[slot] != slot)
+            {
+                size_t following = nextFree[slot];
+                nextFree[slot] = static_cast<uint32_t>(root);
+                slot = following;
+            }
+            return root;
+        };
+        auto isFree = [&](size_t slot) { return slot >= nextFree.size() || nextFree[slot] == slot; };
+        for (uint32_t r : distinct)
+        {
+            const std::vector<uint32_t> &row = entries[r];
+            if (row.empty())
+                continue;
+            size_t offset = 0;
+            for (size_t slot = findFree(row[0]);; slot = findFree(slot + 1))
+            {
+                offset = slot - row[0];
+                bool fits = true;
+                for (size_t e = 1; e < row.size() && fits; e++)
+                    fits = isFree(offset + row[e]);
+                if (fits)
+                    break;
+            }
+            size_t end = offset + row.back() + 1;
+            if (end > value.size())
+            {
+                size_t grown = nextFree.size();
+                nextFree.resize(end);
+                std::iota(nextFree.begin() + grown, nextFree.end(), static_cast<uint32_t>(grown));
+                value.resize(end, EMPTY);
+                check.resize(end, NO_ROW);
+            }
+            for (uint32_t c : row)
+            {
+                nextFree[offset + c] = static_cast<uint32_t>(offset + c + 1);
+                value[offset + c] = cells[r * columns + c];
+                check[offset + c] = r;
+            }
+            base[r] = static_cast<uint32_t>(offset);
+        }
+        for (size_t r = 0; r < rows; r++)
+            base[r] = base[owner[r]];
+    }
+
+    uint32_t at(size_t row, size_t column) const
+    {
+        size_t slot = static_cast<size_t>(base[row]) + column;
+        return slot < check.size() && check[slot] == owner[row] ? value[slot] : EMPTY;
+    }
+
+    size_t rowCount() const { return base.size(); }
+    size_t columns() const { return columnCount; }
+    size_t slots() const { return value.size(); }
+    // Bytes of the packed form: bases and owners per row, a value and a check per slot.
+    size_t bytes() const { return (base.size() + owner.size() + value.size() + check.size()) * sizeof(uint32_t); }
+
+private:
+    static constexpr uint32_t NO_ROW = UINT32_MAX;
+    size_t columnCount = 0;
+    std::vector<uint32_t> base;
+    std::vector<uint32_t> owner;
+    std::vector<uint32_t> value;
+    std::vector<uint32_t> check;
+};
+
+enum class LrMethod
+{
+    None,
+    LR0,
+    SLR1,
+    LALR1
+};
+
+inline const char *lrMethodName(LrMethod method)
+{
+    switch (method)
+    {
+    case LrMethod::LR0:
+        return "LR(0)";
+    case LrMethod::SLR1:
+        return "SLR(1)";
+    case LrMethod::LALR1:
+        return "LALR(1)";
+    default:
+        return "none";
+    }
+}
+
+// An ACTION cell claimed twice. The kept action is what the table holds: shift over reduce,
+// and the earlier production of two reductions, as yacc resolves them.
+struct LrConflict
+{
+    uint32_t state;
+    SymbolId terminal;
+    uint32_t kept;       // LrTable action codes
+    uint32_t rejected;
+};
+
+/* ACTION and GOTO tables of an LR automaton, row-displacement packed. Actions are encoded as
+   (argument << 2) | kind with kind 1 = shift (argument: state), 2 = reduce (production),
+   3 = accept; 0 is an error. ACTION columns are the dense terminal indices of the
+   TerminalIndex the table was built with, and GOTO columns are the positions of the
+   non-terminals in grammar.nonTerminals.
+
+   As in yacc, every GOTO column has a default, its most common target; only the cells that
+   differ from it are packed. A parser only asks for GOTO(state, A) right after reducing to
+   A, when the cell is never empty, so the GOTO table need not tell empty cells apart.
+*/
+class LrTable
+{
+public:
+    enum Kind : uint32_t
+    {
+        ERROR = 0,
+        SHIFT = 1,
+        REDUCE = 2,
+        ACCEPT = 3
+    };
+
+    static uint32_t encode(Kind kind, uint32_t argument) { return (argument << 2) | kind; }
+    static Kind kind(uint32_t action) { return static_cast<Kind>(action & 3); }
+    static uint32_t argument(uint32_t action) { return action >> 2; }
+
+    /* lookaheads[r] are the terminals reduction r of the automaton reduces on (all of them for
+       LR(0)). */
+    LrTable(const LR0Automaton &automaton, const Grammar &grammar, const SymbolTable &symbols,
+            const TerminalIndex &terminals, const TerminalSets &lookaheads)
+        : states(automaton.stateCount())
+    {
+        size_t columns = terminals.size();
+        std::vector<uint32_t> action(states * columns, ERROR);
+        auto claim = [&](uint32_t state, size_t column, uint32_t code) {
+            uint32_t &cell = action[state * columns + column];
+            if (cell == ERROR || cell == code)
+            {
+                cell = code;
+                return;
+            }
+            // Reductions arrive in production order after the shifts, so the cell keeps its action.
+            conflicts.push_back(LrConflict{state, terminals.symbolOf[column], cell, code});
+            if (kind(code) == SHIFT && kind(cell) == REDUCE)
+                std::swap(cell, conflicts.back().rejected);
+        };
+
+        size_t ntColumns = grammar.nonTerminals.size();
+        ntColumn.assign(symbols.size(), -1);
+        for (size_t i = 0; i < ntColumns; i++)
+            ntColumn[grammar.nonTerminals[i]] = static_cast<int32_t>(i);
+        std::vector<std::pair<uint32_t, uint32_t>> gotoCells;   // (column, target + 1)
+        for (uint32_t s = 0; s < states; s++)
+        {
+            for (const auto *t = automaton.transitionsBegin(s); t != automaton.transitionsEnd(s); t++)
+            {
+                if (symbols.isNonTerminal(t->symbol))
+                    gotoCells.emplace_back(ntColumn[t->symbol], t->target + 1);
+                else
+                    claim(s, terminals.denseOf[t->symbol], encode(SHIFT, t->target));
+            }
+            if (automaton.accepts(s))
+                claim(s, terminals.denseOf[END_MARKER], encode(ACCEPT, 0));
+            for (uint32_t r = automaton.reductionsBegin(s); r < automaton.reductionsEnd(s); r++)
+            {
+                uint32_t code = encode(REDUCE, automaton.reducedProduction(r));
+                lookaheads[r].forEach([&](size_t column) {
+                    if (column != EPSILON_BIT)
+                        claim(s, column, code);
+                });
+            }
+        }
+        actions.pack(action, states, columns);
+
+        // The most common target of each column becomes its default; ties go to the lower state.
+        std::sort(gotoCells.begin(), gotoCells.end());
+        gotoDefault.assign(ntColumns, PackedTable::EMPTY);
+        std::vector<size_t> defaultCount(ntColumns, 0);
+        for (size_t i = 0, run; i < gotoCells.size(); i += run)
+        {
+            for (run = 1; i + run < gotoCells.size() && gotoCells[i + run] == gotoCells[i]; run++)
+                ;
+            if (run > defaultCount[gotoCells[i].first])
+            {
+                defaultCount[gotoCells[i].first] = run;
+                gotoDefault[gotoCells[i].first] = gotoCells[i].second;
+            }
+        }
+        std::vector<uint32_t> gotos(states * ntColumns, PackedTable::EMPTY);
+        for (uint32_t s = 0; s < states; s++)
+        {
+            for (const auto *t = automaton.transitionsBegin(s); t != automaton.transitionsEnd(s); t++)
+            {
+                if (!symbols.isNonTerminal(t->symbol))
+                    continue;
+                int32_t column = ntColumn[t->symbol];
+                if (t->target + 1 != gotoDefault[column])
+                    gotos[s * ntColumns + column] = t->target + 1;
+            }
+        }
+        gotoTable.pack(gotos, states, ntColumns);
+    }
+
+    size_t stateCount() const { return states; }
+
+    uint32_t actionAt(size_t state, size_t terminalColumn) const { return actions.at(state, terminalColumn); }
+
+    // Target of the GOTO on nt from state. Only defined where the automaton has that
+    // transition; elsewhere it is the column default, or -1 for a column without one.
+    int32_t gotoAt(size_t state, SymbolId nt) const
+    {
+        size_t column = static_cast<size_t>(ntColumn[nt]);
+        uint32_t cell = gotoTable.at(state, column);
+        return static_cast<int32_t>(cell != PackedTable::EMPTY ? cell : gotoDefault[column]) - 1;
+    }
+
+    const PackedTable &packedActions() const { return actions; }
+    const PackedTable &packedGotos() const { return gotoTable; }
+    // Bytes of the GOTO table: the packed exceptions and the column defaults.
+    size_t gotoBytes() const { return gotoTable.bytes() + gotoDefault.size() * sizeof(uint32_t); }
+
+    std::vector<LrConflict> conflicts;
+
+private:
+    size_t states;
+    std::vector<int32_t> ntColumn;   // indexed by SymbolId
+    PackedTable actions;
+    PackedTable gotoTable;
+    std::vector<uint32_t> gotoDefault;   // per GOTO column: target + 1, EMPTY if none
+};
+
+/* Writes the automaton and its table for --lr-output: per state its kernel items, then its
+   actions by terminal name, its gotos by non-terminal name and the conflicts recorded in it.
+   Every entry is read back from the packed tables.
+   The augmented start symbol is printed as the start symbol's name with a ' appended, more
+   than one if that name is taken. */
+inline bool writeLrTable(FILE *file, LrMethod method, const LR0Automaton &automaton, const LrTable &table,
+                         const Grammar &grammar, const SymbolTable &symbols, const TerminalIndex &terminals)
+{
+    std::string augmented = symbols.name(grammar.startSymbol) + "'";
+    while (symbols.lookup(augmented) != NO_SYMBOL)
+        augmented += "'";
+    auto lhsName = [&](uint32_t p) -> const std::string & {
+        return p == automaton.startProduction() ? augmented : symbols.name(automaton.lhs(p));
+    };
+
+    std::vector<size_t> columns(terminals.size());
+    for (size_t c = 0; c < columns.size(); c++)
+        columns[c] = c;
+    std::sort(columns.begin(), columns.end(), [&](size_t a, size_t b) {
+        return symbols.name(terminals.symbolOf[a]) < symbols.name(terminals.symbolOf[b]);
+    });
+    std::vector<SymbolId> nonTerminals = sortedByName(grammar.nonTerminals, symbols);
+
+    OutputBuffer out(file);
+    auto appendAction = [&](uint32_t action) {
+        switch (LrTable::kind(action))
+        {
+        case LrTable::SHIFT:
+            out.append("shift ");
+            out.appendNumber(LrTable::argument(action));
+            break;
+        case LrTable::REDUCE:
+        {
+            uint32_t p = LrTable::argument(action);
+            out.append("reduce ");
+            out.append(lhsName(p));
+            out.append(" -> ");
+            out.append(renderProduction(grammar.rhs(p), symbols));
+            break;
+        }
+        case LrTable::ACCEPT:
+            out.append("accept");
+            break;
+        default:
+            out.append("error");
+        }
+    };
+
+    out.append(lrMethodName(method));
+    out.append(" automaton: ");
+    out.appendNumber(automaton.stateCount());
+    out.append(" states, ");
+    out.appendNumber(table.conflicts.size());
+    out.append(" conflicts\n");
+    size_t nextConflict = 0;
+    for (uint32_t s = 0; s < automaton.stateCount(); s++)
+    {
+        out.append("\nState ");
+        out.appendNumber(s);
+        out.append(":\n");
+        for (const uint32_t *item = automaton.kernelBegin(s); item != automaton.kernelEnd(s); item++)
+        {
+            uint32_t p = automaton.production(*item);
+            uint32_t dot = automaton.dot(*item);
+            out.append("  ");
+            out.append(lhsName(p));
+            out.append(" ->");
+            for (uint32_t i = 0; i <= automaton.length(p); i++)
+            {
+                if (i == dot)
+                    out.append(" .");
+                if (i < automaton.length(p))
+                {
+                    out.append(' ');
+                    out.append(symbols.name(automaton.symbolAt(p, i)));
+                }
+            }
+            out.append('\n');
+        }
+        for (size_t c : columns)
+        {
+            uint32_t action = table.actionAt(s, c);
+            if (action == LrTable::ERROR)
+                continue;
+            out.append("  on ");
+            out.append(symbols.name(terminals.symbolOf[c]));
+            out.append(": ");
+            appendAction(action);
+            out.append('\n');
+        }
+        for (SymbolId nt : nonTerminals)
+        {
+            if (!automaton.transition(s, nt))
+                continue;
+            out.append("  goto ");
+            out.append(symbols.name(nt));
+            out.append(": ");
+            out.appendNumber(static_cast<uint64_t>(table.gotoAt(s, nt)));
+            out.append('\n');
+        }
+        for (; nextConflict < table.conflicts.size() && table.conflicts[nextConflict].state == s; nextConflict++)
+        {
+            const LrConflict &conflict = table.conflicts[nextConflict];
+            out.append("  conflict on ");
+            out.append(symbols.name(conflict.terminal));
+            out.append(": ");
+            appendAction(conflict.kept);
+            out.append(" over ");
+            appendAction(conflict.rejected);
+            out.append('\n');
+        }
+    }
+    return out.flush();
+}
+
+#endif
@@ -0,0 +1,750 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "ll1_table.h"
+#include "analysis.h"
+
+/* Output stage: writes an AnalysisResult in one of several formats through a single large
+   buffer that goes to the file with fwrite, so no per-cell stream formatting is involved.
+
+     text    the classic output.txt layout (fixed 20-character table columns)
+     sparse  like text, but the table lists only its non-empty cells, one per line
+     csv     one row per grammar rule, set member and table cell
+     json    one object with a key per section
+     binary  symbol table plus length-prefixed sections of raw 32-bit ids (see writeBinary)
+
+   Every section can be switched off; conflicts are written with the table.
+*/
+
+enum class OutputFormat
+{
+    Text,
+    Sparse,
+    Csv,
+    Json,
+    Binary
+};
+
+struct OutputSections
+{
+    bool factoredGrammar = true;
+    bool finalGrammar = true;
+    bool firstSets = true;
+    bool followSets = true;
+    bool table = true;
+};
+
+inline bool parseOutputFormat(const std::string &name, OutputFormat &format)
+{
+    static const std::pair<const char *, OutputFormat> names[] = {
+        {"text", OutputFormat::Text}, {"sparse", OutputFormat::Sparse}, {"csv", OutputFormat::Csv},
+        {"json", OutputFormat::Json}, {"binary", OutputFormat::Binary}};
+    for (const auto &entry : names)
+    {
+        if (name == entry.first)
+        {
+            format = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses a comma-separated list of factored, final, first, follow, table (or "all" / "none").
+inline bool parseOutputSections(const std::string &list, OutputSections &sections)
+{
+    sections = OutputSections{false, false, false, false, false};
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t end = std::min(list.find(',', pos), list.size());
+        std::string name = list.substr(pos, end - pos);
+        pos = end + 1;
+        if (name == "factored")
+            sections.factoredGrammar = true;
+        else if (name == "final")
+            sections.finalGrammar = true;
+        else if (name == "first")
+            sections.firstSets = true;
+        else if (name == "follow")
+            sections.followSets = true;
+        else if (name == "table")
+            sections.table = true;
+        else if (name == "all")
+            sections = OutputSections();
+        else if (name != "none" && !name.empty())
+            return false;
+    }
+    return true;
+}
+
+/* Append-only byte buffer that spills to a FILE in large blocks. */
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(FILE *file, size_t capacity = 1 << 20) : file(file), capacity(capacity)
+    {
+        data.reserve(capacity);
+    }
+    ~OutputBuffer() { flush(); }
+
+    void append(std::string_view text)
+    {
+        if (data.size() + text.size() > capacity)
+            flush();
+        if (text.size() > capacity)
+        {
+            ok = ok && std::fwrite(text.data(), 1, text.size(), file) == text.size();
+            return;
+        }
+        data.insert(data.end(), text.begin(), text.end());
+    }
+
+    void append(char c)
+    {
+        if (data.size() + 1 > capacity)
+            flush();
+        data.push_back(c);
+    }
+
+    // Right-aligns text in width bytes, like std::setw does for a narrow stream.
+    void appendPadded(std::string_view text, size_t width)
+    {
+        if (text.size() < width)
+            appendRepeated(' ', width - text.size());
+        append(text);
+    }
+
+    void appendRepeated(char c, size_t count)
+    {
+        for (; count > 0; count--)
+            append(c);
+    }
+
+    void appendNumber(uint64_t value)
+    {
+        char digits[20];
+        size_t n = 0;
+        do
+        {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (n > 0)
+            append(digits[--n]);
+    }
+
+    void appendRaw(const void *bytes, size_t size)
+    {
+        append(std::string_view(static_cast<const char *>(bytes), size));
+    }
+
+    template <typename T>
+    void appendValue(T value)
+    {
+        appendRaw(&value, sizeof(value));
+    }
+
+    bool flush()
+    {
+        if (!data.empty())
+            ok = ok && std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        data.clear();
+        return ok;
+    }
+
+private:
+    FILE *file;
+    size_t capacity;
+    std::vector<char> data;
+    bool ok = true;
+};
+
+class AnalysisWriter
+{
+public:
+    AnalysisWriter(const AnalysisResult &result, const OutputSections &sections)
+        : result(result), symbols(result.symbols), sections(sections)
+    {
+        // Set members and table columns are listed in name order; ranking the terminals once
+        // lets every set be sorted by integer compares.
+        const TerminalIndex &terminals = result.terminals;
+        std::vector<SymbolId> byName = sortedByName(terminals.symbolOf, symbols);
+        terminalRank.assign(terminals.size(), 0);
+        for (size_t i = 0; i < byName.size(); i++)
+            terminalRank[terminals.denseOf[byName[i]]] = static_cast<uint32_t>(i);
+    }
+
+    bool write(const std::string &path, OutputFormat format)
+    {
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = write(file, format);
+        return std::fclose(file) == 0 && written;
+    }
+
+    // Writes to an open stream, which is left open (and flushed only as far as fwrite goes).
+    bool write(FILE *file, OutputFormat format)
+    {
+        OutputBuffer out(file);
+        switch (format)
+        {
+        case OutputFormat::Text:
+        case OutputFormat::Sparse:
+            writeText(out, format == OutputFormat::Sparse);
+            break;
+        case OutputFormat::Csv:
+            writeCsv(out);
+            break;
+        case OutputFormat::Json:
+            writeJson(out);
+            break;
+        case OutputFormat::Binary:
+            writeBinary(out);
+            break;
+        }
+        return out.flush();
+    }
+
+private:
+    struct Cell
+    {
+        SymbolId nonTerminal;
+        SymbolId terminal;
+        int32_t production;
+    };
+
+    const AnalysisResult &result;
+    const SymbolTable &symbols;
+    OutputSections sections;
+    std::vector<uint32_t> terminalRank;       // indexed by dense terminal index
+    std::vector<std::string> renderedFinal;   // final-grammar productions, rendered on first use
+
+    const std::string &renderFinal(int32_t prod)
+    {
+        if (renderedFinal.empty())
+            renderedFinal.resize(result.finalGrammar.productionCount());
+        std::string &text = renderedFinal[prod];
+        if (text.empty())
+            text = renderProduction(result.finalGrammar.rhs(prod), symbols);
+        return text;
+    }
+
+    // Members of a set as SymbolIds in name order.
+    std::vector<SymbolId> members(const TerminalSet &set) const
+    {
+        std::vector<uint32_t> dense;
+        set.forEach([&](size_t bit) { dense.push_back(static_cast<uint32_t>(bit)); });
+        std::sort(dense.begin(), dense.end(), [&](uint32_t a, uint32_t b) { return terminalRank[a] < terminalRank[b]; });
+        std::vector<SymbolId> ids;
+        for (uint32_t bit : dense)
+            ids.push_back(result.terminals.symbolOf[bit]);
+        return ids;
+    }
+
+    // Members of sets[nt] in name order. FIRST sets leave ε out, so it is put back for a
+    // nullable non-terminal.
+    std::vector<SymbolId> setMembers(const TerminalSets &sets, SymbolId nt) const
+    {
+        if (&sets != &result.firstSets || !result.nullable.test(nt))
+            return members(sets[nt]);
+        TerminalSet withEpsilon = sets[nt];
+        withEpsilon.insert(EPSILON_BIT);
+        return members(withEpsilon);
+    }
+
+    // Non-empty table cells, rows and columns both in name order.
+    std::vector<Cell> filledCells(std::vector<SymbolId> *rowsOut = nullptr, std::vector<SymbolId> *columnsOut = nullptr) const
+    {
+        const LL1Table &table = result.parsingTable;
+        const TerminalIndex &terminals = result.terminals;
+        std::vector<bool> usedColumn(table.columnCount(), false);
+        std::vector<SymbolId> rows;
+        for (size_t r = 0; r < table.rowCount(); r++)
+        {
+            bool filled = false;
+            for (size_t c = 0; c < table.columnCount(); c++)
+            {
+                if (table.at(r, c) == LL1Table::EMPTY)
+                    continue;
+                usedColumn[c] = true;
+                filled = true;
+            }
+            if (filled)
+                rows.push_back(table.rowNonTerminal(r));
+        }
+        std::vector<uint32_t> denseColumns;
+        for (size_t c = 0; c < usedColumn.size(); c++)
+            if (usedColumn[c])
+                denseColumns.push_back(static_cast<uint32_t>(c));
+        std::sort(denseColumns.begin(), denseColumns.end(),
+                  [&](uint32_t a, uint32_t b) { return terminalRank[a] < terminalRank[b]; });
+        rows = sortedByName(rows, symbols);
+
+        std::vector<Cell> cells;
+        for (SymbolId nt : rows)
+        {
+            size_t row = static_cast<size_t>(table.row(nt));
+            for (uint32_t c : denseColumns)
+            {
+                int32_t prod = table.at(row, c);
+                if (prod != LL1Table::EMPTY)
+                    cells.push_back(Cell{nt, terminals.symbolOf[c], prod});
+            }
+        }
+        if (rowsOut)
+            *rowsOut = rows;
+        if (columnsOut)
+        {
+            columnsOut->clear();
+            for (uint32_t c : denseColumns)
+                columnsOut->push_back(terminals.symbolOf[c]);
+        }
+        return cells;
+    }
+
+    // --- text and sparse ---
+
+    void writeGrammarText(OutputBuffer &out, const Grammar &grammar)
+    {
+        for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+        {
+            out.append(symbols.name(nt));
+            out.append(" -> ");
+            for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+            {
+                if (p != grammar.firstProduction(nt))
+                    out.append(" | ");
+                if (&grammar == &result.finalGrammar)
+                    out.append(renderFinal(static_cast<int32_t>(p)));
+                else
+                    out.append(renderProduction(grammar.rhs(p), symbols));
+            }
+            out.append('\n');
+        }
+    }
+
+    void writeSetsText(OutputBuffer &out, std::string_view label, const TerminalSets &sets)
+    {
+        for (SymbolId nt : sortedByName(result.finalGrammar.nonTerminals, symbols))
+        {
+            out.append(label);
+            out.append('(');
+            out.append(symbols.name(nt));
+            out.append(") = { ");
+            bool firstElem = true;
+            for (SymbolId sym : setMembers(sets, nt))
+            {
+                if (!firstElem)
+                    out.append(", ");
+                out.append(symbols.name(sym));
+                firstElem = false;
+            }
+            out.append(" }\n");
+        }
+    }
+
+    void writeText(OutputBuffer &out, bool sparse)
+    {
+        // Sections after the first are separated by a blank line.
+        bool separate = false;
+        auto heading = [&](std::string_view title) {
+            if (separate)
+                out.append('\n');
+            out.append(title);
+            separate = true;
+        };
+        if (sections.factoredGrammar)
+        {
+            heading("Grammar after Left Factoring:\n");
+            writeGrammarText(out, result.factoredGrammar);
+        }
+        if (sections.finalGrammar)
+        {
+            heading("Grammar after Left Recursion Removal:\n");
+            writeGrammarText(out, result.finalGrammar);
+        }
+        if (sections.firstSets)
+        {
+            heading("FIRST Sets:\n");
+            writeSetsText(out, "FIRST", result.firstSets);
+        }
+        if (sections.followSets)
+        {
+            heading("FOLLOW Sets:\n");
+            writeSetsText(out, "FOLLOW", result.followSets);
+        }
+        if (!sections.table)
+            return;
+
+        std::vector<SymbolId> rows, columns;
+        std::vector<Cell> cells = filledCells(&rows, &columns);
+        if (sparse)
+        {
+            heading("LL(1) Parsing Table (non-empty cells):\n");
+            for (const Cell &cell : cells)
+            {
+                out.append("M[");
+                out.append(symbols.name(cell.nonTerminal));
+                out.append(", ");
+                out.append(symbols.name(cell.terminal));
+                out.append("] = ");
+                out.append(symbols.name(cell.nonTerminal));
+                out.append(" -> ");
+                out.append(renderFinal(cell.production));
+                out.append('\n');
+            }
+        }
+        else
+        {
+            heading("LL(1) Parsing Table:\n\n");
+            const size_t colWidth = 20;
+            out.appendPadded("Non-Terminal", colWidth);
+            for (SymbolId t : columns)
+                out.appendPadded(symbols.name(t), colWidth);
+            out.append('\n');
+            out.appendRepeated('-', colWidth * (columns.size() + 1));
+            out.append('\n');
+            size_t next = 0;
+            for (SymbolId nt : rows)
+            {
+                out.appendPadded(symbols.name(nt), colWidth);
+                for (SymbolId t : columns)
+                {
+                    if (next < cells.size() && cells[next].nonTerminal == nt && cells[next].terminal == t)
+                        out.appendPadded(renderFinal(cells[next++].production), colWidth);
+                    else
+                        out.appendRepeated(' ', colWidth);
+                }
+                out.append('\n');
+            }
+        }
+
+        // Conflicts, if any; the table above keeps the first production of each.
+        const auto &conflicts = result.parsingTable.conflicts;
+        if (!conflicts.empty())
+        {
+            out.append("\nLL(1) Conflicts:\n");
+            for (const auto &conflict : conflicts)
+            {
+                const std::string &nt = symbols.name(conflict.nonTerminal);
+                out.append("M[");
+                out.append(nt);
+                out.append(", ");
+                out.append(symbols.name(conflict.terminal));
+                out.append("]: ");
+                out.append(nt);
+                out.append(" -> ");
+                out.append(renderFinal(static_cast<int32_t>(conflict.kept)));
+                out.append(" (kept) vs ");
+                out.append(nt);
+                out.append(" -> ");
+                out.append(renderFinal(static_cast<int32_t>(conflict.rejected)));
+                out.append('\n');
+            }
+        }
+    }
+
+    // --- csv: section,nonterminal,terminal,production,alternative ---
+
+    static void csvField(OutputBuffer &out, std::string_view field)
+    {
+        if (field.find_first_of(",\"\n\r") == std::string_view::npos)
+        {
+            out.append(field);
+            return;
+        }
+        out.append('"');
+        for (char c : field)
+        {
+            if (c == '"')
+                out.append('"');
+            out.append(c);
+        }
+        out.append('"');
+    }
+
+    static void csvRow(OutputBuffer &out, std::string_view section, std::string_view nt, std::string_view terminal,
+                       std::string_view production, std::string_view alternative = "")
+    {
+        csvField(out, section);
+        out.append(',');
+        csvField(out, nt);
+        out.append(',');
+        csvField(out, terminal);
+        out.append(',');
+        csvField(out, production);
+        out.append(',');
+        csvField(out, alternative);
+        out.append('\n');
+    }
+
+    void writeCsv(OutputBuffer &out)
+    {
+        out.append("section,nonterminal,terminal,production,alternative\n");
+        auto grammarRows = [&](std::string_view section, const Grammar &grammar) {
+            for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+                for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                    csvRow(out, section, symbols.name(nt), "", renderProduction(grammar.rhs(p), symbols));
+        };
+        auto setRows = [&](std::string_view section, const TerminalSets &sets) {
+            for (SymbolId nt : sortedByName(result.finalGrammar.nonTerminals, symbols))
+                for (SymbolId sym : setMembers(sets, nt))
+                    csvRow(out, section, symbols.name(nt), symbols.name(sym), "");
+        };
+        if (sections.factoredGrammar)
+            grammarRows("factored", result.factoredGrammar);
+        if (sections.finalGrammar)
+            grammarRows("final", result.finalGrammar);
+        if (sections.firstSets)
+            setRows("first", result.firstSets);
+        if (sections.followSets)
+            setRows("follow", result.followSets);
+        if (!sections.table)
+            return;
+        for (const Cell &cell : filledCells())
+            csvRow(out, "table", symbols.name(cell.nonTerminal), symbols.name(cell.terminal), renderFinal(cell.production));
+        for (const auto &conflict : result.parsingTable.conflicts)
+            csvRow(out, "conflict", symbols.name(conflict.nonTerminal), symbols.name(conflict.terminal),
+                   renderFinal(static_cast<int32_t>(conflict.kept)), renderFinal(static_cast<int32_t>(conflict.rejected)));
+    }
+
+    // --- json ---
+
+    static void jsonString(OutputBuffer &out, std::string_view text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out.append('"');
+        for (char c : text)
+        {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\')
+            {
+                out.append('\\');
+                out.append(c);
+            }
+            else if (u < 0x20)
+            {
+                out.append("\\u00");
+                out.append(hex[u >> 4]);
+                out.append(hex[u & 15]);
+            }
+            else
+                out.append(c);
+        }
+        out.append('"');
+    }
+
+    void writeJson(OutputBuffer &out)
+    {
+        bool firstKey = true;
+        auto key = [&](std::string_view name) {
+            out.append(firstKey ? "{\n  " : ",\n  ");
+            jsonString(out, name);
+            out.append(": ");
+            firstKey = false;
+        };
+        auto grammarObject = [&](const Grammar &grammar) {
+            out.append('{');
+            bool firstRule = true;
+            for (SymbolId nt : sortedByName(grammar.nonTerminals, symbols))
+            {
+                out.append(firstRule ? "\n    " : ",\n    ");
+                firstRule = false;
+                jsonString(out, symbols.name(nt));
+                out.append(": [");
+                for (uint32_t p = grammar.firstProduction(nt); p < grammar.endProduction(nt); p++)
+                {
+                    if (p != grammar.firstProduction(nt))
+                        out.append(", ");
+                    jsonString(out, renderProduction(grammar.rhs(p), symbols));
+                }
+                out.append(']');
+            }
+            out.append("\n  }");
+        };
+        auto setsObject = [&](const TerminalSets &sets) {
+            out.append('{');
+            bool firstRule = true;
+            for (SymbolId nt : sortedByName(result.finalGrammar.nonTerminals, symbols))
+            {
+                out.append(firstRule ? "\n    " : ",\n    ");
+                firstRule = false;
+                jsonString(out, symbols.name(nt));
+                out.append(": [");
+                bool firstMember = true;
+                for (SymbolId sym : setMembers(sets, nt))
+                {
+                    if (!firstMember)
+                        out.append(", ");
+                    jsonString(out, symbols.name(sym));
+                    firstMember = false;
+                }
+                out.append(']');
+            }
+            out.append("\n  }");
+        };
+        if (sections.factoredGrammar)
+        {
+            key("factoredGrammar");
+            grammarObject(result.factoredGrammar);
+        }
+        if (sections.finalGrammar)
+        {
+            key("finalGrammar");
+            grammarObject(result.finalGrammar);
+        }
+        if (sections.firstSets)
+        {
+            key("first");
+            setsObject(result.firstSets);
+        }
+        if (sections.followSets)
+        {
+            key("follow");
+            setsObject(result.followSets);
+        }
+        if (sections.table)
+        {
+            key("table");
+            out.append('[');
+            bool firstCell = true;
+            for (const Cell &cell : filledCells())
+            {
+                out.append(firstCell ? "\n    {\"nonTerminal\": " : ",\n    {\"nonTerminal\": ");
+                firstCell = false;
+                jsonString(out, symbols.name(cell.nonTerminal));
+                out.append(", \"terminal\": ");
+                jsonString(out, symbols.name(cell.terminal));
+                out.append(", \"production\": ");
+                jsonString(out, renderFinal(cell.production));
+                out.append('}');
+            }
+            out.append("\n  ]");
+            key("conflicts");
+            out.append('[');
+            bool firstConflict = true;
+            for (const auto &conflict : result.parsingTable.conflicts)
+            {
+                out.append(firstConflict ? "\n    {\"nonTerminal\": " : ",\n    {\"nonTerminal\": ");
+                firstConflict = false;
+                jsonString(out, symbols.name(conflict.nonTerminal));
+                out.append(", \"terminal\": ");
+                jsonString(out, symbols.name(conflict.terminal));
+                out.append(", \"kept\": ");
+                jsonString(out, renderFinal(static_cast<int32_t>(conflict.kept)));
+                out.append(", \"rejected\": ");
+                jsonString(out, renderFinal(static_cast<int32_t>(conflict.rejected)));
+                out.append('}');
+            }
+            out.append("\n  ]");
+        }
+        out.append(firstKey ? "{}\n" : "\n}\n");
+    }
+
+    /* --- binary ---
+       "CFGOUT01", then u32 symbol count and per symbol u32 length, name bytes, u8 non-terminal
+       flag. Then one record per enabled section: u32 tag, u64 payload bytes, payload. All
+       integers are native-endian u32 unless noted; SymbolIds index the symbol list.
+         1 factored grammar, 2 final grammar:
+             start, nt count, nts..., production count, lhs..., rhs offsets (count + 1)...,
+             rhs symbol count, rhs symbols...
+         3 FIRST, 4 FOLLOW: nt count, then per nt: nt, member count, members...
+         5 table: cell count, (nt, terminal, final production) triples,
+                  conflict count, (nt, terminal, kept, rejected) quadruples
+    */
+    void writeBinary(OutputBuffer &out)
+    {
+        out.append("CFGOUT01");
+        out.appendValue(static_cast<uint32_t>(symbols.size()));
+        for (size_t id = 0; id < symbols.size(); id++)
+        {
+            const std::string &name = symbols.name(static_cast<SymbolId>(id));
+            out.appendValue(static_cast<uint32_t>(name.size()));
+            out.append(name);
+            out.appendValue(static_cast<uint8_t>(symbols.isNonTerminal(static_cast<SymbolId>(id)) ? 1 : 0));
+        }
+
+        std::vector<uint32_t> payload;
+        auto section = [&](uint32_t tag) {
+            out.appendValue(tag);
+            out.appendValue(static_cast<uint64_t>(payload.size() * sizeof(uint32_t)));
+            out.appendRaw(payload.data(), payload.size() * sizeof(uint32_t));
+            payload.clear();
+        };
+        auto putList = [&](const auto &values) {
+            payload.push_back(static_cast<uint32_t>(values.size()));
+            payload.insert(payload.end(), values.begin(), values.end());
+        };
+        auto grammarPayload = [&](const Grammar &grammar) {
+            payload.push_back(static_cast<uint32_t>(grammar.startSymbol));
+            putList(grammar.nonTerminals);
+            putList(grammar.prodLhs);
+            payload.insert(payload.end(), grammar.prodStart.begin(), grammar.prodStart.end());
+            putList(grammar.rhsSymbols);
+        };
+        auto setsPayload = [&](const TerminalSets &sets) {
+            std::vector<SymbolId> nts = sortedByName(result.finalGrammar.nonTerminals, symbols);
+            payload.push_back(static_cast<uint32_t>(nts.size()));
+            for (SymbolId nt : nts)
+            {
+                payload.push_back(static_cast<uint32_t>(nt));
+                putList(setMembers(sets, nt));
+            }
+        };
+        if (sections.factoredGrammar)
+        {
+            grammarPayload(result.factoredGrammar);
+            section(1);
+        }
+        if (sections.finalGrammar)
+        {
+            grammarPayload(result.finalGrammar);
+            section(2);
+        }
+        if (sections.firstSets)
+        {
+            setsPayload(result.firstSets);
+            section(3);
+        }
+        if (sections.followSets)
+        {
+            setsPayload(result.followSets);
+            section(4);
+        }
+        if (sections.table)
+        {
+            std::vector<Cell> cells = filledCells();
+            payload.push_back(static_cast<uint32_t>(cells.size()));
+            for (const Cell &cell : cells)
+            {
+                payload.push_back(static_cast<uint32_t>(cell.nonTerminal));
+                payload.push_back(static_cast<uint32_t>(cell.terminal));
+                payload.push_back(static_cast<uint32_t>(cell.production));
+            }
+            const auto &conflicts = result.parsingTable.conflicts;
+            payload.push_back(static_cast<uint32_t>(conflicts.size()));
+            for (const auto &conflict : conflicts)
+            {
+                payload.push_back(static_cast<uint32_t>(conflict.nonTerminal));
+                payload.push_back(static_cast<uint32_t>(conflict.terminal));
+                payload.push_back(conflict.kept);
+                payload.push_back(conflict.rejected);
+            }
+            section(5);
+        }
+    }
+};
+
+#endif
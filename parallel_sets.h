@@ -0,0 +1,266 @@
+#ifndef PARALLEL_SETS_H
+#define PARALLEL_SETS_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "grammar_ir.h"
+#include "dependency_graph.h"
+#include "first_follow.h"
+
+/* Parallel FIRST/FOLLOW.
+
+   Both fixpoints only ever read along the edges of a dependency graph (FIRST(X) reads FIRST of
+   the symbols in X's productions, FOLLOW(B) reads FOLLOW(A) for A -> α B β with nullable β).
+   Condensing that graph into its strongly connected components gives a DAG: once every
+   component a component reads from is final, its own sets can be computed in isolation, and
+   components with no path between them can run at the same time. The components are scheduled
+   as tasks on a work-stealing pool; the results are the unique least fixpoints, so they are
+   identical to the sequential engines whatever the schedule.
+*/
+
+/* Runs a DAG of tasks on a fixed number of threads (the calling thread is one of them).
+   Every worker owns a deque: it pushes the tasks it makes ready and pops them LIFO, and
+   an idle worker steals FIFO from the others. */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(size_t threads) : threadCount(std::max<size_t>(1, threads)) {}
+
+    size_t size() const { return threadCount; }
+
+    // Number of tasks taken from another worker's deque during the last run().
+    uint64_t steals() const { return stealCount; }
+
+    /* Runs task(t) for t in [0, taskCount) once each, t only after every task listing t as a
+       successor has finished. successors is CSR: the successors of t are
+       successors[successorStart[t], successorStart[t + 1]). */
+    template <typename Task>
+    void run(size_t taskCount, const std::pmr::vector<uint32_t> &successorStart,
+             const std::pmr::vector<uint32_t> &successors, Task task)
+    {
+        std::unique_ptr<std::atomic<uint32_t>[]> pending(new std::atomic<uint32_t>[taskCount]);
+        for (size_t t = 0; t < taskCount; t++)
+            pending[t].store(0, std::memory_order_relaxed);
+        for (uint32_t s : successors)
+            pending[s].fetch_add(1, std::memory_order_relaxed);
+
+        std::vector<Queue> queues(threadCount);
+        size_t next = 0;
+        for (size_t t = 0; t < taskCount; t++)
+            if (pending[t].load(std::memory_order_relaxed) == 0)
+                queues[next++ % threadCount].tasks.push_back(static_cast<uint32_t>(t));
+
+        std::atomic<size_t> remaining(taskCount);
+        std::atomic<uint64_t> stolen(0);
+        auto worker = [&](size_t self) {
+            while (remaining.load(std::memory_order_acquire) > 0)
+            {
+                uint32_t t;
+                if (!queues[self].popBack(t))
+                {
+                    bool found = false;
+                    for (size_t k = 1; k < threadCount && !found; k++)
+                        found = queues[(self + k) % threadCount].popFront(t);
+                    if (!found)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    stolen.fetch_add(1, std::memory_order_relaxed);
+                }
+                task(t);
+                for (uint32_t e = successorStart[t]; e < successorStart[t + 1]; e++)
+                    if (pending[successors[e]].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        queues[self].pushBack(successors[e]);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            if (self != 0)
+                mergeThreadStats();
+        };
+
+        std::vector<std::thread> helpers;
+        for (size_t i = 1; i < threadCount; i++)
+            helpers.emplace_back(worker, i);
+        worker(0);
+        for (auto &helper : helpers)
+            helper.join();
+        stealCount = stolen.load();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+
+        void pushBack(uint32_t t)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            tasks.push_back(t);
+        }
+
+        bool popBack(uint32_t &t)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tasks.empty())
+                return false;
+            t = tasks.back();
+            tasks.pop_back();
+            return true;
+        }
+
+        bool popFront(uint32_t &t)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tasks.empty())
+                return false;
+            t = tasks.front();
+            tasks.pop_front();
+            return true;
+        }
+    };
+
+    size_t threadCount;
+    uint64_t stealCount = 0;
+};
+
+/* Condensation of a "reads" graph (edge X -> Y: X's set reads Y's) for scheduling: the members
+   of every component, and the successor lists of the component DAG, where Y's component
+   precedes X's. */
+struct ComponentDag
+{
+    uint32_t count = 0;
+    std::pmr::vector<uint32_t> component;     // indexed by node
+    std::pmr::vector<uint32_t> memberStart;   // CSR members of each component
+    std::pmr::vector<SymbolId> members;
+    std::pmr::vector<uint32_t> successorStart;
+    std::pmr::vector<uint32_t> successors;
+
+    explicit ComponentDag(std::pmr::memory_resource *scratch)
+        : component(scratch), memberStart(scratch), members(scratch), successorStart(scratch), successors(scratch) {}
+
+    void build(const std::pmr::vector<std::pair<SymbolId, SymbolId>> &reads, const std::vector<SymbolId> &roots,
+               size_t nodeCount, std::pmr::memory_resource *scratch)
+    {
+        std::pmr::vector<uint32_t> offsets(scratch);
+        std::pmr::vector<SymbolId> targets(scratch);
+        buildAdjacency(reads, nodeCount, offsets, targets);
+        count = stronglyConnectedComponents(offsets, targets, roots, component, scratch);
+
+        std::pmr::vector<std::pair<uint32_t, SymbolId>> membership(scratch);
+        for (size_t node = 0; node < nodeCount; node++)
+            if (component[node] != NO_COMPONENT)
+                membership.emplace_back(component[node], static_cast<SymbolId>(node));
+        std::pmr::vector<std::pair<uint32_t, uint32_t>> order(scratch);
+        for (const auto &edge : reads)
+        {
+            uint32_t from = component[edge.first], to = component[edge.second];
+            if (from != to)
+                order.emplace_back(to, from);
+        }
+        buildMembers(membership);
+        buildAdjacency(order, count, successorStart, successors);
+    }
+
+private:
+    void buildMembers(const std::pmr::vector<std::pair<uint32_t, SymbolId>> &membership)
+    {
+        memberStart.assign(count + 1, 0);
+        for (const auto &m : membership)
+            memberStart[m.first + 1]++;
+        for (size_t c = 0; c < count; c++)
+            memberStart[c + 1] += memberStart[c];
+        members.resize(membership.size());
+        std::pmr::vector<uint32_t> fill(memberStart.begin(), memberStart.end() - 1, memberStart.get_allocator());
+        for (const auto &m : membership)
+            members[fill[m.first]++] = m.second;
+    }
+};
+
+// FIRST sets computed component by component on pool. Within a component the sets are
+// iterated to a fixpoint; everything outside it is already final.
+inline TerminalSets firstSetParallel(const Grammar &grammar, const SymbolTable &symbols,
+                                     const TerminalIndex &terminals, const NullableSet &nullable,
+                                     WorkStealingPool &pool,
+                                     std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    TerminalSets first(symbols.size(), TerminalSet(terminals.size()));
+    // X reads every non-terminal of each of its productions up to the first one that is not
+    // nullable, or the first terminal.
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> reads(scratch);
+    reads.reserve(grammar.rhsSymbols.size());
+    for (size_t p = 0; p < grammar.productionCount(); p++)
+    {
+        for (SymbolId sym : grammar.rhs(p))
+        {
+            if (!symbols.isNonTerminal(sym))
+                break;
+            reads.emplace_back(grammar.prodLhs[p], sym);
+            if (!nullable.test(sym))
+                break;
+        }
+    }
+    ComponentDag dag(scratch);
+    dag.build(reads, grammar.nonTerminals, symbols.size(), scratch);
+
+    pool.run(dag.count, dag.successorStart, dag.successors, [&](uint32_t c) {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            CFG_STAT_ADD(iterations, 1);
+            for (uint32_t m = dag.memberStart[c]; m < dag.memberStart[c + 1]; m++)
+                changed |= refineFirst(dag.members[m], grammar, symbols, terminals, nullable, first);
+        }
+    });
+    return first;
+}
+
+// FOLLOW sets computed component by component on pool. FOLLOW(A) ⊆ FOLLOW(B) holds both ways
+// inside a component, so all its members get the same set: the union of their own
+// contributions and the FOLLOW sets flowing in from earlier components.
+inline TerminalSets followSetParallel(const Grammar &grammar, const SuffixFirstSets &suffixes,
+                                      const SymbolTable &symbols, const TerminalIndex &terminals,
+                                      SymbolId startSymbol, WorkStealingPool &pool,
+                                      std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+{
+    TerminalSets follow;
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> edges(scratch);   // (A, B) with FOLLOW(A) ⊆ FOLLOW(B)
+    followContributions(grammar, suffixes, symbols, terminals, startSymbol, follow, edges);
+    std::pmr::vector<std::pair<SymbolId, SymbolId>> reads(scratch);   // B reads A
+    reads.reserve(edges.size());
+    for (const auto &edge : edges)
+        reads.emplace_back(edge.second, edge.first);
+    ComponentDag dag(scratch);
+    dag.build(reads, grammar.nonTerminals, symbols.size(), scratch);
+    std::pmr::vector<uint32_t> feedStart(scratch);
+    std::pmr::vector<SymbolId> feeds(scratch);
+    buildAdjacency(reads, symbols.size(), feedStart, feeds);
+
+    pool.run(dag.count, dag.successorStart, dag.successors, [&](uint32_t c) {
+        CFG_STAT_ADD(iterations, 1);
+        SymbolId head = dag.members[dag.memberStart[c]];
+        TerminalSet merged = follow[head];
+        for (uint32_t m = dag.memberStart[c]; m < dag.memberStart[c + 1]; m++)
+        {
+            SymbolId B = dag.members[m];
+            merged.unionWith(follow[B]);
+            for (uint32_t f = feedStart[B]; f < feedStart[B + 1]; f++)
+                if (dag.component[feeds[f]] != c)
+                    merged.unionWith(follow[feeds[f]]);
+        }
+        for (uint32_t m = dag.memberStart[c]; m < dag.memberStart[c + 1]; m++)
+            follow[dag.members[m]] = merged;
+    });
+    return follow;
+}
+
+#endif
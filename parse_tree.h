@@ -0,0 +1,127 @@
+#ifndef PARSE_TREE_H
+#define PARSE_TREE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "grammar_ir.h"
+
+/* Parse results for PredictiveParser::parse(input, sink).
+
+   ParseTreeBuilder stores the tree in one contiguous array of 16-byte nodes linked by 32-bit
+   first-child and next-sibling indices. Nodes are appended in pre-order, so a subtree is a
+   contiguous range and a walk over the tree reads the array front to back. ParseEventLog keeps
+   the same pre-order walk as a flat stream of enter/token/exit events, for consumers that
+   never need the tree itself. Both reserve their arrays from the token count, so a parse makes
+   only a few allocations. After a parse error both hold what was built up to the error.
+*/
+
+struct ParseNode
+{
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    SymbolId symbol;
+    int32_t production;          // production expanding a non-terminal; token index for a terminal
+    uint32_t firstChild = NONE;
+    uint32_t nextSibling = NONE;
+};
+
+class ParseTree
+{
+public:
+    std::vector<ParseNode> nodes;   // nodes[0] is the root once anything was parsed
+
+    bool empty() const { return nodes.empty(); }
+    const ParseNode &operator[](uint32_t node) const { return nodes[node]; }
+
+    // Arena size, including the capacity reserved but not used.
+    size_t bytes() const { return nodes.capacity() * sizeof(ParseNode); }
+};
+
+class ParseTreeBuilder
+{
+public:
+    static constexpr bool events = true;
+
+    ParseTreeBuilder(ParseTree &tree, size_t tokens) : tree(tree)
+    {
+        tree.nodes.clear();
+        tree.nodes.reserve(tokens * 3 + 1);
+    }
+
+    void enter(SymbolId symbol, int32_t production)
+    {
+        uint32_t node = add(symbol, production);
+        open.push_back(Open{node, ParseNode::NONE});
+    }
+
+    void token(SymbolId symbol, size_t index) { add(symbol, static_cast<int32_t>(index)); }
+
+    void exit(SymbolId) { open.pop_back(); }
+
+private:
+    // A node whose children are still being added, and its last child so far.
+    struct Open
+    {
+        uint32_t node;
+        uint32_t lastChild;
+    };
+
+    ParseTree &tree;
+    std::vector<Open> open;
+
+    uint32_t add(SymbolId symbol, int32_t production)
+    {
+        uint32_t node = static_cast<uint32_t>(tree.nodes.size());
+        tree.nodes.push_back(ParseNode{symbol, production});
+        if (!open.empty())
+        {
+            Open &parent = open.back();
+            if (parent.lastChild == ParseNode::NONE)
+                tree.nodes[parent.node].firstChild = node;
+            else
+                tree.nodes[parent.lastChild].nextSibling = node;
+            parent.lastChild = node;
+        }
+        return node;
+    }
+};
+
+enum class ParseEventKind : uint32_t
+{
+    Enter,   // value is the production
+    Token,   // value is the token index
+    Exit
+};
+
+struct ParseEvent
+{
+    ParseEventKind kind;
+    SymbolId symbol;
+    uint32_t value;
+};
+
+class ParseEventLog
+{
+public:
+    static constexpr bool events = true;
+
+    std::vector<ParseEvent> log;
+
+    explicit ParseEventLog(size_t tokens) { log.reserve(tokens * 5 + 2); }
+
+    void enter(SymbolId symbol, int32_t production)
+    {
+        log.push_back(ParseEvent{ParseEventKind::Enter, symbol, static_cast<uint32_t>(production)});
+    }
+    void token(SymbolId symbol, size_t index)
+    {
+        log.push_back(ParseEvent{ParseEventKind::Token, symbol, static_cast<uint32_t>(index)});
+    }
+    void exit(SymbolId symbol) { log.push_back(ParseEvent{ParseEventKind::Exit, symbol, 0}); }
+
+    size_t bytes() const { return log.capacity() * sizeof(ParseEvent); }
+};
+
+#endif
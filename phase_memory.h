@@ -0,0 +1,104 @@
+#ifndef PHASE_MEMORY_H
+#define PHASE_MEMORY_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+
+#include <sys/resource.h>
+
+/* Memory accounting for the grammar phases.
+
+   Each phase gets a monotonic arena for its scratch data (builder staging buffers, worklists,
+   dependency lists) that is released in one shot when the phase ends. The arena draws its
+   chunks from a CountingResource, and the global heap counters below are bumped by the
+   operator new replacement in cfg_parser.cpp, so a phase can report both.
+*/
+
+inline std::atomic<uint64_t> heapAllocations{0};
+inline std::atomic<uint64_t> heapBytes{0};
+
+// Passes allocations through to an upstream resource and counts them.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : upstream(upstream) {}
+
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+private:
+    void *do_allocate(size_t size, size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return upstream->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *p, size_t size, size_t alignment) override
+    {
+        upstream->deallocate(p, size, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource *upstream;
+};
+
+inline long peakRssKilobytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct PhaseMemory
+{
+    std::string phase;
+    uint64_t heapAllocations = 0;   // operator new calls made while the phase ran
+    uint64_t heapBytes = 0;
+    uint64_t arenaChunks = 0;       // chunks the phase arena took from the heap
+    uint64_t arenaBytes = 0;
+    long peakRssKb = 0;             // process peak RSS once the phase finished
+};
+
+/* Arena plus counters for one phase. Scratch containers are built on resource(); finish()
+   releases the arena and returns what the phase used. Chunks come from upstream, which is the
+   heap unless the caller keeps a pool of them to reuse across analyses. */
+class PhaseArena
+{
+public:
+    explicit PhaseArena(const std::string &phase, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : phase(phase), chunks(upstream), arena(64 * 1024, &chunks),
+          startAllocations(heapAllocations.load()), startBytes(heapBytes.load()) {}
+
+    std::pmr::memory_resource *resource() { return &arena; }
+
+    PhaseMemory finish()
+    {
+        arena.release();
+        PhaseMemory usage;
+        usage.phase = phase;
+        usage.heapAllocations = heapAllocations.load() - startAllocations;
+        usage.heapBytes = heapBytes.load() - startBytes;
+        usage.arenaChunks = chunks.allocations;
+        usage.arenaBytes = chunks.bytes;
+        usage.peakRssKb = peakRssKilobytes();
+        return usage;
+    }
+
+private:
+    std::string phase;
+    CountingResource chunks;
+    std::pmr::monotonic_buffer_resource arena;
+    uint64_t startAllocations;
+    uint64_t startBytes;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PHASE_STATS_H
+#define PHASE_STATS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "phase_memory.h"
+
+/* Per-phase profiling counters behind --stats.
+
+   Engines bump counters with CFG_STAT_ADD; the counters are thread-local so the hot loops
+   never touch shared cache lines, and pool workers fold theirs into the shared totals with
+   mergeThreadStats() before they exit. Building with -DCFG_STATS=0 turns every counter and
+   probe into a no-op, so the instrumentation costs nothing when it is not wanted.
+*/
+
+#ifndef CFG_STATS
+#define CFG_STATS 1
+#endif
+
+struct StatCounters
+{
+    uint64_t iterations = 0;   // fixpoint rounds, or worklist visits for the worklist engines
+    uint64_t setInserts = 0;   // insert/union operations on FIRST/FOLLOW sets
+};
+
+#if CFG_STATS
+inline thread_local StatCounters threadStats;
+inline std::atomic<uint64_t> mergedIterations{0};
+inline std::atomic<uint64_t> mergedSetInserts{0};
+
+#define CFG_STAT_ADD(field, n) (threadStats.field += (n))
+
+// Moves the calling thread's counters into the shared totals.
+inline void mergeThreadStats()
+{
+    mergedIterations.fetch_add(threadStats.iterations, std::memory_order_relaxed);
+    mergedSetInserts.fetch_add(threadStats.setInserts, std::memory_order_relaxed);
+    threadStats = StatCounters();
+}
+
+inline StatCounters totalStats()
+{
+    StatCounters total;
+    total.iterations = threadStats.iterations + mergedIterations.load(std::memory_order_relaxed);
+    total.setInserts = threadStats.setInserts + mergedSetInserts.load(std::memory_order_relaxed);
+    return total;
+}
+#else
+#define CFG_STAT_ADD(field, n) ((void)0)
+
+inline void mergeThreadStats() {}
+#endif
+
+struct PhaseStats
+{
+    std::string phase;
+    double seconds = 0;
+    uint64_t iterations = 0;
+    uint64_t setInserts = 0;
+    uint64_t allocations = 0;          // operator new calls
+    size_t productions = 0;            // productions of the grammar the phase produced
+    size_t nonTerminalsCreated = 0;
+};
+
+/* Measures one phase from construction to finish() and appends the result to stats. */
+class PhaseStatsProbe
+{
+public:
+#if CFG_STATS
+    PhaseStatsProbe(const std::string &phase, std::vector<PhaseStats> &stats)
+        : phase(phase), stats(stats), started(std::chrono::steady_clock::now()), counters(totalStats()),
+          allocations(heapAllocations.load()) {}
+
+    void finish(size_t productions = 0, size_t nonTerminalsCreated = 0)
+    {
+        PhaseStats entry;
+        entry.phase = phase;
+        entry.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        StatCounters now = totalStats();
+        entry.iterations = now.iterations - counters.iterations;
+        entry.setInserts = now.setInserts - counters.setInserts;
+        entry.allocations = heapAllocations.load() - allocations;
+        entry.productions = productions;
+        entry.nonTerminalsCreated = nonTerminalsCreated;
+        stats.push_back(entry);
+    }
+
+private:
+    std::string phase;
+    std::vector<PhaseStats> &stats;
+    std::chrono::steady_clock::time_point started;
+    StatCounters counters;
+    uint64_t allocations;
+#else
+    PhaseStatsProbe(const std::string &, std::vector<PhaseStats> &) {}
+    void finish(size_t = 0, size_t = 0) {}
+#endif
+};
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef REFERENCE_SETS_H
+#define REFERENCE_SETS_H
+
+#include <vector>
+#include <set>
+
+#include "grammar_ir.h"
+#include "first_follow.h"
+#include "phase_stats.h"
+
+/* The original FIRST/FOLLOW engines behind --engine=reference: std::set per non-terminal and
+   round-robin passes over every production until nothing changes. The bitset engines in
+   first_follow.h are checked against these with --check-engines.
+*/
+
+// FIRST and FOLLOW sets are indexed by SymbolId; only non-terminal entries are filled in.
+typedef std::vector<std::set<SymbolId>> SymbolSets;
+
+// set::insert that also feeds the --stats insert counter; returns whether sym was new.
+inline bool insertCounted(std::set<SymbolId> &target, SymbolId sym)
+{
+    CFG_STAT_ADD(setInserts, 1);
+    return target.insert(sym).second;
+}
+
+// Computes FIRST sets for all non-terminals in the grammar.
+// Terminals are the symbols not marked as non-terminals in the symbol table.
+    inline SymbolSets firstSet(const Grammar& grammar, const SymbolTable& symbols)
+    {
+
+    // Initialize an empty FIRST set for each non-terminal.
+    SymbolSets first(symbols.size());
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        CFG_STAT_ADD(iterations, 1);
+        // For each non-terminal X.
+        for (SymbolId X : grammar.nonTerminals)
+        {
+            // Process each production for X.
+            for (uint32_t p = grammar.firstProduction(X); p < grammar.endProduction(X); p++)
+            {
+                SymbolSpan prod = grammar.rhs(p);
+                bool addEpsilon = true;
+                // Process each symbol in the production.
+                for (SymbolId token : prod)
+                {
+                    // If token is terminal.
+                    if (!symbols.isNonTerminal(token))
+                    {
+                        if (insertCounted(first[X], token))
+                            changed = true;
+                        addEpsilon = false;
+                        break;
+                    }
+                    // Token is a non-terminal: add its FIRST set (excluding ε).
+                    for (SymbolId sym : first[token])
+                    {
+                        if (sym != EPSILON && insertCounted(first[X], sym))
+                            changed = true;
+                    }
+                    // If token's FIRST set does not include ε, stop.
+                    if (first[token].find(EPSILON) == first[token].end())
+                    {
+                        addEpsilon = false;
+                        break;
+                    }
+                }
+                // If all symbols can derive ε (or the production is ε itself), add ε to FIRST(X).
+                if (addEpsilon)
+                {
+                    if (insertCounted(first[X], EPSILON))
+                        changed = true;
+                }
+            }
+        }
+    }
+
+    return first;
+}
+
+// Computes FOLLOW sets for all non-terminals using the previously computed FIRST sets.
+// FOLLOW set contains terminals that can immediately follow a non-terminal in some production.
+inline SymbolSets computeFollowSets(
+    const Grammar& grammar, const SymbolSets& first, const SymbolTable& symbols, SymbolId startSymbol)
+    {
+
+    // Initialize an empty FOLLOW set for each non-terminal.
+    SymbolSets follow(symbols.size());
+    // Start symbol always includes the end-of-input marker.
+    follow[startSymbol].insert(END_MARKER);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        CFG_STAT_ADD(iterations, 1);
+        // For every production A -> α.
+        for (SymbolId A : grammar.nonTerminals)
+        {
+            for (uint32_t p = grammar.firstProduction(A); p < grammar.endProduction(A); p++)
+            {
+                SymbolSpan prod = grammar.rhs(p);
+                // Iterate over the symbols in the production.
+                for (size_t i = 0; i < prod.size(); i++)
+                {
+                    SymbolId B = prod[i];
+                    // Process only if B is a non-terminal.
+                    if (!symbols.isNonTerminal(B))
+                        continue;
+
+                    // Examine the subsequent symbols; FOLLOW(A) is added when all of them can derive ε.
+                    bool addFollowA = true;
+                    for (size_t j = i + 1; j < prod.size(); j++)
+                    {
+                        SymbolId beta = prod[j];
+                        // If beta is a terminal, add it directly to FOLLOW(B).
+                        if (!symbols.isNonTerminal(beta))
+                        {
+                            if (insertCounted(follow[B], beta))
+                                changed = true;
+                            addFollowA = false;
+                            break;
+                        }
+                        // If beta is a non-terminal, add FIRST(beta) excluding ε.
+                        for (SymbolId sym : first[beta])
+                        {
+                            if (sym != EPSILON && insertCounted(follow[B], sym))
+                                changed = true;
+                        }
+                        // If FIRST(beta) does not contain ε, break out.
+                        if (first[beta].find(EPSILON) == first[beta].end())
+                        {
+                            addFollowA = false;
+                            break;
+                        }
+                    }
+                    // If needed, add FOLLOW(A) to FOLLOW(B).
+                    if (addFollowA)
+                    {
+                        for (SymbolId sym : follow[A])
+                        {
+                            if (insertCounted(follow[B], sym))
+                                changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return follow;
+}
+
+// Helper function: Computes FIRST set for a sequence of symbols (right-hand side of a production).
+inline std::set<SymbolId> computeFirstOfString(SymbolSpan tokens, const SymbolSets& first, const SymbolTable& symbols)
+{
+
+    std::set<SymbolId> result;
+    bool allEpsilon = true;
+    for (SymbolId token : tokens)
+    {
+        // If token is terminal.
+        if (!symbols.isNonTerminal(token))
+        {
+            result.insert(token);
+            allEpsilon = false;
+            break;
+        }
+        else
+        {
+            // Token is non-terminal: add its FIRST set except ε.
+            for (SymbolId sym : first[token])
+            {
+                if (sym != EPSILON)
+                    result.insert(sym);
+            }
+            // If token cannot derive ε, stop.
+            if (first[token].find(EPSILON) == first[token].end())
+            {
+                allEpsilon = false;
+                break;
+            }
+        }
+    }
+    if (allEpsilon)
+        result.insert(EPSILON);
+    return result;
+}
+
+// Converts a reference std::set result to the bitset form used by the table builder and output.
+// ε keeps its bit, as in firstOfSequence().
+inline TerminalSet toTerminalSet(const std::set<SymbolId> &symbolSet, const TerminalIndex &terminals)
+{
+    TerminalSet bits(terminals.size());
+    for (SymbolId sym : symbolSet)
+        bits.insert(terminals.denseOf[sym]);
+    return bits;
+}
+
+// Converts reference FIRST or FOLLOW sets to bitsets. ε is dropped; see toNullableSet().
+inline TerminalSets toTerminalSets(const SymbolSets &sets, const TerminalIndex &terminals)
+{
+    TerminalSets bits;
+    bits.reserve(sets.size());
+    for (const auto &symbolSet : sets)
+    {
+        bits.emplace_back(terminals.size());
+        for (SymbolId sym : symbolSet)
+            if (sym != EPSILON)
+                bits.back().insert(terminals.denseOf[sym]);
+    }
+    return bits;
+}
+
+// The non-terminals whose reference FIRST set holds ε.
+inline NullableSet toNullableSet(const SymbolSets &first)
+{
+    NullableSet nullable(first.size());
+    for (size_t id = 0; id < first.size(); id++)
+        if (first[id].count(EPSILON))
+            nullable.insert(static_cast<SymbolId>(id));
+    return nullable;
+}
+
+#endif
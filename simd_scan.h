@@ -0,0 +1,195 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <bitset>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CFG_SIMD_X86 1
+#else
+#define CFG_SIMD_X86 0
+#endif
+
+/* Vectorized scanning of byte runs for the DFA lexer.
+
+   A run is a stretch of bytes that all lie in (or all lie outside) up to four byte ranges:
+   whitespace, the body of a comment up to its terminator, identifier characters. findRunEnd()
+   tests 16 (SSE2) or 32 (AVX2) bytes per step and finishes the last few bytes one at a time,
+   so it returns exactly the position a byte-by-byte loop would. x86 builds pick AVX2 at run
+   time when the CPU has it; other targets use the scalar loop.
+*/
+
+enum class ScanLevel
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+inline const char *scanLevelName(ScanLevel level)
+{
+    return level == ScanLevel::Avx2 ? "avx2" : level == ScanLevel::Sse2 ? "sse2" : "scalar";
+}
+
+inline bool parseScanLevel(const std::string &name, ScanLevel &level)
+{
+    if (name == "scalar")
+        level = ScanLevel::Scalar;
+    else if (name == "sse2" && CFG_SIMD_X86)
+        level = ScanLevel::Sse2;
+    else if (name == "avx2" && CFG_SIMD_X86)
+        level = ScanLevel::Avx2;
+    else
+        return false;
+    return true;
+}
+
+// Whether this CPU can run level; parseScanLevel() accepts the x86 levels on any x86 CPU.
+inline bool scanLevelSupported(ScanLevel level)
+{
+#if CFG_SIMD_X86
+    if (level == ScanLevel::Avx2)
+        return __builtin_cpu_supports("avx2");
+    return level == ScanLevel::Scalar || __builtin_cpu_supports("sse2");
+#else
+    return level == ScanLevel::Scalar;
+#endif
+}
+
+// The best level this CPU supports.
+inline ScanLevel detectScanLevel()
+{
+#if CFG_SIMD_X86
+    return __builtin_cpu_supports("avx2") ? ScanLevel::Avx2 : ScanLevel::Sse2;
+#else
+    return ScanLevel::Scalar;
+#endif
+}
+
+// Bytes in up to four ranges [low, low + span]; a run continues on members, or on
+// non-members if inside is false.
+struct ByteRuns
+{
+    uint8_t low[4] = {};
+    uint8_t span[4] = {};
+    unsigned count = 0;
+    bool inside = true;
+
+    bool continues(uint8_t c) const
+    {
+        bool member = false;
+        for (unsigned r = 0; r < count; r++)
+            member |= static_cast<uint8_t>(c - low[r]) <= span[r];
+        return member == inside;
+    }
+
+    // The runs of set, if set or its complement is at most four ranges.
+    static bool from(const std::bitset<256> &set, ByteRuns &runs)
+    {
+        for (bool inside : {true, false})
+        {
+            runs = ByteRuns();
+            runs.inside = inside;
+            bool fits = true;
+            for (unsigned c = 0; c < 256 && fits;)
+            {
+                if (set[c] != inside)
+                {
+                    c++;
+                    continue;
+                }
+                unsigned end = c;
+                while (end + 1 < 256 && set[end + 1] == inside)
+                    end++;
+                fits = runs.count < 4;
+                if (fits)
+                {
+                    runs.low[runs.count] = static_cast<uint8_t>(c);
+                    runs.span[runs.count++] = static_cast<uint8_t>(end - c);
+                }
+                c = end + 1;
+            }
+            if (fits && runs.count > 0)
+                return true;
+        }
+        return false;
+    }
+};
+
+inline const uint8_t *findRunEndScalar(const ByteRuns &runs, const uint8_t *p, const uint8_t *end)
+{
+    while (p < end && runs.continues(*p))
+        p++;
+    return p;
+}
+
+#if CFG_SIMD_X86
+inline const uint8_t *findRunEndSse2(const ByteRuns &runs, const uint8_t *p, const uint8_t *end)
+{
+    __m128i low[4], span[4];
+    for (unsigned r = 0; r < runs.count; r++)
+    {
+        low[r] = _mm_set1_epi8(static_cast<char>(runs.low[r]));
+        span[r] = _mm_set1_epi8(static_cast<char>(runs.span[r]));
+    }
+    const __m128i zero = _mm_setzero_si128();
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i member = zero;
+        // c - low <= span, unsigned: the saturating difference is zero.
+        for (unsigned r = 0; r < runs.count; r++)
+            member = _mm_or_si128(member, _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(bytes, low[r]), span[r]), zero));
+        unsigned stops = static_cast<unsigned>(_mm_movemask_epi8(member));
+        if (runs.inside)
+            stops = ~stops & 0xFFFF;
+        if (stops)
+            return p + __builtin_ctz(stops);
+    }
+    return findRunEndScalar(runs, p, end);
+}
+
+__attribute__((target("avx2")))
+inline const uint8_t *findRunEndAvx2(const ByteRuns &runs, const uint8_t *p, const uint8_t *end)
+{
+    __m256i low[4], span[4];
+    for (unsigned r = 0; r < runs.count; r++)
+    {
+        low[r] = _mm256_set1_epi8(static_cast<char>(runs.low[r]));
+        span[r] = _mm256_set1_epi8(static_cast<char>(runs.span[r]));
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i member = zero;
+        for (unsigned r = 0; r < runs.count; r++)
+            member = _mm256_or_si256(member,
+                                     _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(bytes, low[r]), span[r]), zero));
+        unsigned stops = static_cast<unsigned>(_mm256_movemask_epi8(member));
+        if (runs.inside)
+            stops = ~stops;
+        if (stops)
+            return p + __builtin_ctz(stops);
+    }
+    return findRunEndSse2(runs, p, end);
+}
+#endif
+
+// The first byte in [p, end) that ends the run, or end.
+inline const uint8_t *findRunEnd(ScanLevel level, const ByteRuns &runs, const uint8_t *p, const uint8_t *end)
+{
+#if CFG_SIMD_X86
+    if (level == ScanLevel::Avx2)
+        return findRunEndAvx2(runs, p, end);
+    if (level == ScanLevel::Sse2)
+        return findRunEndSse2(runs, p, end);
+#endif
+    (void)level;
+    return findRunEndScalar(runs, p, end);
+}
+
+#endif
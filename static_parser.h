@@ -0,0 +1,142 @@
+#ifndef STATIC_PARSER_H
+#define STATIC_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/* Support code for the headers cfg_parser --emit-header writes. A generated header defines a
+   Tables struct whose counts and arrays (symbol names, table rows and columns, productions
+   and the dense LL(1) table) are all static constexpr members, and instantiates the templates
+   below with it. Everything is known to the compiler: symbol lookups by name fold to
+   constants, SymbolTraits answers questions about a symbol at compile time, and the parser's
+   table reads are plain indexed loads it can inline or fold. Nothing here allocates.
+*/
+
+template <typename Tables>
+struct StaticGrammar
+{
+    // Id of the symbol named name, or -1; meant for constant expressions.
+    static constexpr int32_t symbol(std::string_view name)
+    {
+        for (int32_t id = 0; id < Tables::symbolCount; id++)
+            if (Tables::symbolNames[id] == name)
+                return id;
+        return -1;
+    }
+
+    // Table column of the terminal named name, or -1.
+    static constexpr int32_t column(std::string_view name)
+    {
+        int32_t id = symbol(name);
+        return id < 0 ? -1 : Tables::columnOf[id];
+    }
+
+    // Production predicted for a non-terminal and a column, or -1.
+    static constexpr int32_t predict(int32_t nonTerminal, int32_t column)
+    {
+        int32_t row = Tables::rowOf[nonTerminal];
+        return row < 0 || column < 0 ? -1 : Tables::table[row * Tables::columns + column];
+    }
+};
+
+// What the tables say about one symbol, as compile-time constants.
+template <typename Tables, int32_t Symbol>
+struct SymbolTraits
+{
+    static_assert(Symbol >= 0 && Symbol < Tables::symbolCount, "no such symbol");
+    static constexpr std::string_view name = Tables::symbolNames[Symbol];
+    static constexpr int32_t row = Tables::rowOf[Symbol];         // -1 for terminals
+    static constexpr int32_t column = Tables::columnOf[Symbol];   // -1 for non-terminals
+    static constexpr bool terminal = row < 0;
+};
+
+/* The table-driven LL(1) parser of ll1_driver.h over the generated tables, with a fixed-size
+   symbol stack. parse() is constexpr, so a static_assert can check an input against the
+   grammar at compile time. It stops on the expansion cycles ExpansionCycles finds there, which
+   a conflicted table can have, instead of looping until the compiler gives up. */
+template <typename Tables, size_t StackCapacity = 1024>
+class StaticParser
+{
+public:
+    struct Result
+    {
+        bool accepted = false;
+        size_t tokensConsumed = 0;   // tokens matched before the parse stopped
+        int32_t expected = -1;       // stack symbol that could not be matched or expanded
+        bool overflow = false;       // the input nests deeper than StackCapacity allows
+        bool diverged = false;       // expected kept expanding without matching a token
+    };
+
+    // Parses count tokens, given as table columns (-1 for a token no terminal matches),
+    // followed by an implicit $.
+    static constexpr Result parse(const int32_t *columns, size_t count)
+    {
+        Result result;
+        int32_t stack[StackCapacity] = {};
+        size_t top = 0;
+        stack[top++] = Tables::endSymbol;
+        stack[top++] = Tables::startSymbol;
+        size_t pos = 0;
+        // Open expansions since the last match, as in ExpansionCycles: openAt[row] is the slot + 1
+        // of row's open expansion, and openRows holds them in slot order.
+        constexpr size_t rowSlots = Tables::rows > 0 ? Tables::rows : 1;
+        size_t openAt[rowSlots] = {};
+        int32_t openRows[rowSlots] = {};
+        size_t openCount = 0;
+        while (top > 0)
+        {
+            int32_t symbol = stack[top - 1];
+            int32_t lookahead = pos < count ? columns[pos] : Tables::endColumn;
+            int32_t row = Tables::rowOf[symbol];
+            if (row < 0)
+            {
+                // Terminal (or $) on top: it must match the lookahead.
+                if (lookahead < 0 || Tables::columnOf[symbol] != lookahead)
+                {
+                    result.expected = symbol;
+                    break;
+                }
+                top--;
+                pos++;
+                for (size_t i = 0; i < openCount; i++)
+                    openAt[openRows[i]] = 0;
+                openCount = 0;
+                continue;
+            }
+            int32_t production = lookahead < 0 ? -1 : Tables::table[row * Tables::columns + lookahead];
+            if (production < 0)
+            {
+                result.expected = symbol;
+                break;
+            }
+            // Replace the non-terminal with the production's symbols, leftmost on top.
+            uint32_t begin = Tables::productionStart[production];
+            uint32_t end = Tables::productionStart[production + 1];
+            top--;
+            while (openCount > 0 && openAt[openRows[openCount - 1]] > top + 1)
+                openAt[openRows[--openCount]] = 0;
+            if (openAt[row] != 0)
+            {
+                result.expected = symbol;
+                result.diverged = true;
+                break;
+            }
+            openAt[row] = top + 1;
+            openRows[openCount++] = row;
+            if (top + (end - begin) > StackCapacity)
+            {
+                result.expected = symbol;
+                result.overflow = true;
+                break;
+            }
+            for (uint32_t i = end; i > begin; i--)
+                stack[top++] = Tables::rhsSymbols[i - 1];
+        }
+        result.accepted = top == 0 && pos == count + 1;
+        result.tokensConsumed = pos < count ? pos : count;
+        return result;
+    }
+};
+
+#endif
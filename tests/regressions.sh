@@ -0,0 +1,190 @@
+#!/bin/sh
+# Runs cfg_parser on grammars that once crashed or hung it. Each case gets its own directory
+# holding grammar.txt (and a token file where needed); a case fails if cfg_parser is killed by a
+# signal, runs past the time limit, or its stdout lacks the expected line.
+#
+#     g++ -std=c++17 -O2 -pthread -o cfg_parser cfg_parser.cpp
+#     tests/regressions.sh ./cfg_parser
+
+binary=$(cd "$(dirname "${1:-./cfg_parser}")" && pwd)/$(basename "${1:-./cfg_parser}")
+repository=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+# check NAME EXPECTED ARGS...: runs the binary on the case's grammar.txt with ARGS, reading the
+# case's input file on stdin if it has one.
+check()
+{
+    name=$1 expected=$2
+    shift 2
+    input=/dev/null
+    [ -f "$work/$name/input" ] && input=input
+    (cd "$work/$name" && timeout 60 "$binary" "$@" < "$input" > stdout.txt 2> stderr.txt)
+    status=$?
+    if [ $status -ge 124 ]; then
+        echo "FAIL $name: exit status $status"
+        failures=$((failures + 1))
+    elif ! grep -qF -- "$expected" "$work/$name/stdout.txt"; then
+        echo "FAIL $name: no \"$expected\" in stdout"
+        failures=$((failures + 1))
+    else
+        echo "ok   $name"
+    fi
+}
+
+# compiles NAME FILE: compiles the case's FILE against the repository's headers, which is how
+# the headers of --emit-header are checked; FILE is read from stdin.
+compiles()
+{
+    name=$1
+    cat > "$work/$name/$2"
+    if (cd "$work/$name" && ${CXX:-c++} -std=c++17 -fsyntax-only -I "$repository" "$2" 2> compile.txt); then
+        echo "ok   $name (compiled)"
+    else
+        echo "FAIL $name: $2 does not compile"
+        failures=$((failures + 1))
+    fi
+}
+
+# grammar NAME: reads the case's grammar.txt from stdin.
+grammar()
+{
+    mkdir -p "$work/$1"
+    cat > "$work/$1/grammar.txt"
+}
+
+# tokens NAME VALUE...: writes the case's toks file, one token per value.
+tokens()
+{
+    name=$1
+    shift
+    for value in "$@"; do
+        echo "Token{type=SYMBOL, value='$value'}"
+    done > "$work/$name/toks"
+}
+
+# Left recursion hidden behind B -> ε is exposed by substitution (S -> A x -> B A y x -> A y x).
+grammar hidden-left-recursion <<'G'
+S -> A x
+A -> B A y | a
+B -> S z | ε
+G
+check hidden-left-recursion "still left-recursive through a nullable prefix: S"
+
+# Dropping A -> A shrinks the component; the delta used to wrap around as size_t.
+grammar shrinking-recursion <<'G'
+S -> A b
+A -> A | ε
+G
+check shrinking-recursion "2 -> 1 productions (-1)"
+
+# B loses its only production to left recursion removal; LAST(B) used to index column -1.
+grammar production-less-chunked <<'G'
+S -> a S | b B
+B -> B x
+G
+tokens production-less-chunked a a b
+check production-less-chunked "Chunked parse:" --parse=toks --parse-threads=2
+
+# B loses all its productions; --lookahead took it for a terminal and read column -1.
+grammar production-less-lookahead <<'G'
+S -> a S | a B c | b
+B -> B x
+G
+check production-less-lookahead "1 LL(2)" --lookahead
+
+# M[S, y] keeps S -> B S x, and with B -> ε the parser expands S forever without matching.
+grammar endless-expansion <<'G'
+S -> B S x | y
+B -> ε
+G
+tokens endless-expansion y
+check endless-expansion "endless expansion of S" --parse=toks
+
+# The same cycle under --recover used to run until memory ran out.
+grammar endless-recovery <<'G'
+S -> B S x | y
+B -> ε
+G
+tokens endless-recovery y x y
+check endless-recovery "Recovering parse: 1 errors" --parse=toks --recover
+
+# And under --parse-threads, whose segments run the same loop.
+grammar endless-chunked <<'G'
+S -> B S x | y
+B -> ε
+G
+tokens endless-chunked y
+check endless-chunked "Chunked parse:" --parse=toks --parse-threads=2
+
+# A cycle through C -> ε that never grows the stack: A -> C B, then B -> A on the same token.
+grammar flat-expansion-cycle <<'G'
+S -> A
+A -> C B | y
+C -> ε
+B -> A | z
+G
+tokens flat-expansion-cycle y
+check flat-expansion-cycle "endless expansion of A" --parse=toks --recover --parse-threads=2
+
+# A token spelled $ took the end-marker column, so the parse stopped in mid-stream with nothing
+# expected and printing that nothing crashed.
+grammar dollar-token <<'G'
+S -> a S | ε
+G
+tokens dollar-token a '$' a
+check dollar-token "Parse error at token 2" --parse=toks --parse-tree --parse-events --parse-threads=2 --recover
+
+# --serve resized its buffer to whatever size a request named and died of std::length_error.
+grammar oversized-request <<'G'
+S -> a S | b
+G
+printf 'analyze 18446744073709551615\nanalyze 13\nS -> a S | b\n\nquit\n' > "$work/oversized-request/input"
+check oversized-request "exceeds the limit" --serve
+
+# The generated lexer gave a $ lexeme the end-marker column as well.
+grammar dollar-lexeme <<'G'
+S -> a S | ε
+G
+printf 'SYMBOL = a|\\$\n' > "$work/dollar-lexeme/regex.txt"
+printf 'a $ a\n' > "$work/dollar-lexeme/source.txt"
+check dollar-lexeme "Parse error at token 2" --lex=source.txt --parse-threads=2 --recover
+
+# The shipped regex.txt had no identifier rule and could not lex the repository's own code.rmd.
+grammar shipped-lexer-spec <<'G'
+P -> St P | ε
+St -> KEYWORD IDENTIFIER = E ; | IDENTIFIER = E ;
+E -> V R
+R -> + V R | ε
+V -> IDENTIFIER | TOKEN
+G
+cp "$repository/regex.txt" "$repository/code.rmd" "$work/shipped-lexer-spec/"
+check shipped-lexer-spec "Parse accepted: 16 tokens" --lex=code.rmd
+
+# The static parser had no cycle check, so a conflicted table made parse() loop forever, and a
+# static_assert on it ran into the compiler's constexpr step limit.
+grammar static-expansion-cycle <<'G'
+S -> B S | y
+B -> ε | z
+G
+check static-expansion-cycle "Wrote cycle.h" --emit-header=cycle.h
+compiles static-expansion-cycle main.cpp <<'C'
+#include "cycle.h"
+constexpr int32_t input[] = {cycle::Grammar::column("y")};
+constexpr auto result = cycle::Parser::parse(input, 1);
+static_assert(!result.accepted && result.diverged && result.expected == cycle::Grammar::symbol("S"), "");
+C
+
+# A cache whose payload was overwritten used to be trusted and crashed the parser; it is now
+# rejected by its checksum and the phases run again.
+grammar corrupt-cache <<'G'
+S -> a S | b
+G
+tokens corrupt-cache a b
+check corrupt-cache "Processing complete." --cache=cache.bin
+printf '\377\377\377\177' | dd of="$work/corrupt-cache/cache.bin" bs=1 seek=288 conv=notrunc 2> /dev/null
+check corrupt-cache "Parse accepted" --cache=cache.bin --parse=toks
+
+[ $failures -eq 0 ] && echo "All regressions passed." || echo "$failures regression(s) failed."
+[ $failures -eq 0 ]
@@ -0,0 +1,158 @@
+#ifndef TRIE_FACTORING_H
+#define TRIE_FACTORING_H
+
+#include <vector>
+#include <deque>
+#include <memory_resource>
+#include <cstdint>
+
+#include "grammar_ir.h"
+
+/* Left factoring over a prefix trie of a non-terminal's productions.
+
+   Every group of productions sharing a prefix is factored, at every depth: for
+       A -> a b c | a b d | a e | f
+   the result is
+       A -> a A' | f        A' -> b A'2 | e        A'2 -> c | d
+   Building the trie and walking it are both linear in the total right-hand-side length
+   (child lookup goes through one hash map keyed by (node, symbol)). Chains of nodes with a
+   single continuation are collapsed into one production, so new non-terminals are only
+   introduced where alternatives actually branch. Identical productions are merged.
+*/
+class LeftFactoringTrie
+{
+public:
+    explicit LeftFactoringTrie(std::pmr::memory_resource *scratch = std::pmr::get_default_resource())
+        : nodes(scratch), edges(scratch), childOf(scratch), work(scratch), path(scratch) {}
+
+    // Factors the productions of nonTerminal in grammar into out.
+    void factor(SymbolId nonTerminal, const Grammar &grammar, GrammarBuilder &out, SymbolTable &symbols)
+    {
+        nodes.clear();
+        edges.clear();
+        childOf.clear();
+        nodes.push_back(Node());
+
+        // Insert every production; ordinals remember the first production reaching a branch so
+        // alternatives come out in grammar order.
+        uint32_t ordinal = 0;
+        for (uint32_t p = grammar.firstProduction(nonTerminal); p < grammar.endProduction(nonTerminal); p++, ordinal++)
+        {
+            uint32_t node = 0;
+            for (SymbolId sym : grammar.rhs(p))
+                node = child(node, sym, ordinal);
+            if (nodes[node].endOrdinal == NONE)
+                nodes[node].endOrdinal = ordinal;
+        }
+
+        // Emit rules breadth first so each rule is written in one piece: the rule of a node,
+        // then the rules of the new non-terminals it introduced.
+        work.clear();
+        work.push_back(Pending{0, nonTerminal});
+        while (!work.empty())
+        {
+            Pending item = work.front();
+            work.pop_front();
+            emitRule(item, out, symbols, nonTerminal);
+        }
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        uint32_t firstEdge = NONE;   // children, in order of first appearance
+        uint32_t lastEdge = NONE;
+        uint32_t endOrdinal = NONE;  // first production ending here, if any
+        uint32_t branches = 0;       // children plus one if a production ends here
+    };
+
+    struct Edge
+    {
+        SymbolId symbol;
+        uint32_t target;
+        uint32_t next;
+        uint32_t ordinal;
+    };
+
+    struct Pending
+    {
+        uint32_t node;
+        SymbolId lhs;
+    };
+
+    uint32_t child(uint32_t node, SymbolId sym, uint32_t ordinal)
+    {
+        uint64_t key = (uint64_t(node) << 32) | uint32_t(sym);
+        if (const uint32_t *found = childOf.find(key))
+            return *found;
+        uint32_t target = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node());
+        uint32_t edge = static_cast<uint32_t>(edges.size());
+        edges.push_back(Edge{sym, target, NONE, ordinal});
+        if (nodes[node].lastEdge == NONE)
+            nodes[node].firstEdge = edge;
+        else
+            edges[nodes[node].lastEdge].next = edge;
+        nodes[node].lastEdge = edge;
+        nodes[node].branches++;
+        childOf.emplace(key, target);
+        return target;
+    }
+
+    size_t branchCount(const Node &node) const
+    {
+        return node.branches + (node.endOrdinal != NONE ? 1 : 0);
+    }
+
+    void emitRule(const Pending &item, GrammarBuilder &out, SymbolTable &symbols, SymbolId base)
+    {
+        out.startRule(item.lhs);
+        const Node &node = nodes[item.node];
+        bool epsilonPending = node.endOrdinal != NONE;
+        for (uint32_t e = node.firstEdge; e != NONE; e = edges[e].next)
+        {
+            if (epsilonPending && node.endOrdinal < edges[e].ordinal)
+            {
+                out.endProduction();   // the production ending at this node is ε here
+                epsilonPending = false;
+            }
+            emitBranch(e, out, symbols, base);
+        }
+        if (epsilonPending)
+            out.endProduction();
+    }
+
+    // Writes one alternative: the collapsed chain below edge e, followed by a new non-terminal
+    // if the chain ends at a branching node.
+    void emitBranch(uint32_t e, GrammarBuilder &out, SymbolTable &symbols, SymbolId base)
+    {
+        path.clear();
+        uint32_t node = edges[e].target;
+        path.push_back(edges[e].symbol);
+        while (branchCount(nodes[node]) == 1 && nodes[node].endOrdinal == NONE)
+        {
+            const Edge &only = edges[nodes[node].firstEdge];
+            path.push_back(only.symbol);
+            node = only.target;
+        }
+        for (SymbolId sym : path)
+            out.push(sym);
+        if (branchCount(nodes[node]) > 1)
+        {
+            SymbolId newNT = symbols.freshNonTerminal(symbols.name(base));
+            out.push(newNT);
+            work.push_back(Pending{node, newNT});
+        }
+        out.endProduction();
+    }
+
+    std::pmr::vector<Node> nodes;
+    std::pmr::vector<Edge> edges;
+    FlatHashMap<uint64_t, uint32_t> childOf;
+    std::pmr::deque<Pending> work;
+    std::pmr::vector<SymbolId> path;
+};
+
+#endif